@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <sstream>
+
 #include "lib/json.h"
 #include "JsonObjects.h"
 #include "helpers.h"
@@ -400,9 +402,19 @@ unsigned
 JsonObjects::add_action(const cstring& name, Util::JsonArray*& params, Util::JsonArray*& body) {
     CHECK_NULL(params);
     CHECK_NULL(body);
+    // Inlining and action localization leave many copies of the same
+    // action; the copies have the same control plane name.
+    std::stringstream key;
+    key << name << '\0';
+    params->serialize(key);
+    body->serialize(key);
+    auto it = action_ids.find(key.str());
+    if (it != action_ids.end())
+        return it->second;
     auto action = new Util::JsonObject();
     action->emplace("name", name);
     unsigned id = BMV2::nextId("actions");
+    action_ids.emplace(key.str(), id);
     action->emplace("id", id);
     action->emplace("runtime_data", params);
     action->emplace("primitives", body);
@@ -410,6 +422,47 @@ JsonObjects::add_action(const cstring& name, Util::JsonArray*& params, Util::Jso
     return id;
 }
 
+cstring
+JsonObjects::add_calculation(const cstring& name, const cstring& algo, Util::IJson* input,
+                             Util::IJson* source_info) {
+    CHECK_NULL(input);
+    std::stringstream key;
+    key << algo << '\0';
+    input->serialize(key);
+    auto it = calculation_names.find(key.str());
+    if (it != calculation_names.end())
+        return it->second;
+    auto calc = new Util::JsonObject();
+    calc->emplace("name", name);
+    calc->emplace("id", BMV2::nextId("calculations"));
+    calc->emplace_non_null("source_info", source_info);
+    calc->emplace("algo", algo);
+    calc->emplace("input", input);
+    calculations->append(calc);
+    calculation_names.emplace(key.str(), name);
+    return name;
+}
+
+unsigned
+JsonObjects::add_field_list(const cstring& name, Util::JsonArray* elements,
+                            Util::IJson* source_info) {
+    CHECK_NULL(elements);
+    std::stringstream key;
+    elements->serialize(key);
+    auto it = field_list_ids.find(key.str());
+    if (it != field_list_ids.end())
+        return it->second;
+    auto fl = new Util::JsonObject();
+    unsigned id = BMV2::nextId("field_lists");
+    fl->emplace("id", id);
+    fl->emplace("name", name);
+    fl->emplace_non_null("source_info", source_info);
+    fl->emplace("elements", elements);
+    field_lists->append(fl);
+    field_list_ids.emplace(key.str(), id);
+    return id;
+}
+
 void
 JsonObjects::add_extern_attribute(const cstring& name, const cstring& type,
                                   const cstring& value, Util::JsonArray* attributes) {
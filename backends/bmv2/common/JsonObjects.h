@@ -18,6 +18,8 @@ limitations under the License.
 #define BACKENDS_BMV2_COMMON_JSONOBJECTS_H_
 
 #include <map>
+#include <string>
+#include <unordered_map>
 #include "lib/json.h"
 #include "lib/ordered_map.h"
 
@@ -51,7 +53,14 @@ class JsonObjects {
     void add_parser_transition_key(const unsigned id, Util::IJson* key);
     void add_parse_vset(const cstring& name, const unsigned bitwidth,
                         const big_int& size);
+    // Actions, calculations and field lists which are identical to one
+    // added before are not emitted again; these return the id or name of
+    // the existing one.
     unsigned add_action(const cstring& name, Util::JsonArray*& params, Util::JsonArray*& body);
+    cstring add_calculation(const cstring& name, const cstring& algo, Util::IJson* input,
+                            Util::IJson* source_info);
+    unsigned add_field_list(const cstring& name, Util::JsonArray* elements,
+                            Util::IJson* source_info);
     void add_extern_attribute(const cstring& name, const cstring& type,
                               const cstring& value, Util::JsonArray* attributes);
     void add_extern(const cstring& name, const cstring& type, Util::JsonArray* attributes);
@@ -93,6 +102,13 @@ class JsonObjects {
     Util::JsonArray* register_arrays;
     Util::JsonArray* force_arith;
     Util::JsonArray* field_aliases;
+
+ private:
+    // Serialized contents of the actions, calculations and field lists
+    // added so far, mapped to their id or name.
+    std::unordered_map<std::string, unsigned> action_ids;
+    std::unordered_map<std::string, cstring> calculation_names;
+    std::unordered_map<std::string, unsigned> field_list_ids;
 };
 
 }  // namespace BMV2
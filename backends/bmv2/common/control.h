@@ -19,6 +19,7 @@ limitations under the License.
 
 #include "ir/ir.h"
 #include "lib/json.h"
+#include "control-plane/bulkEntries.h"
 #include "controlFlowGraph.h"
 #include "frontends/p4/coreLibrary.h"
 #include "frontends/p4/typeMap.h"
@@ -162,6 +163,9 @@ class ControlConverter : public Inspector {
         }
         if (auto entries = table->getEntries()) {
             size = entries->entries.size();
+        } else if (auto bulk = P4::ControlPlaneAPI::BulkEntries::get(
+                       table, ctxt->refMap, ctxt->typeMap)) {
+            size = bulk->size();
         }
         if (size == 0)
             size = BMV2::TableAttributes::defaultTableSize;
@@ -429,7 +433,80 @@ class ControlConverter : public Inspector {
     convertTableEntries(table, result);
     return result;
     }
+    /// Converts the entries read from an @entries_file one at a time, without
+    /// creating IR nodes for them.
+    void convertBulkEntries(const P4::ControlPlaneAPI::BulkEntries *bulk,
+                            Util::JsonObject *jsonTable) {
+        using Key = P4::ControlPlaneAPI::BulkEntries::Key;
+        auto entries = mkArrayField(jsonTable, "entries");
+        int entryPriority = 1;  // default priority is defined by index position
+        bulk->forEach([&](const P4::ControlPlaneAPI::BulkEntries::Entry &e) {
+            auto entry = new Util::JsonObject();
+            auto matchKeys = mkArrayField(entry, "match_key");
+            for (size_t i = 0; i < e.keys.size(); i++) {
+                auto &k = e.keys[i];
+                auto keyWidth = bulk->keyWidths()[i];
+                auto k8 = ROUNDUP(keyWidth, 8);
+                auto matchType = bulk->keyMatchKinds()[i];
+                auto key = new Util::JsonObject();
+                // optional keys are represented as ternary ones
+                key->emplace("match_type",
+                             matchType == "optional" ? cstring("ternary") : matchType);
+                if (matchType == corelib.exactMatch.name) {
+                    key->emplace("key", stringRepr(k.value, k8));
+                } else if (matchType == corelib.lpmMatch.name) {
+                    key->emplace("key", stringRepr(k.value, k8));
+                    if (k.kind == Key::PREFIX)
+                        key->emplace("prefix_length", k.prefixLength);
+                    else if (k.kind == Key::DONT_CARE)
+                        key->emplace("prefix_length", 0);
+                    else
+                        key->emplace("prefix_length", keyWidth);
+                } else if (matchType == "range") {
+                    if (k.kind == Key::RANGE) {
+                        key->emplace("start", stringRepr(k.value, k8));
+                        key->emplace("end", stringRepr(k.mask, k8));
+                    } else if (k.kind == Key::DONT_CARE) {
+                        key->emplace("start", stringRepr(0, k8));
+                        key->emplace("end", stringRepr(Util::mask(keyWidth), k8));
+                    } else {
+                        key->emplace("start", stringRepr(k.value, k8));
+                        key->emplace("end", stringRepr(k.value, k8));
+                    }
+                } else {
+                    // ternary and optional
+                    if (k.kind == Key::MASK) {
+                        key->emplace("key", stringRepr(k.value, k8));
+                        key->emplace("mask", stringRepr(k.mask, k8));
+                    } else if (k.kind == Key::DONT_CARE) {
+                        key->emplace("key", stringRepr(0, k8));
+                        key->emplace("mask", stringRepr(0, k8));
+                    } else {
+                        key->emplace("key", stringRepr(k.value, k8));
+                        key->emplace("mask", stringRepr(Util::mask(keyWidth), k8));
+                    }
+                }
+                matchKeys->append(key);
+            }
+
+            auto action = new Util::JsonObject();
+            unsigned id = get(ctxt->structure->ids, e.action, INVALID_ACTION_ID);
+            BUG_CHECK(id != INVALID_ACTION_ID, "Could not find id for %1%", e.action);
+            action->emplace("action_id", id);
+            auto actionData = mkArrayField(action, "action_data");
+            for (auto &arg : e.arguments)
+                actionData->append(stringRepr(arg, 0));
+            entry->emplace("action_entry", action);
+            entry->emplace("priority", entryPriority++);
+            entries->append(entry);
+        });
+    }
     void convertTableEntries(const IR::P4Table *table, Util::JsonObject *jsonTable) {
+        if (auto bulk = P4::ControlPlaneAPI::BulkEntries::get(
+                table, ctxt->refMap, ctxt->typeMap)) {
+            convertBulkEntries(bulk, jsonTable);
+            return;
+        }
         auto entriesList = table->getEntries();
         if (entriesList == nullptr) return;
 
@@ -198,6 +198,11 @@ int
 ExternConverter::createFieldList(ConversionContext* ctxt,
                                  const IR::Expression* expr, cstring group,
                                  cstring listName, Util::JsonArray* field_lists) {
+    if (field_lists == ctxt->json->field_lists) {
+        auto elements = new Util::JsonArray();
+        addToFieldList(ctxt, expr, elements);
+        return ctxt->json->add_field_list(listName, elements, expr->sourceInfoJsonObj());
+    }
     auto fl = new Util::JsonObject();
     field_lists->append(fl);
     int id = nextId(group);
@@ -212,15 +217,9 @@ ExternConverter::createFieldList(ConversionContext* ctxt,
 cstring
 ExternConverter::createCalculation(ConversionContext* ctxt,
                                    cstring algo, const IR::Expression* fields,
-                                   Util::JsonArray* calculations, bool withPayload,
+                                   bool withPayload,
                                    const IR::Node* sourcePositionNode = nullptr) {
     cstring calcName = ctxt->refMap->newName("calc_");
-    auto calc = new Util::JsonObject();
-    calc->emplace("name", calcName);
-    calc->emplace("id", nextId("calculations"));
-    if (sourcePositionNode != nullptr)
-        calc->emplace_non_null("source_info", sourcePositionNode->sourceInfoJsonObj());
-    calc->emplace("algo", algo);
     fields = convertToList(fields, ctxt->typeMap);
     if (!fields) {
         modelError("%1%: expected a struct", fields);
@@ -235,9 +234,8 @@ ExternConverter::createCalculation(ConversionContext* ctxt,
         payload->emplace("value", (Util::IJson*)nullptr);
         array->append(payload);
     }
-    calc->emplace("input", jright);
-    calculations->append(calc);
-    return calcName;
+    return ctxt->json->add_calculation(calcName, algo, jright,
+        sourcePositionNode ? sourcePositionNode->sourceInfoJsonObj() : nullptr);
 }
 
 cstring
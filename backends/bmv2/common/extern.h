@@ -68,7 +68,7 @@ class ExternConverter {
     int createFieldList(ConversionContext* ctxt, const IR::Expression* expr, cstring group,
                         cstring listName, Util::JsonArray* field_lists);
     cstring createCalculation(ConversionContext* ctxt, cstring algo, const IR::Expression* fields,
-                              Util::JsonArray* calculations, bool usePayload, const IR::Node* node);
+                              bool usePayload, const IR::Node* node);
     static cstring convertHashAlgorithm(cstring algorithm);
     Util::IJson*
     convertAssertAssume(ConversionContext* ctxt, const IR::MethodCallExpression* methodCall,
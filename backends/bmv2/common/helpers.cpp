@@ -127,16 +127,16 @@ ConversionContext::addToFieldList(const IR::Expression* expr, Util::JsonArray* f
 int
 ConversionContext::createFieldList(
     const IR::Expression* expr, cstring listName, bool learn) {
-    cstring group;
-    auto fl = new Util::JsonObject();
-    if (learn) {
-        group = "learn_lists";
-        json->learn_lists->append(fl);
-    } else {
-        group = "field_lists";
-        json->field_lists->append(fl);
+    if (!learn) {
+        auto elements = new Util::JsonArray();
+        addToFieldList(expr, elements);
+        return json->add_field_list(listName, elements, expr->sourceInfoJsonObj());
     }
-    int id = nextId(group);
+    // Learn lists are not shared: their names are visible to the control
+    // plane.
+    auto fl = new Util::JsonObject();
+    json->learn_lists->append(fl);
+    int id = nextId("learn_lists");
     fl->emplace("id", id);
     fl->emplace("name", listName);
     fl->emplace_non_null("source_info", expr->sourceInfoJsonObj());
@@ -153,15 +153,9 @@ ConversionContext::modelError(const char* format, const IR::Node* node) {
 
 cstring
 ConversionContext::createCalculation(cstring algo, const IR::Expression* fields,
-                                     Util::JsonArray* calculations, bool withPayload,
+                                     bool withPayload,
                                      const IR::Node* sourcePositionNode = nullptr) {
     cstring calcName = refMap->newName("calc_");
-    auto calc = new Util::JsonObject();
-    calc->emplace("name", calcName);
-    calc->emplace("id", nextId("calculations"));
-    if (sourcePositionNode != nullptr)
-        calc->emplace_non_null("source_info", sourcePositionNode->sourceInfoJsonObj());
-    calc->emplace("algo", algo);
     fields = convertToList(fields, typeMap);
     if (!fields) {
         modelError("%1%: expected a struct", fields);
@@ -176,9 +170,8 @@ ConversionContext::createCalculation(cstring algo, const IR::Expression* fields,
         payload->emplace("value", (Util::IJson*)nullptr);
         array->append(payload);
     }
-    calc->emplace("input", jright);
-    calculations->append(calc);
-    return calcName;
+    return json->add_calculation(calcName, algo, jright,
+        sourcePositionNode ? sourcePositionNode->sourceInfoJsonObj() : nullptr);
 }
 
 /// Converts expr into a ListExpression or returns nullptr if not
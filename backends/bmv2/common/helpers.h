@@ -328,7 +328,7 @@ struct ConversionContext {
     void addToFieldList(const IR::Expression* expr, Util::JsonArray* fl);
     int createFieldList(const IR::Expression* expr, cstring listName, bool learn = false);
     cstring createCalculation(cstring algo, const IR::Expression* fields,
-                              Util::JsonArray* calculations, bool usePayload, const IR::Node* node);
+                              bool usePayload, const IR::Node* node);
     static void modelError(const char* format, const IR::Node* place);
 };
 
@@ -269,8 +269,7 @@ Util::IJson* ExternConverter_hash::convertExternFunction(
         return nullptr;
     }
     auto fields = mc->arguments->at(3);
-    auto calcName = ctxt->createCalculation(ei->name, fields->expression, ctxt->json->calculations,
-                                      false, nullptr);
+    auto calcName = ctxt->createCalculation(ei->name, fields->expression, false, nullptr);
     calculation->emplace("type", "calculation");
     calculation->emplace("value", calcName);
     parameters->append(calculation);
@@ -886,15 +885,9 @@ SimpleSwitchBackend::modelError(const char* format, const IR::Node* node) const
 
 cstring
 SimpleSwitchBackend::createCalculation(cstring algo, const IR::Expression* fields,
-                                       Util::JsonArray* calculations, bool withPayload,
+                                       bool withPayload,
                                        const IR::Node* sourcePositionNode = nullptr) {
     cstring calcName = refMap->newName("calc_");
-    auto calc = new Util::JsonObject();
-    calc->emplace("name", calcName);
-    calc->emplace("id", nextId("calculations"));
-    if (sourcePositionNode != nullptr)
-        calc->emplace_non_null("source_info", sourcePositionNode->sourceInfoJsonObj());
-    calc->emplace("algo", algo);
     fields = convertToList(fields, typeMap);
     if (!fields) {
         modelError("%1%: expected a struct", fields);
@@ -909,9 +902,8 @@ SimpleSwitchBackend::createCalculation(cstring algo, const IR::Expression* field
         payload->emplace("value", (Util::IJson*)nullptr);
         array->append(payload);
     }
-    calc->emplace("input", jright);
-    calculations->append(calc);
-    return calcName;
+    return json->add_calculation(calcName, algo, jright,
+        sourcePositionNode ? sourcePositionNode->sourceInfoJsonObj() : nullptr);
 }
 
 namespace {
@@ -937,12 +929,12 @@ class EnsureExpressionIsSimple : public Inspector {
 
 void
 SimpleSwitchBackend::convertChecksum(const IR::BlockStatement *block, Util::JsonArray* checksums,
-                                     Util::JsonArray* calculations, bool verify) {
+                                     bool verify) {
     if (errorCount() > 0)
         return;
     for (auto stat : block->components) {
         if (auto blk = stat->to<IR::BlockStatement>()) {
-            convertChecksum(blk, checksums, calculations, verify);
+            convertChecksum(blk, checksums, verify);
             continue;
         } else if (auto mc = stat->to<IR::MethodCallStatement>()) {
             auto mi = P4::MethodInstance::resolve(mc, refMap, typeMap);
@@ -965,9 +957,7 @@ SimpleSwitchBackend::convertChecksum(const IR::BlockStatement *block, Util::Json
                     EnsureExpressionIsSimple eeis(
                         verify ? v1model.verify_checksum.name : v1model.update_checksum.name);
                     (void)calcExpr->apply(eeis);
-                    cstring calcName = createCalculation(
-                        algo, calcExpr,
-                        calculations, usePayload, mc);
+                    cstring calcName = createCalculation(algo, calcExpr, usePayload, mc);
                     cksum->emplace("name", refMap->newName("cksum_"));
                     cksum->emplace("id", nextId("checksums"));
                     cksum->emplace_non_null("source_info", stat->sourceInfoJsonObj());
@@ -1251,12 +1241,10 @@ SimpleSwitchBackend::convert(const IR::ToplevelBlock* tlb) {
     structure->deparser->apply(*dconv);
 
     ctxt->blockConverted = BlockConverted::ChecksumCompute;
-    convertChecksum(structure->compute_checksum->body, json->checksums,
-                    json->calculations, false);
+    convertChecksum(structure->compute_checksum->body, json->checksums, false);
 
     ctxt->blockConverted = BlockConverted::ChecksumVerify;
-    convertChecksum(structure->verify_checksum->body, json->checksums,
-                    json->calculations, true);
+    convertChecksum(structure->verify_checksum->body, json->checksums, true);
 
     (void)toplevel->apply(ConvertGlobals(ctxt, options.emitExterns));
 }
@@ -151,12 +151,12 @@ class SimpleSwitchBackend : public Backend {
     void createRecirculateFieldsList(ConversionContext* ctxt, const IR::ToplevelBlock* tlb,
                                      cstring scalarName);
     cstring createCalculation(cstring algo, const IR::Expression* fields,
-                              Util::JsonArray* calculations, bool usePayload, const IR::Node* node);
+                              bool usePayload, const IR::Node* node);
 
  public:
     void modelError(const char* format, const IR::Node* place) const;
     void convertChecksum(const IR::BlockStatement* body, Util::JsonArray* checksums,
-                         Util::JsonArray* calculations, bool verify);
+                         bool verify);
     void createActions(ConversionContext* ctxt, V1ProgramStructure* structure);
 
     void convert(const IR::ToplevelBlock* tlb) override;
@@ -118,8 +118,23 @@ void DpdkBackend::convert(const IR::ToplevelBlock *tlb) {
     PassManager post_code_gen = {
         new EliminateUnusedAction(),
         new DpdkAsmOptimization,
+        new PassIf([this] { return options.dataflowOpt; }, {
+            new DpdkDataflowOptimization(&structure),
+            new DpdkAsmOptimization,
+        }),
         new CollectUsedMetadataField(used_fields),
         new RemoveUnusedMetadataFields(used_fields),
+        new PassIf([this] { return options.shareMetadataSlots; }, {
+            new ShareMetadataSlots(&structure),
+        }),
+        new PassIf([this] {
+                return options.metadataLayout == DpdkOptions::MetadataLayout::KEY_AWARE; }, {
+            new LayoutMetadataForKeys,
+        }),
+        new PassIf([this] {
+                return options.metadataLayout == DpdkOptions::MetadataLayout::HOT_FIRST; }, {
+            new LayoutMetadataByAccess(options.metadataProfile),
+        }),
     };
 
     dpdk_program = dpdk_program->apply(post_code_gen)->to<IR::DpdkAsmProgram>();
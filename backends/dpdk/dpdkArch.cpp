@@ -1160,6 +1160,7 @@ const IR::Node *CollectLocalVariables::postorder(IR::Type_Struct *s) {
                 for (auto field : strct->fields) {
                     auto sf = new IR::StructField(IR::ID(kv.second + "_" + field->name),
                                   field->type);
+                    structure->local_variable_fields.insert(sf->name.name);
                     LOG2("New field: " << sf << std::endl <<
                          " type: " << field->type << std::endl <<
                          " added to: " << s->name.name);
@@ -1171,6 +1172,7 @@ const IR::Node *CollectLocalVariables::postorder(IR::Type_Struct *s) {
                      " type: " << type << std::endl <<
                      " added to: " << s->name.name);
                 s->fields.push_back(sf);
+                structure->local_variable_fields.insert(sf->name.name);
             }
         }
     } else if (s->name.name == structure->header_type) {
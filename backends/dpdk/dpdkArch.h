@@ -591,7 +591,7 @@ class InjectInternetChecksumIntermediateValue : public Transform {
                     auto fields = new IR::IndexedVector<IR::StructField>;
                     for (auto kv : structure->csum_map) {
                         fields->push_back(new IR::StructField(
-                            IR::ID(kv.second), new IR::Type_Bits(16, false)));
+                            IR::ID(kv.second), IR::Type_Bits::get(16)));
                     }
                     new_objs->push_back(
                         new IR::Type_Header(IR::ID("cksum_state_t"), *fields));
@@ -16,6 +16,11 @@ limitations under the License.
 
 #include "dpdkAsmOpt.h"
 
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
 namespace DPDK {
 // The assumption is compiler can only produce forward jumps.
 const IR::IndexedVector<IR::DpdkAsmStatement> *RemoveRedundantLabel::removeRedundantLabel(
@@ -194,4 +199,1022 @@ const IR::Node* RemoveUnusedMetadataFields::preorder(IR::DpdkAsmProgram *p) {
     return p;
 }
 
+namespace {
+
+const IR::DpdkStructType *getMetadataStruct(const IR::DpdkAsmProgram *p) {
+    for (auto st : p->structType) {
+        if (st->getAnnotation("__metadata__"))
+            return st;
+    }
+    return nullptr;
+}
+
+void collectFields(const IR::Node *n, MetadataLiveness::FieldSet &fields) {
+    if (n == nullptr)
+        return;
+    forAllMatching<IR::Member>(n, [&](const IR::Member *m) {
+        if (auto name = MetadataLiveness::fieldName(m))
+            fields.insert(name);
+    });
+}
+
+// Selector group and member ids are stored as strings like "m.<field_name>"
+void collectField(cstring id, MetadataLiveness::FieldSet &fields) {
+    if (id && id.startsWith("m."))
+        fields.insert(id.substr(2));
+}
+
+cstring actionName(const IR::ActionListElement *ale) {
+    if (auto mce = ale->expression->to<IR::MethodCallExpression>()) {
+        if (auto path = mce->method->to<IR::PathExpression>()) {
+            if (path->path->name.toString() == "NoAction")
+                return "NoAction";
+            return path->path->name.name;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+cstring MetadataLiveness::fieldName(const IR::Expression *e) {
+    if (auto m = e->to<IR::Member>()) {
+        if (auto path = m->expr->to<IR::PathExpression>()) {
+            if (path->path->name == "m")
+                return m->member.name;
+        }
+    }
+    return nullptr;
+}
+
+MetadataLiveness::MetadataLiveness(const IR::DpdkAsmProgram *program) : program(program) {
+    for (auto a : program->actions)
+        actions.emplace(a->name.name, a);
+    collectTables();
+
+    // learn instructions copy the arguments of the learned action from
+    // consecutive metadata fields, starting at the given one
+    auto metadata = getMetadataStruct(program);
+    forAllMatching<IR::DpdkLearnStatement>(program, [&](const IR::DpdkLearnStatement *learn) {
+        if (!learn->argument || !metadata)
+            return;
+        auto first = fieldName(learn->argument);
+        if (!first)
+            return;
+        size_t count = metadata->fields.size();
+        auto action = ::get(actions, learn->action);
+        if (action && action->para.size() == 0) {
+            count = 1;
+        } else if (action && action->para.size() == 1) {
+            if (auto tn = action->para.parameters.at(0)->type->to<IR::Type_Name>()) {
+                for (auto st : program->structType) {
+                    if (st->name == tn->path->name)
+                        count = st->fields.size();
+                }
+            }
+        }
+        auto &arguments = learnArguments[first];
+        bool found = false;
+        for (auto f : metadata->fields) {
+            if (f->name == first)
+                found = true;
+            if (found && count > 0) {
+                arguments.insert(f->name);
+                count--;
+            }
+        }
+        arguments.insert(first);
+    });
+
+    // Summarize the fields read by each action, then analyze the apply block,
+    // then the actions again with the fields live after they run.
+    for (auto a : program->actions)
+        analyze(a->statements, {});
+    std::map<cstring, FieldSet> liveAfterAction;
+    for (auto s : program->statements) {
+        auto l = s->to<IR::DpdkListStatement>();
+        if (!l)
+            continue;
+        analyze(l->statements, {});
+        for (size_t i = 0; i < l->statements.size(); i++) {
+            auto apply = l->statements.at(i)->to<IR::DpdkApplyStatement>();
+            if (!apply)
+                continue;
+            auto &out = liveOut(l->statements, i);
+            for (auto a : tableActions[apply->table])
+                liveAfterAction[a->name.name].insert(out.begin(), out.end());
+        }
+    }
+    for (auto a : program->actions)
+        analyze(a->statements, liveAfterAction[a->name.name]);
+}
+
+void MetadataLiveness::collectTables() {
+    auto addActions = [this](cstring table, const IR::ActionList *list) {
+        for (auto ale : list->actionList) {
+            auto action = ::get(actions, actionName(ale));
+            if (action)
+                tableActions[table].push_back(action);
+        }
+    };
+    for (auto t : program->tables) {
+        collectFields(t->match_keys, tableReads[t->name]);
+        addActions(t->name, t->actions);
+    }
+    for (auto t : program->learners) {
+        collectFields(t->match_keys, tableReads[t->name]);
+        addActions(t->name, t->actions);
+    }
+    for (auto t : program->selectors) {
+        collectFields(t->selectors, tableReads[t->name]);
+        collectField(t->group_id, tableReads[t->name]);
+        collectField(t->member_id, tableWrites[t->name]);
+    }
+}
+
+void MetadataLiveness::access(const IR::DpdkAsmStatement *s, FieldSet &uses, FieldSet &defs,
+                              FieldSet &clobbers) const {
+    auto def = [&](const IR::Expression *e) {
+        if (auto name = fieldName(e))
+            defs.insert(name);
+    };
+    if (auto u = s->to<IR::DpdkUnaryStatement>()) {
+        collectFields(u->src, uses);
+        def(u->dst);
+    } else if (auto b = s->to<IR::DpdkBinaryStatement>()) {
+        collectFields(b->src1, uses);
+        collectFields(b->src2, uses);
+        def(b->dst);
+    } else if (auto r = s->to<IR::DpdkRegisterReadStatement>()) {
+        collectFields(r->index, uses);
+        def(r->dst);
+    } else if (auto c = s->to<IR::DpdkCastStatement>()) {
+        collectFields(c->src, uses);
+        def(c->dst);
+    } else if (auto h = s->to<IR::DpdkGetHashStatement>()) {
+        collectFields(h->fields, uses);
+        def(h->dst);
+    } else if (auto c = s->to<IR::DpdkGetChecksumStatement>()) {
+        def(c->dst);
+    } else if (auto rx = s->to<IR::DpdkRxStatement>()) {
+        def(rx->port);
+    } else if (auto m = s->to<IR::DpdkMeterExecuteStatement>()) {
+        collectFields(m->index, uses);
+        collectFields(m->length, uses);
+        collectFields(m->color_in, uses);
+        def(m->color_out);
+    } else if (auto l = s->to<IR::DpdkLearnStatement>()) {
+        auto first = l->argument ? fieldName(l->argument) : cstring();
+        if (first && learnArguments.count(first)) {
+            auto &arguments = learnArguments.at(first);
+            uses.insert(arguments.begin(), arguments.end());
+        } else {
+            collectFields(l->argument, uses);
+        }
+    } else if (auto apply = s->to<IR::DpdkApplyStatement>()) {
+        if (tableReads.count(apply->table)) {
+            auto &reads = tableReads.at(apply->table);
+            uses.insert(reads.begin(), reads.end());
+        }
+        if (tableWrites.count(apply->table)) {
+            auto &writes = tableWrites.at(apply->table);
+            clobbers.insert(writes.begin(), writes.end());
+        }
+    } else if (s->is<IR::DpdkJmpStatement>() || s->is<IR::DpdkTxStatement>() ||
+               s->is<IR::DpdkRegisterWriteStatement>() ||
+               s->is<IR::DpdkCounterCountStatement>() || s->is<IR::DpdkMirrorStatement>() ||
+               s->is<IR::DpdkVerifyStatement>() || s->is<IR::DpdkExtractStatement>() ||
+               s->is<IR::DpdkEmitStatement>()) {
+        collectFields(s, uses);
+    } else {
+        // Unknown instructions may both read and write the fields they refer to.
+        collectFields(s, uses);
+        collectFields(s, clobbers);
+    }
+}
+
+std::vector<size_t> MetadataLiveness::successors(const Instructions &stmts, size_t index,
+                                                 const std::map<cstring, size_t> &labels) {
+    auto exit = stmts.size();
+    auto s = stmts.at(index);
+    auto target = [&](const IR::DpdkJmpStatement *jmp) {
+        auto it = labels.find(jmp->label);
+        return it == labels.end() ? exit : it->second;
+    };
+    if (auto jmp = s->to<IR::DpdkJmpLabelStatement>())
+        return { target(jmp) };
+    if (auto jmp = s->to<IR::DpdkJmpStatement>())
+        return { target(jmp), index + 1 };
+    if (s->is<IR::DpdkReturnStatement>() || s->is<IR::DpdkTxStatement>() ||
+        s->is<IR::DpdkDropStatement>())
+        return { exit };
+    return { index + 1 };
+}
+
+void MetadataLiveness::analyze(const Instructions &stmts, const FieldSet &liveAtExit) {
+    std::map<cstring, size_t> labels;
+    for (size_t i = 0; i < stmts.size(); i++) {
+        if (auto label = stmts.at(i)->to<IR::DpdkLabelStatement>())
+            labels.emplace(label->label, i);
+    }
+
+    size_t count = stmts.size();
+    std::vector<FieldSet> uses(count), defs(count), in(count), out(count);
+    std::vector<std::vector<size_t>> succ(count);
+    for (size_t i = 0; i < count; i++) {
+        FieldSet clobbers;
+        access(stmts.at(i), uses[i], defs[i], clobbers);
+        if (auto apply = stmts.at(i)->to<IR::DpdkApplyStatement>()) {
+            auto it = tableActions.find(apply->table);
+            if (it != tableActions.end()) {
+                for (auto a : it->second) {
+                    auto &actionIn = liveIn(a->statements);
+                    uses[i].insert(actionIn.begin(), actionIn.end());
+                }
+            }
+        }
+        succ[i] = successors(stmts, i, labels);
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = count; i-- > 0;) {
+            FieldSet newOut;
+            for (auto j : succ[i]) {
+                auto &from = j == count ? liveAtExit : in[j];
+                newOut.insert(from.begin(), from.end());
+            }
+            FieldSet newIn = uses[i];
+            for (auto f : newOut) {
+                if (!defs[i].count(f))
+                    newIn.insert(f);
+            }
+            out[i] = newOut;
+            if (newIn != in[i]) {
+                in[i] = newIn;
+                changed = true;
+            }
+        }
+    }
+    liveOutMap[&stmts] = out;
+    liveInMap[&stmts] = count ? in[0] : liveAtExit;
+}
+
+const MetadataLiveness::FieldSet &
+MetadataLiveness::liveOut(const Instructions &stmts, size_t index) const {
+    return liveOutMap.at(&stmts).at(index);
+}
+
+const MetadataLiveness::FieldSet &MetadataLiveness::liveIn(const Instructions &stmts) const {
+    static const FieldSet empty;
+    auto it = liveInMap.find(&stmts);
+    return it == liveInMap.end() ? empty : it->second;
+}
+
+std::vector<const MetadataLiveness::Instructions *> MetadataLiveness::instructionLists() const {
+    std::vector<const Instructions *> result;
+    for (auto s : program->statements) {
+        if (auto l = s->to<IR::DpdkListStatement>())
+            result.push_back(&l->statements);
+    }
+    for (auto a : program->actions)
+        result.push_back(&a->statements);
+    return result;
+}
+
+MetadataLiveness::FieldSet MetadataLiveness::pinnedFields() const {
+    FieldSet result;
+    for (auto &kv : tableReads)
+        result.insert(kv.second.begin(), kv.second.end());
+    for (auto &kv : tableWrites)
+        result.insert(kv.second.begin(), kv.second.end());
+    for (auto &kv : learnArguments)
+        result.insert(kv.second.begin(), kv.second.end());
+    return result;
+}
+
+MetadataLiveness::FieldSet MetadataLiveness::learnArgumentFields() const {
+    FieldSet result;
+    for (auto &kv : learnArguments)
+        result.insert(kv.second.begin(), kv.second.end());
+    return result;
+}
+
+std::map<cstring, MetadataLiveness::FieldSet> MetadataLiveness::interference() const {
+    std::map<cstring, FieldSet> edges;
+    auto add = [&edges](cstring a, cstring b) {
+        if (a == b)
+            return;
+        edges[a].insert(b);
+        edges[b].insert(a);
+    };
+    for (auto stmts : instructionLists()) {
+        for (size_t i = 0; i < stmts->size(); i++) {
+            auto s = stmts->at(i);
+            FieldSet uses, defs, clobbers;
+            access(s, uses, defs, clobbers);
+            // The source and destination of a move hold the same value,
+            // so they can share storage.
+            cstring copied = nullptr;
+            if (auto mov = s->to<IR::DpdkMovStatement>())
+                copied = fieldName(mov->src);
+            auto &out = liveOut(*stmts, i);
+            for (auto d : defs) {
+                for (auto l : out) {
+                    if (l != copied)
+                        add(d, l);
+                }
+            }
+            defs.insert(clobbers.begin(), clobbers.end());
+            for (auto c : clobbers) {
+                for (auto l : out)
+                    add(c, l);
+                for (auto d : defs)
+                    add(c, d);
+            }
+        }
+    }
+    // Fields read before being written hold unrelated values on entry.
+    for (auto s : program->statements) {
+        if (auto l = s->to<IR::DpdkListStatement>()) {
+            auto &in = liveIn(l->statements);
+            for (auto a : in) {
+                for (auto b : in)
+                    add(a, b);
+            }
+        }
+    }
+    return edges;
+}
+
+const IR::Node *ShareMetadataSlots::preorder(IR::DpdkAsmProgram *p) {
+    slotOf.clear();
+    saved = 0;
+    auto metadata = getMetadataStruct(p);
+    if (!metadata)
+        return p;
+    MetadataLiveness liveness(p);
+    auto pinned = liveness.pinnedFields();
+    auto edges = liveness.interference();
+
+    // Greedy colouring in declaration order; a slot is named after its first field.
+    struct Slot {
+        cstring name;
+        unsigned width;
+        std::vector<cstring> fields;
+    };
+    std::vector<Slot> slots;
+    for (auto f : metadata->fields) {
+        auto name = f->name.name;
+        auto type = f->type->to<IR::Type_Bits>();
+        if (!type || !structure->local_variable_fields.count(name) || pinned.count(name))
+            continue;
+        unsigned width = type->width_bits();
+        auto &conflicts = edges[name];
+        bool shared = false;
+        for (auto &slot : slots) {
+            if (slot.width != width)
+                continue;
+            bool free = true;
+            for (auto other : slot.fields) {
+                if (conflicts.count(other)) {
+                    free = false;
+                    break;
+                }
+            }
+            if (free) {
+                slot.fields.push_back(name);
+                slotOf.emplace(name, slot.name);
+                saved += (width + 7) / 8;
+                shared = true;
+                break;
+            }
+        }
+        if (!shared)
+            slots.push_back({name, width, {name}});
+    }
+    LOG1("Sharing metadata slots saved " << saved << " bytes in " << metadata->name);
+    if (slotOf.empty())
+        return p;
+    for (auto &kv : slotOf)
+        LOG3("Metadata field " << kv.first << " stored in " << kv.second);
+
+    IR::IndexedVector<IR::StructField> fields;
+    for (auto f : metadata->fields) {
+        if (!slotOf.count(f->name.name))
+            fields.push_back(f);
+    }
+    IR::IndexedVector<IR::DpdkStructType> structs;
+    for (auto st : p->structType) {
+        if (st == metadata)
+            structs.push_back(new IR::DpdkStructType(st->srcInfo, st->name,
+                                                     st->annotations, fields));
+        else
+            structs.push_back(st);
+    }
+    p->structType = structs;
+    return p;
+}
+
+const IR::Node *ShareMetadataSlots::postorder(IR::Member *m) {
+    auto name = MetadataLiveness::fieldName(m);
+    if (!name || !slotOf.count(name))
+        return m;
+    return new IR::Member(m->srcInfo, m->expr, IR::ID(slotOf.at(name)));
+}
+
+const IR::Node *ShareMetadataSlots::postorder(IR::DpdkMovStatement *m) {
+    // Moves between fields sharing a slot are no-ops
+    if (m->dst->equiv(*m->src))
+        return nullptr;
+    return m;
+}
+
+bool DpdkDataflowOptimization::knownWidth(cstring field, unsigned width) const {
+    auto it = widths.find(field);
+    return it != widths.end() && it->second == width;
+}
+
+const IR::Expression *DpdkDataflowOptimization::value(const Values &values,
+                                                      const IR::Expression *e,
+                                                      bool allowConstant) const {
+    auto name = MetadataLiveness::fieldName(e);
+    if (!name)
+        return e;
+    auto it = values.find(name);
+    if (it == values.end())
+        return e;
+    if (!allowConstant && it->second->is<IR::Constant>())
+        return e;
+    return it->second;
+}
+
+const IR::DpdkAsmStatement *
+DpdkDataflowOptimization::substitute(const Values &values, const IR::DpdkAsmStatement *s) {
+    if (auto mov = s->to<IR::DpdkMovStatement>()) {
+        auto src = value(values, mov->src, true);
+        if (src != mov->src)
+            return new IR::DpdkMovStatement(mov->dst, src);
+    } else if (s->is<IR::DpdkAddStatement>() || s->is<IR::DpdkSubStatement>() ||
+               s->is<IR::DpdkAndStatement>() || s->is<IR::DpdkOrStatement>() ||
+               s->is<IR::DpdkXorStatement>() || s->is<IR::DpdkShlStatement>() ||
+               s->is<IR::DpdkShrStatement>()) {
+        // The first source is also the destination and cannot be replaced
+        auto binary = s->to<IR::DpdkBinaryStatement>();
+        auto src2 = value(values, binary->src2, true);
+        if (src2 != binary->src2) {
+            auto result = binary->clone();
+            result->src2 = src2;
+            return result;
+        }
+    } else if (auto jmp = s->to<IR::DpdkJmpCondStatement>()) {
+        // Only the second operand of a conditional jump may be an immediate
+        auto src1 = value(values, jmp->src1, false);
+        auto src2 = value(values, jmp->src2, true);
+        if (src1 != jmp->src1 || src2 != jmp->src2) {
+            auto result = jmp->clone();
+            result->src1 = src1;
+            result->src2 = src2;
+            return result;
+        }
+    }
+    return s;
+}
+
+void DpdkDataflowOptimization::transfer(const MetadataLiveness &liveness,
+                                        const IR::DpdkAsmStatement *s, Values &values) const {
+    // Any field may be written by the action run by a table
+    if (s->is<IR::DpdkApplyStatement>()) {
+        values.clear();
+        return;
+    }
+    MetadataLiveness::FieldSet uses, defs;
+    liveness.access(s, uses, defs, defs);
+    for (auto it = values.begin(); it != values.end();) {
+        auto source = MetadataLiveness::fieldName(it->second);
+        if (defs.count(it->first) || (source && defs.count(source)))
+            it = values.erase(it);
+        else
+            ++it;
+    }
+
+    auto mov = s->to<IR::DpdkMovStatement>();
+    if (!mov)
+        return;
+    auto dst = MetadataLiveness::fieldName(mov->dst);
+    if (!dst || !widths.count(dst))
+        return;
+    auto width = widths.at(dst);
+    if (auto src = MetadataLiveness::fieldName(mov->src)) {
+        if (src != dst && knownWidth(src, width))
+            values[dst] = mov->src;
+    } else if (auto c = mov->src->to<IR::Constant>()) {
+        if (c->value >= 0 && (c->value >> width) == 0)
+            values[dst] = c;
+    }
+}
+
+MetadataLiveness::Instructions
+DpdkDataflowOptimization::propagate(const MetadataLiveness &liveness,
+                                    const MetadataLiveness::Instructions &stmts) {
+    // Split the instructions into basic blocks: a block starts at a label and
+    // after an instruction which does not fall through to the next one.
+    std::map<cstring, size_t> labels;
+    std::vector<size_t> starts;
+    for (size_t i = 0; i < stmts.size(); i++) {
+        auto s = stmts.at(i);
+        if (auto label = s->to<IR::DpdkLabelStatement>())
+            labels.emplace(label->label, i);
+        if (i == 0 || s->is<IR::DpdkLabelStatement>() ||
+            stmts.at(i - 1)->is<IR::DpdkJmpStatement>() ||
+            stmts.at(i - 1)->is<IR::DpdkReturnStatement>() ||
+            stmts.at(i - 1)->is<IR::DpdkTxStatement>() ||
+            stmts.at(i - 1)->is<IR::DpdkDropStatement>())
+            starts.push_back(i);
+    }
+    size_t count = starts.size();
+    std::map<size_t, size_t> blockAt;
+    for (size_t b = 0; b < count; b++)
+        blockAt.emplace(starts[b], b);
+    auto blockEnd = [&](size_t b) { return b + 1 < count ? starts[b + 1] : stmts.size(); };
+
+    // Forward analysis of the values held by metadata fields on entry to each
+    // block; a fact holds if it holds at the end of every predecessor.
+    std::vector<Values> in(count);
+    std::vector<bool> reached(count, false);
+    if (count > 0)
+        reached[0] = true;
+    bool changedIn = true;
+    while (changedIn) {
+        changedIn = false;
+        for (size_t b = 0; b < count; b++) {
+            if (!reached[b])
+                continue;
+            Values values = in[b];
+            for (size_t i = starts[b]; i < blockEnd(b); i++)
+                transfer(liveness, substitute(values, stmts.at(i)), values);
+            auto last = blockEnd(b) - 1;
+            for (auto next : MetadataLiveness::successors(stmts, last, labels)) {
+                auto it = blockAt.find(next);
+                if (it == blockAt.end())
+                    continue;
+                auto succ = it->second;
+                if (!reached[succ]) {
+                    reached[succ] = true;
+                    in[succ] = values;
+                    changedIn = true;
+                    continue;
+                }
+                for (auto v = in[succ].begin(); v != in[succ].end();) {
+                    auto other = values.find(v->first);
+                    if (other == values.end() || !other->second->equiv(*v->second)) {
+                        v = in[succ].erase(v);
+                        changedIn = true;
+                    } else {
+                        ++v;
+                    }
+                }
+            }
+        }
+    }
+
+    MetadataLiveness::Instructions result;
+    for (size_t b = 0; b < count; b++) {
+        if (!reached[b]) {
+            for (size_t i = starts[b]; i < blockEnd(b); i++)
+                result.push_back(stmts.at(i));
+            continue;
+        }
+        Values values = in[b];
+        for (size_t i = starts[b]; i < blockEnd(b); i++) {
+            auto s = substitute(values, stmts.at(i));
+            if (auto mov = s->to<IR::DpdkMovStatement>()) {
+                // The destination already holds the value being moved
+                auto dst = MetadataLiveness::fieldName(mov->dst);
+                auto known = dst ? values.find(dst) : values.end();
+                if (mov->dst->equiv(*mov->src) ||
+                    (known != values.end() && known->second->equiv(*mov->src))) {
+                    LOG3("Removing redundant " << stmts.at(i));
+                    changed = true;
+                    continue;
+                }
+            }
+            if (s != stmts.at(i))
+                changed = true;
+            result.push_back(s);
+            transfer(liveness, s, values);
+        }
+    }
+    return result;
+}
+
+MetadataLiveness::Instructions
+DpdkDataflowOptimization::removeDeadStores(const MetadataLiveness &liveness,
+                                           const MetadataLiveness::Instructions &stmts) {
+    MetadataLiveness::Instructions result;
+    for (size_t i = 0; i < stmts.size(); i++) {
+        auto s = stmts.at(i);
+        const IR::Expression *dst = nullptr;
+        if (auto u = s->to<IR::DpdkUnaryStatement>())
+            dst = u->dst;
+        else if (auto b = s->to<IR::DpdkBinaryStatement>())
+            dst = b->dst;
+        else if (auto c = s->to<IR::DpdkCastStatement>())
+            dst = c->dst;
+        auto name = dst ? MetadataLiveness::fieldName(dst) : cstring();
+        // Other metadata fields may be read after the pipeline
+        if (name && structure->local_variable_fields.count(name) &&
+            !liveness.liveOut(stmts, i).count(name)) {
+            LOG3("Removing dead store " << s);
+            changed = true;
+            continue;
+        }
+        result.push_back(s);
+    }
+    return result;
+}
+
+void DpdkDataflowOptimization::rewrite(IR::DpdkAsmProgram *p, bool deadStores) {
+    MetadataLiveness liveness(p);
+    auto rewriteList = [&](const MetadataLiveness::Instructions &stmts) {
+        return deadStores ? removeDeadStores(liveness, stmts) : propagate(liveness, stmts);
+    };
+    IR::IndexedVector<IR::DpdkAsmStatement> statements;
+    for (auto s : p->statements) {
+        if (auto l = s->to<IR::DpdkListStatement>()) {
+            auto list = l->clone();
+            list->statements = rewriteList(l->statements);
+            statements.push_back(list);
+        } else {
+            statements.push_back(s);
+        }
+    }
+    IR::IndexedVector<IR::DpdkAction> actions;
+    for (auto a : p->actions) {
+        auto action = a->clone();
+        action->statements = rewriteList(a->statements);
+        actions.push_back(action);
+    }
+    p->statements = statements;
+    p->actions = actions;
+}
+
+const IR::Node *DpdkDataflowOptimization::preorder(IR::DpdkAsmProgram *p) {
+    prune();
+    widths.clear();
+    auto metadata = getMetadataStruct(p);
+    if (!metadata)
+        return p;
+    for (auto f : metadata->fields) {
+        if (auto type = f->type->to<IR::Type_Bits>())
+            widths.emplace(f->name.name, type->width_bits());
+    }
+    // Removing stores can make moves redundant and propagating copies can
+    // make stores dead, so repeat both until nothing changes.
+    do {
+        changed = false;
+        rewrite(p, false);
+        rewrite(p, true);
+    } while (changed);
+    return p;
+}
+
+unsigned LayoutMetadataForKeys::keySize(const IR::IndexedVector<IR::StructField> &fields,
+                                        const std::vector<cstring> &key) {
+    std::set<cstring> keyFields(key.begin(), key.end());
+    unsigned offset = 0, start = 0, end = 0;
+    bool found = false;
+    for (auto f : fields) {
+        // bool and error fields are stored as bit<8>
+        auto width = f->type->is<IR::Type_Bits>() ? f->type->width_bits() : 8;
+        if (keyFields.count(f->name.name)) {
+            if (!found)
+                start = offset;
+            found = true;
+            end = offset + width;
+        }
+        offset += width;
+    }
+    return (end - start + 7) / 8;
+}
+
+const IR::Node *LayoutMetadataForKeys::preorder(IR::DpdkAsmProgram *p) {
+    prune();
+    auto metadata = getMetadataStruct(p);
+    if (!metadata)
+        return p;
+    auto learnArguments = MetadataLiveness(p).learnArgumentFields();
+
+    std::vector<std::pair<cstring, std::vector<cstring>>> keys;
+    auto addKey = [&](cstring table, const IR::Key *key) {
+        if (!key)
+            return;
+        std::vector<cstring> fields;
+        for (auto ke : key->keyElements) {
+            auto name = MetadataLiveness::fieldName(ke->expression);
+            if (!name || !metadata->fields.getDeclaration(name))
+                return;
+            fields.push_back(name);
+        }
+        if (!fields.empty())
+            keys.emplace_back(table, fields);
+    };
+    for (auto t : p->tables)
+        addKey(t->name, t->match_keys);
+    for (auto t : p->learners)
+        addKey(t->name, t->match_keys);
+    for (auto t : p->selectors)
+        addKey(t->name, t->selectors);
+
+    // Each group is a run of fields to be stored in this order. A key using
+    // fields which are already in a group, or learn arguments, is not
+    // grouped; the size check below tells whether its fields ended up
+    // further apart.
+    std::vector<std::vector<cstring>> groups;
+    std::map<cstring, size_t> groupOf;
+    for (auto &key : keys) {
+        auto &fields = key.second;
+        std::set<cstring> distinct(fields.begin(), fields.end());
+        bool fresh = distinct.size() == fields.size();
+        for (auto f : fields) {
+            if (groupOf.count(f) || learnArguments.count(f))
+                fresh = false;
+        }
+        if (!fresh)
+            continue;
+        for (auto f : fields)
+            groupOf.emplace(f, groups.size());
+        groups.push_back(fields);
+    }
+    if (groups.empty())
+        return p;
+
+    // Place each group where its first field was declared.
+    IR::IndexedVector<IR::StructField> fields;
+    std::set<size_t> placed;
+    for (auto f : metadata->fields) {
+        auto it = groupOf.find(f->name.name);
+        if (it == groupOf.end()) {
+            fields.push_back(f);
+            continue;
+        }
+        if (!placed.insert(it->second).second)
+            continue;
+        for (auto name : groups[it->second])
+            fields.push_back(metadata->fields.getDeclaration<IR::StructField>(name));
+    }
+    BUG_CHECK(fields.size() == metadata->fields.size(), "%1%: metadata fields lost", metadata);
+
+    unsigned before = 0, after = 0;
+    for (auto &key : keys) {
+        auto oldSize = keySize(metadata->fields, key.second);
+        auto newSize = keySize(fields, key.second);
+        LOG2("Key of " << key.first << ": " << oldSize << " bytes, " << newSize <<
+             " bytes with the key-aware layout");
+        before += oldSize;
+        after += newSize;
+    }
+    if (after >= before) {
+        LOG1("Key-aware layout does not reduce the key size of " << metadata->name);
+        return p;
+    }
+    LOG1("Key-aware layout reduced the key size of " << metadata->name << " from " <<
+         before << " to " << after << " bytes");
+
+    IR::IndexedVector<IR::DpdkStructType> structs;
+    for (auto st : p->structType) {
+        if (st == metadata)
+            structs.push_back(new IR::DpdkStructType(st->srcInfo, st->name,
+                                                     st->annotations, fields));
+        else
+            structs.push_back(st);
+    }
+    p->structType = structs;
+    return p;
+}
+
+std::map<cstring, double>
+LayoutMetadataByAccess::staticWeights(const IR::DpdkAsmProgram *p) const {
+    MetadataLiveness liveness(p);
+    std::map<cstring, double> weights;
+    std::map<cstring, double> actionWeights;
+
+    std::map<cstring, const IR::ActionList *> tableActions;
+    for (auto t : p->tables)
+        tableActions.emplace(t->name, t->actions);
+    for (auto t : p->learners)
+        tableActions.emplace(t->name, t->actions);
+
+    // Weight of each instruction in a list, from the jumps around it
+    auto instructionWeights = [](const MetadataLiveness::Instructions &stmts, double entry) {
+        std::map<cstring, size_t> labels;
+        for (size_t i = 0; i < stmts.size(); i++) {
+            if (auto label = stmts.at(i)->to<IR::DpdkLabelStatement>())
+                labels.emplace(label->label, i);
+        }
+        std::vector<double> result(stmts.size(), entry);
+        for (size_t i = 0; i < stmts.size(); i++) {
+            auto jmp = stmts.at(i)->to<IR::DpdkJmpStatement>();
+            if (!jmp || !labels.count(jmp->label))
+                continue;
+            auto target = labels.at(jmp->label);
+            if (target <= i) {
+                for (size_t j = target; j <= i; j++)
+                    result[j] *= 2;
+            } else if (!jmp->is<IR::DpdkJmpLabelStatement>()) {
+                for (size_t j = i + 1; j < target; j++)
+                    result[j] /= 2;
+            }
+        }
+        return result;
+    };
+    auto count = [&](const MetadataLiveness::Instructions &stmts,
+                     const std::vector<double> &stmtWeights) {
+        for (size_t i = 0; i < stmts.size(); i++) {
+            MetadataLiveness::FieldSet fields;
+            liveness.access(stmts.at(i), fields, fields, fields);
+            for (auto f : fields)
+                weights[f] += stmtWeights[i];
+        }
+    };
+
+    for (auto s : p->statements) {
+        auto l = s->to<IR::DpdkListStatement>();
+        if (!l)
+            continue;
+        auto stmtWeights = instructionWeights(l->statements, 1.0);
+        count(l->statements, stmtWeights);
+        for (size_t i = 0; i < l->statements.size(); i++) {
+            auto apply = l->statements.at(i)->to<IR::DpdkApplyStatement>();
+            if (!apply || !tableActions.count(apply->table))
+                continue;
+            auto actions = tableActions.at(apply->table)->actionList;
+            for (auto ale : actions) {
+                if (auto name = actionName(ale))
+                    actionWeights[name] += stmtWeights[i] / actions.size();
+            }
+        }
+    }
+    for (auto a : p->actions) {
+        auto it = actionWeights.find(a->name.name);
+        if (it != actionWeights.end())
+            count(a->statements, instructionWeights(a->statements, it->second));
+    }
+    return weights;
+}
+
+std::map<cstring, double> LayoutMetadataByAccess::readProfile() const {
+    std::map<cstring, double> weights;
+    std::ifstream in(profileFile);
+    if (!in) {
+        ::error(ErrorType::ERR_IO, "Failed to open metadata profile %1%", profileFile);
+        return weights;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        double count;
+        if (!(fields >> name) || name[0] == '#')
+            continue;
+        if (!(fields >> count)) {
+            ::error(ErrorType::ERR_INVALID, "%1%: expected '<field> <count>' in line '%2%'",
+                    profileFile, line);
+            return weights;
+        }
+        weights[name] = count;
+    }
+    return weights;
+}
+
+const IR::Node *LayoutMetadataByAccess::preorder(IR::DpdkAsmProgram *p) {
+    prune();
+    auto metadata = getMetadataStruct(p);
+    if (!metadata)
+        return p;
+    // Measured counts and static estimates are not on the same scale, so a
+    // profile replaces the estimates; fields it does not list are cold.
+    auto weights = profileFile ? readProfile() : staticWeights(p);
+
+    std::map<cstring, size_t> firstAccess;
+    size_t index = 0;
+    auto visit = [&](const IR::Node *n) {
+        MetadataLiveness::FieldSet fields;
+        collectFields(n, fields);
+        for (auto f : fields)
+            firstAccess.emplace(f, index);
+        index++;
+    };
+    for (auto s : p->statements) {
+        if (auto l = s->to<IR::DpdkListStatement>()) {
+            for (auto i : l->statements)
+                visit(i);
+        }
+    }
+    for (auto a : p->actions) {
+        for (auto i : a->statements)
+            visit(i);
+    }
+
+    // Learn arguments are consecutive in the struct and the metadata fields
+    // of a lookup key are read together, so each of them moves as one unit,
+    // with the weight of its hottest field.
+    struct Unit {
+        std::vector<const IR::StructField *> fields;
+        double weight = 0;
+        size_t first = std::numeric_limits<size_t>::max();
+        size_t position = std::numeric_limits<size_t>::max();
+    };
+    std::map<cstring, size_t> position;
+    for (auto f : metadata->fields)
+        position.emplace(f->name.name, position.size());
+    std::vector<Unit> units;
+    std::map<cstring, size_t> unitOf;
+    auto add = [&](const IR::StructField *f) {
+        auto name = f->name.name;
+        unitOf.emplace(name, units.size() - 1);
+        auto &unit = units.back();
+        unit.fields.push_back(f);
+        unit.weight = std::max(unit.weight, weights.count(name) ? weights.at(name) : 0.0);
+        if (firstAccess.count(name))
+            unit.first = std::min(unit.first, firstAccess.at(name));
+        unit.position = std::min(unit.position, position.at(name));
+    };
+
+    auto learnArguments = MetadataLiveness(p).learnArgumentFields();
+    bool inLearnRun = false;
+    for (auto f : metadata->fields) {
+        bool learn = learnArguments.count(f->name.name) > 0;
+        if (learn && !inLearnRun)
+            units.emplace_back();
+        if (learn)
+            add(f);
+        inLearnRun = learn;
+    }
+    auto addKey = [&](const IR::Key *key) {
+        if (!key)
+            return;
+        std::vector<const IR::StructField *> fields;
+        for (auto ke : key->keyElements) {
+            auto name = MetadataLiveness::fieldName(ke->expression);
+            if (!name || unitOf.count(name))
+                continue;
+            if (auto f = metadata->fields.getDeclaration<IR::StructField>(name)) {
+                if (std::find(fields.begin(), fields.end(), f) == fields.end())
+                    fields.push_back(f);
+            }
+        }
+        if (fields.empty())
+            return;
+        units.emplace_back();
+        for (auto f : fields)
+            add(f);
+    };
+    for (auto t : p->tables)
+        addKey(t->match_keys);
+    for (auto t : p->learners)
+        addKey(t->match_keys);
+    for (auto t : p->selectors)
+        addKey(t->selectors);
+    for (auto f : metadata->fields) {
+        if (unitOf.count(f->name.name))
+            continue;
+        units.emplace_back();
+        add(f);
+    }
+    std::stable_sort(units.begin(), units.end(), [](const Unit &a, const Unit &b) {
+        if (a.weight != b.weight)
+            return a.weight > b.weight;
+        if (a.first != b.first)
+            return a.first < b.first;
+        return a.position < b.position;
+    });
+
+    // Fields starting in the first 64 bytes share the first cache line
+    IR::IndexedVector<IR::StructField> fields;
+    unsigned offset = 0, hotFields = 0;
+    for (auto &unit : units) {
+        for (auto f : unit.fields) {
+            LOG3("Metadata field " << f->name << " weight " << unit.weight);
+            fields.push_back(f);
+            if (offset < 64 * 8)
+                hotFields++;
+            offset += f->type->width_bits();
+        }
+    }
+    LOG1(hotFields << " hottest fields of " << metadata->name << " in the first cache line");
+
+    IR::IndexedVector<IR::DpdkStructType> structs;
+    for (auto st : p->structType) {
+        if (st == metadata)
+            structs.push_back(new IR::DpdkStructType(st->srcInfo, st->name,
+                                                     st->annotations, fields));
+        else
+            structs.push_back(st);
+    }
+    p->structType = structs;
+    return p;
+}
+
 }  // namespace DPDK
@@ -29,6 +29,7 @@ limitations under the License.
 #include "ir/ir.h"
 #include "lib/gmputil.h"
 #include "lib/json.h"
+#include "dpdkProgramStructure.h"
 namespace DPDK {
 // This pass removes label that no jmps jump to
 class RemoveRedundantLabel : public Transform {
@@ -159,6 +160,147 @@ class RemoveUnusedMetadataFields : public Transform {
     const IR::Node* preorder(IR::DpdkAsmProgram *p) override;
 };
 
+// Liveness of metadata fields over the instructions of the apply block and of
+// all actions. A "table" instruction reads the keys of the table and runs one
+// of its actions; the actions are analyzed with the fields live after any of
+// the instructions applying them. Fields are identified by their name in the
+// metadata struct.
+class MetadataLiveness {
+ public:
+    typedef std::set<cstring> FieldSet;
+    typedef IR::IndexedVector<IR::DpdkAsmStatement> Instructions;
+
+ private:
+    const IR::DpdkAsmProgram *program;
+    // learn instructions read the action arguments from consecutive fields
+    std::map<cstring, FieldSet> learnArguments;
+    std::map<const Instructions *, std::vector<FieldSet>> liveOutMap;
+    std::map<const Instructions *, FieldSet> liveInMap;
+    std::map<cstring, const IR::DpdkAction *> actions;
+    std::map<cstring, FieldSet> tableReads;
+    std::map<cstring, FieldSet> tableWrites;
+    std::map<cstring, std::vector<const IR::DpdkAction *>> tableActions;
+
+    void collectTables();
+    void analyze(const Instructions &stmts, const FieldSet &liveAtExit);
+
+ public:
+    explicit MetadataLiveness(const IR::DpdkAsmProgram *program);
+
+    // Name of the metadata field an expression refers to, nullptr otherwise.
+    static cstring fieldName(const IR::Expression *e);
+    // Indices of the instructions that may run after stmts[index];
+    // stmts.size() stands for the exit of the instruction list.
+    static std::vector<size_t> successors(const Instructions &stmts, size_t index,
+                                          const std::map<cstring, size_t> &labels);
+    // The fields an instruction reads (uses), overwrites (defs) and may
+    // write (clobbers). Actions applied by tables are not included.
+    void access(const IR::DpdkAsmStatement *s, FieldSet &uses, FieldSet &defs,
+                FieldSet &clobbers) const;
+    const FieldSet &liveOut(const Instructions &stmts, size_t index) const;
+    const FieldSet &liveIn(const Instructions &stmts) const;
+    // All instruction lists: the apply block first, then the actions.
+    std::vector<const Instructions *> instructionLists() const;
+    // Fields read by the match keys of tables, learners and selectors, the
+    // selector group and member ids and the arguments of learn instructions.
+    // Their names and relative positions are visible outside the program.
+    FieldSet pinnedFields() const;
+    // Fields read by learn instructions; they must stay consecutive.
+    FieldSet learnArgumentFields() const;
+    // Pairs of fields which cannot share storage.
+    std::map<cstring, FieldSet> interference() const;
+};
+
+// This pass lets metadata fields holding local variables share storage when
+// their live ranges do not overlap and they have the same width, like a
+// register allocator colouring an interference graph. The fields are renamed
+// to the first field of their slot and the unused fields are removed from
+// the metadata struct.
+class ShareMetadataSlots : public Transform {
+    const DpdkProgramStructure *structure;
+    std::map<cstring, cstring> slotOf;
+    unsigned saved = 0;
+ public:
+    explicit ShareMetadataSlots(const DpdkProgramStructure *structure) : structure(structure) {}
+    // Bytes removed from the metadata struct by the last run.
+    unsigned savedBytes() const { return saved; }
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override;
+    const IR::Node *postorder(IR::Member *m) override;
+    const IR::Node *postorder(IR::DpdkMovStatement *m) override;
+};
+
+// This pass splits the apply block and the actions into basic blocks and
+// propagates the values of metadata fields copied by "mov" instructions:
+// a field known to hold a constant or a copy of another field of the same
+// width is replaced by that value where an instruction reads it. Moves
+// which do not change their destination and instructions writing a local
+// variable field which is not live afterwards are removed.
+class DpdkDataflowOptimization : public Transform {
+ public:
+    typedef std::map<cstring, const IR::Expression *> Values;
+
+ private:
+    const DpdkProgramStructure *structure;
+    std::map<cstring, unsigned> widths;
+    bool changed = false;
+
+    bool knownWidth(cstring field, unsigned width) const;
+    const IR::Expression *value(const Values &values, const IR::Expression *e,
+                                bool allowConstant) const;
+    const IR::DpdkAsmStatement *substitute(const Values &values,
+                                           const IR::DpdkAsmStatement *s);
+    void transfer(const MetadataLiveness &liveness, const IR::DpdkAsmStatement *s,
+                  Values &values) const;
+    MetadataLiveness::Instructions propagate(const MetadataLiveness &liveness,
+                                             const MetadataLiveness::Instructions &stmts);
+    MetadataLiveness::Instructions removeDeadStores(const MetadataLiveness &liveness,
+                                                    const MetadataLiveness::Instructions &stmts);
+    void rewrite(IR::DpdkAsmProgram *p, bool deadStores);
+
+ public:
+    explicit DpdkDataflowOptimization(const DpdkProgramStructure *structure)
+        : structure(structure) {}
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override;
+};
+
+// This pass reorders the metadata struct so that the match key fields of each
+// table, learner and selector are stored next to each other, in key order.
+// The pipeline builds a lookup key from all the bytes between the first and
+// the last of its fields, masking out the fields in between, so the reordering
+// shrinks the keys hashed on each lookup and stored in each entry. Each field
+// is moved by the first key using it; keys containing header fields and the
+// arguments of learn instructions are left in place. The new order is kept
+// only if it reduces the total size of the keys.
+class LayoutMetadataForKeys : public Transform {
+ public:
+    // Size in bytes of a key made of the given fields: the span from the
+    // first to the last of them in the struct.
+    static unsigned keySize(const IR::IndexedVector<IR::StructField> &fields,
+                            const std::vector<cstring> &key);
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override;
+};
+
+// This pass reorders the metadata struct so that the most frequently accessed
+// fields come first and share the first cache line. Each instruction counts
+// one access to the fields it refers to, weighted by its position in the
+// control flow: instructions skipped by a conditional jump count half as much,
+// instructions inside a loop twice as much, and an action counts the weight
+// of the table applying it divided by the number of actions of the table.
+// A profile ("<field> <count>" per line) is used instead of these estimates
+// when one is given. The fields of a lookup key and the arguments of a learn
+// instruction are accessed together and move as one unit; other fields with
+// equal weights keep the order of their first access.
+class LayoutMetadataByAccess : public Transform {
+    cstring profileFile;
+
+    std::map<cstring, double> staticWeights(const IR::DpdkAsmProgram *p) const;
+    std::map<cstring, double> readProfile() const;
+
+ public:
+    explicit LayoutMetadataByAccess(cstring profileFile) : profileFile(profileFile) {}
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override;
+};
+
 // Instructions can only appear in actions and apply block of .spec file.
 // All these individual passes work on the actions and apply block of .spec file.
 class DpdkAsmOptimization : public PassRepeated {
@@ -50,6 +50,8 @@ struct DpdkProgramStructure {
     cstring local_metadata_type;
     cstring header_type;
     IR::IndexedVector<IR::StructField> compiler_added_fields;
+    // metadata fields holding control and parser local variables
+    ordered_set<cstring> local_variable_fields;
     IR::Vector<IR::Type> used_metadata;
     ordered_map<cstring, std::vector<struct hdrFieldInfo>> hdrFieldInfoList;
 
@@ -32,6 +32,7 @@ limitations under the License.
 #include "frontends/p4/frontend.h"
 #include "ir/ir.h"
 #include "ir/json_loader.h"
+#include "lib/compile_server.h"
 #include "lib/error.h"
 #include "lib/exceptions.h"
 #include "lib/exename.h"
@@ -39,9 +40,7 @@ limitations under the License.
 #include "lib/log.h"
 #include "lib/nullstream.h"
 
-int main(int argc, char *const argv[]) {
-    setup_gc_logging();
-
+static int compile(int argc, char *const argv[]) {
     AutoCompileContext autoDpdkContext(new DPDK::DpdkContext);
     auto &options = DPDK::DpdkContext::get().options();
     options.langVersion = CompilerOptions::FrontendVersion::P4_16;
@@ -149,3 +148,11 @@ int main(int argc, char *const argv[]) {
 
     return ::errorCount() > 0;
 }
+
+int main(int argc, char *const argv[]) {
+    setup_gc_logging();
+
+    if (Util::CompileServer::requested(argc, argv))
+        return Util::CompileServer::serve(argc, argv, compile);
+    return compile(argc, argv);
+}
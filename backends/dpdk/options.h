@@ -34,6 +34,17 @@ class DpdkOptions : public CompilerOptions {
     static cstring DpdkCompCmd;
     // Enable/Disable Egress pipeline in psa
     bool enableEgress = false;
+    // Let metadata fields holding local variables with disjoint
+    // live ranges share storage
+    bool shareMetadataSlots = false;
+    // Propagate copies and constants and remove dead stores in the
+    // generated instructions
+    bool dataflowOpt = false;
+    // Order of the fields in the metadata struct
+    enum class MetadataLayout { DEFAULT, KEY_AWARE, HOT_FIRST };
+    MetadataLayout metadataLayout = MetadataLayout::DEFAULT;
+    // Field access counts used by the hot-first metadata layout
+    cstring metadataProfile = nullptr;
 
     DpdkOptions() {
         registerOption(
@@ -66,6 +77,37 @@ class DpdkOptions : public CompilerOptions {
                 [this](const char* arg) { loadIRFromJson = true; file = arg; return true; },
                 "Use IR representation from JsonFile dumped previously,"\
                 "the compilation starts with reduced midEnd.");
+        registerOption("--share-metadata-slots", nullptr,
+                [this](const char *) { shareMetadataSlots = true; return true; },
+                "[Dpdk back-end] Store local variables whose live ranges do not\n"
+                "overlap in the same metadata field");
+        registerOption("--dataflow-opt", nullptr,
+                [this](const char *) { dataflowOpt = true; return true; },
+                "[Dpdk back-end] Propagate copies and constants and remove dead\n"
+                "stores and redundant moves in the generated instructions");
+        registerOption("--metadata-layout", "{default,key-aware,hot-first}",
+                [this](const char *arg) {
+                    if (!strcmp(arg, "default")) {
+                        metadataLayout = MetadataLayout::DEFAULT;
+                    } else if (!strcmp(arg, "key-aware")) {
+                        metadataLayout = MetadataLayout::KEY_AWARE;
+                    } else if (!strcmp(arg, "hot-first")) {
+                        metadataLayout = MetadataLayout::HOT_FIRST;
+                    } else {
+                        ::error(ErrorType::ERR_INVALID, "Illegal metadata layout %1%", arg);
+                        return false;
+                    }
+                    return true;
+                },
+                "[Dpdk back-end] Order of the metadata fields: default keeps the\n"
+                "declaration order, key-aware stores the match key fields of each\n"
+                "table contiguously and in key order, hot-first stores the most\n"
+                "frequently accessed fields first");
+        registerOption("--metadata-profile", "file",
+                [this](const char *arg) { metadataProfile = arg; return true; },
+                "[Dpdk back-end] Read the access count of metadata fields from file\n"
+                "(one '<field> <count>' per line) for the hot-first metadata layout,\n"
+                "instead of estimating them; unlisted fields count as never accessed");
     }
 
     /// Process the command line arguments and set options accordingly.
@@ -109,12 +109,13 @@ bool CodeGenInspector::comparison(const IR::Operation_Relation* b) {
     } else {
         if (!et->is<IHasWidth>())
             BUG("%1%: Comparisons for type %2% not yet implemented", type);
+        // memcmp returns 0 for equal values
         unsigned width = et->to<IHasWidth>()->implementationWidthInBits();
-        builder->append("memcmp(&");
+        builder->append("(memcmp(&");
         visit(b->left);
         builder->append(", &");
         visit(b->right);
-        builder->appendFormat(", %d)", width / 8);
+        builder->appendFormat(", %d) %s 0)", width / 8, b->getStringOp().c_str());
     }
     return false;
 }
@@ -77,12 +77,13 @@ void run_ebpf_backend(const EbpfOptions& options, const IR::ToplevelBlock* tople
     if (hstream == nullptr)
         return;
 
+    // The code is written to the files as it is generated.
+    c.setOutput(cstream);
+    h.setOutput(hstream);
     ebpfprog->emitH(&h, hfile);
     ebpfprog->emitC(&c, hfile);
-    *cstream << c.toString();
-    *hstream << h.toString();
-    cstream->flush();
-    hstream->flush();
+    c.flush();
+    h.flush();
 }
 
 }  // namespace EBPF
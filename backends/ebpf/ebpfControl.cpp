@@ -581,6 +581,8 @@ void EBPFControl::emitTableInstances(CodeBuilder* builder) {
 void EBPFControl::emitTableInitializers(CodeBuilder* builder) {
     for (auto it : tables)
         it.second->emitInitializer(builder);
+    for (auto it : counters)
+        it.second->emitInitializer(builder);
 }
 
 }  // namespace EBPF
@@ -16,9 +16,66 @@ limitations under the License.
 */
 
 #include "ebpfDeparser.h"
+#include "ebpfParser.h"
 
 namespace EBPF {
 
+bool FindModifiedHeaderFields::containsHeaders(const IR::Type* type) const {
+    if (type->is<IR::Type_Header>() || type->is<IR::Type_HeaderUnion>() ||
+        type->is<IR::Type_Stack>())
+        return true;
+    if (auto st = type->to<IR::Type_StructLike>()) {
+        for (auto f : st->fields) {
+            auto ftype = typeMap->getType(f);
+            if (ftype != nullptr && containsHeaders(ftype))
+                return true;
+        }
+    }
+    return false;
+}
+
+void FindModifiedHeaderFields::markWritten(const IR::Expression* expression) {
+    while (auto slice = expression->to<IR::Slice>())
+        expression = slice->e0;
+    if (auto member = expression->to<IR::Member>()) {
+        auto parentType = typeMap->getType(member->expr, true);
+        if (auto ht = parentType->to<IR::Type_Header>()) {
+            fields.emplace(ht->name.name, member->member.name);
+            return;
+        }
+    }
+    // Whole headers, stacks or structures containing them may change validity.
+    auto type = typeMap->getType(expression, true);
+    if (containsHeaders(type))
+        validityChanged = true;
+}
+
+bool FindModifiedHeaderFields::preorder(const IR::AssignmentStatement* statement) {
+    markWritten(statement->left);
+    return true;
+}
+
+bool FindModifiedHeaderFields::preorder(const IR::MethodCallExpression* expression) {
+    auto mi = P4::MethodInstance::resolve(expression, refMap, typeMap);
+    if (auto bim = mi->to<P4::BuiltInMethod>()) {
+        if (bim->name != IR::Type_Header::isValid)
+            validityChanged = true;
+        return true;
+    }
+    if (auto em = mi->to<P4::ExternMethod>()) {
+        // extract() initializes the headers the deparser may leave in place
+        if (em->originalExternType->name.name == P4::P4CoreLibrary::instance.packetIn.name)
+            return true;
+    }
+    for (auto p : *mi->substitution.getParametersInArgumentOrder()) {
+        if (p->direction == IR::Direction::Out || p->direction == IR::Direction::InOut)
+            markWritten(mi->substitution.lookup(p)->expression);
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////
+
 DeparserBodyTranslator::DeparserBodyTranslator(const EBPFDeparser *deparser) :
         ControlBodyTranslator(deparser), deparser(deparser) {
     setName("DeparserBodyTranslator");
@@ -143,19 +200,20 @@ void DeparserHdrEmitTranslator::processMethod(const P4::ExternMethod *method) {
             builder->blockEnd(true);
             builder->emitIndent();
             builder->newline();
-            unsigned alignment = 0;
-            for (auto f : headerToEmit->fields) {
-                auto ftype = deparser->program->typeMap->getType(f);
-                auto etype = EBPFTypeFactory::instance->create(ftype);
-                auto et = dynamic_cast<EBPF::IHasWidth *>(etype);
-                if (et == nullptr) {
-                    ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
-                            "Only headers with fixed widths supported %1%", f);
-                    return;
-                }
-                emitField(builder, f->name, expr, alignment, etype);
-                alignment += et->widthInBits();
-                alignment %= 8;
+            if (deparser->inPlaceEmit) {
+                builder->emitIndent();
+                builder->appendFormat("if (%s == 0) ", deparser->outerHdrOffsetVar.c_str());
+                builder->blockStart();
+                builder->emitIndent();
+                builder->appendLine("/* header is at its parsed offset */");
+                emitFields(builder, headerToEmit, expr, true);
+                builder->blockEnd(false);
+                builder->append(" else ");
+                builder->blockStart();
+                emitFields(builder, headerToEmit, expr, false);
+                builder->blockEnd(true);
+            } else {
+                emitFields(builder, headerToEmit, expr, false);
             }
             builder->blockEnd(true);
         } else {
@@ -166,6 +224,43 @@ void DeparserHdrEmitTranslator::processMethod(const P4::ExternMethod *method) {
     }
 }
 
+void DeparserHdrEmitTranslator::emitFields(CodeBuilder* builder,
+                                           const IR::Type_Header* headerToEmit,
+                                           const IR::Expression* hdrExpr, bool modifiedOnly) {
+    auto program = deparser->program;
+    unsigned alignment = 0;
+    unsigned skipped = 0;
+    for (auto f : headerToEmit->fields) {
+        auto ftype = program->typeMap->getType(f);
+        auto etype = EBPFTypeFactory::instance->create(ftype);
+        auto et = dynamic_cast<EBPF::IHasWidth *>(etype);
+        if (et == nullptr) {
+            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                    "Only headers with fixed widths supported %1%", f);
+            return;
+        }
+        if (modifiedOnly && !deparser->modifiedFields->isModified(headerToEmit, f->name)) {
+            // the packet already holds the parsed value of this field
+            skipped += et->widthInBits();
+        } else {
+            if (skipped != 0) {
+                builder->emitIndent();
+                builder->appendFormat("%s += %d", program->offsetVar.c_str(), skipped);
+                builder->endOfStatement(true);
+                skipped = 0;
+            }
+            emitField(builder, f->name, hdrExpr, alignment, etype);
+        }
+        alignment += et->widthInBits();
+        alignment %= 8;
+    }
+    if (skipped != 0) {
+        builder->emitIndent();
+        builder->appendFormat("%s += %d", program->offsetVar.c_str(), skipped);
+        builder->endOfStatement(true);
+    }
+}
+
 void DeparserHdrEmitTranslator::emitField(CodeBuilder* builder, cstring field,
                                           const IR::Expression* hdrExpr, unsigned int alignment,
                                           EBPF::EBPFType* type) {
@@ -330,8 +425,110 @@ void EBPFDeparser::emitBufferAdjusts(CodeBuilder *builder) const {
     builder->blockEnd(true);
 }
 
+// Header instances are identified by their name in the headers structure.
+static cstring headerInstanceName(const IR::Expression* expression) {
+    if (auto member = expression->to<IR::Member>()) {
+        if (member->expr->is<IR::PathExpression>())
+            return member->member.name;
+    }
+    return nullptr;
+}
+
+bool emitOrderMatchesParser(const IR::P4Parser* parser, const IR::P4Control* deparser,
+                            P4::ReferenceMap* refMap, P4::TypeMap* typeMap) {
+    auto& p4lib = P4::P4CoreLibrary::instance;
+
+    std::map<cstring, unsigned> emitIndex;
+    bool simple = true;
+    forAllMatching<IR::MethodCallExpression>(deparser->body,
+                                             [&](const IR::MethodCallExpression* mce) {
+        auto mi = P4::MethodInstance::resolve(mce, refMap, typeMap);
+        auto em = mi->to<P4::ExternMethod>();
+        if (em == nullptr || em->method->name.name != p4lib.packetOut.emit.name)
+            return;
+        cstring name = headerInstanceName(mce->arguments->at(0)->expression);
+        if (name.isNullOrEmpty() || emitIndex.count(name))
+            simple = false;
+        else
+            emitIndex.emplace(name, emitIndex.size());
+    });
+    if (!simple)
+        return false;
+
+    // Headers extracted by each state, in order, and the successors of each state.
+    std::map<cstring, std::vector<cstring>> extracted;
+    std::map<cstring, std::vector<cstring>> successors;
+    for (auto state : parser->states) {
+        auto& headers = extracted[state->name.name];
+        for (auto c : state->components) {
+            auto mcs = c->to<IR::MethodCallStatement>();
+            if (mcs == nullptr)
+                continue;
+            auto mi = P4::MethodInstance::resolve(mcs->methodCall, refMap, typeMap);
+            auto em = mi->to<P4::ExternMethod>();
+            if (em == nullptr || em->method->name.name != p4lib.packetIn.extract.name)
+                continue;
+            cstring name = headerInstanceName(mcs->methodCall->arguments->at(0)->expression);
+            if (name.isNullOrEmpty())
+                return false;
+            headers.push_back(name);
+        }
+        auto& next = successors[state->name.name];
+        if (state->selectExpression == nullptr)
+            continue;
+        if (auto path = state->selectExpression->to<IR::PathExpression>()) {
+            next.push_back(path->path->name.name);
+        } else if (auto select = state->selectExpression->to<IR::SelectExpression>()) {
+            for (auto sc : select->selectCases)
+                next.push_back(sc->state->path->name.name);
+        }
+    }
+
+    // Headers which may have been extracted before entering each state.
+    std::map<cstring, std::set<cstring>> before;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto& it : successors) {
+            std::set<cstring> out = before[it.first];
+            out.insert(extracted[it.first].begin(), extracted[it.first].end());
+            for (auto succ : it.second) {
+                auto& in = before[succ];
+                for (auto h : out)
+                    changed |= in.insert(h).second;
+            }
+        }
+    }
+
+    for (auto& it : extracted) {
+        std::set<cstring> seen = before[it.first];
+        for (auto h : it.second) {
+            if (seen.count(h))
+                return false;
+            if (emitIndex.count(h)) {
+                for (auto prev : seen) {
+                    if (emitIndex.count(prev) && emitIndex.at(prev) > emitIndex.at(h))
+                        return false;
+                }
+            }
+            seen.insert(h);
+        }
+    }
+    return true;
+}
+
+void EBPFDeparser::findModifiedHeaders() {
+    auto finder = new FindModifiedHeaderFields(program->refMap, program->typeMap);
+    program->program->apply(*finder);
+    modifiedFields = finder;
+    inPlaceEmit = !finder->validityChanged && program->parser != nullptr &&
+            emitOrderMatchesParser(program->parser->parserBlock->container,
+                                   controlBlock->container, program->refMap, program->typeMap);
+}
+
 void EBPFDeparser::emit(CodeBuilder* builder) {
     codeGen->setBuilder(builder);
+    findModifiedHeaders();
 
     for (auto a : controlBlock->container->controlLocals)
         emitDeclaration(builder, a);
@@ -23,6 +23,35 @@ namespace EBPF {
 
 class EBPFDeparser;
 
+// Finds header fields which may be written anywhere in the program (except by
+// the parser extracting them) and whether header validity or layout may change.
+// Fields are identified by header type and field name, so all instances of a
+// header type are treated alike.
+class FindModifiedHeaderFields : public Inspector {
+    P4::ReferenceMap* refMap;
+    P4::TypeMap* typeMap;
+
+    bool containsHeaders(const IR::Type* type) const;
+    void markWritten(const IR::Expression* expression);
+
+ public:
+    std::set<std::pair<cstring, cstring>> fields;
+    bool validityChanged = false;
+
+    FindModifiedHeaderFields(P4::ReferenceMap* refMap, P4::TypeMap* typeMap) :
+            refMap(refMap), typeMap(typeMap) { setName("FindModifiedHeaderFields"); }
+
+    bool isModified(const IR::Type_Header* header, cstring field) const
+    { return fields.count(std::make_pair(header->name.name, field)) != 0; }
+    bool preorder(const IR::AssignmentStatement* statement) override;
+    bool preorder(const IR::MethodCallExpression* expression) override;
+};
+
+// Checks that on every path through the parser the headers are extracted in
+// the order in which the deparser emits them, and at most once.
+bool emitOrderMatchesParser(const IR::P4Parser* parser, const IR::P4Control* deparser,
+                            P4::ReferenceMap* refMap, P4::TypeMap* typeMap);
+
 // this translator emits deparser externs
 class DeparserBodyTranslator : public ControlBodyTranslator {
  protected:
@@ -58,6 +87,8 @@ class DeparserHdrEmitTranslator : public DeparserPrepareBufferTranslator {
     void processMethod(const P4::ExternMethod* method) override;
     void emitField(CodeBuilder* builder, cstring field, const IR::Expression* hdrExpr,
                    unsigned alignment, EBPF::EBPFType* type);
+    void emitFields(CodeBuilder* builder, const IR::Type_Header* headerToEmit,
+                    const IR::Expression* hdrExpr, bool modifiedOnly);
 };
 
 class EBPFDeparser : public EBPFControl {
@@ -67,6 +98,12 @@ class EBPFDeparser : public EBPFControl {
     EBPFType* headerType;
     cstring outerHdrOffsetVar, outerHdrLengthVar;
     cstring returnCode;
+    // Set when the deparser emits the headers extracted by the parser in the same
+    // order and no header validity may change. If in addition the packet length
+    // does not change, every header is emitted at the offset it was extracted
+    // from, so only the fields which may have been modified need to be written.
+    bool inPlaceEmit = false;
+    const FindModifiedHeaderFields* modifiedFields = nullptr;
 
     EBPFDeparser(const EBPFProgram* program, const IR::ControlBlock* control,
                  const IR::Parameter* parserHeaders) :
@@ -91,6 +128,9 @@ class EBPFDeparser : public EBPFControl {
     }
 
     void emitBufferAdjusts(CodeBuilder *builder) const;
+
+ protected:
+    void findModifiedHeaders();
 };
 
 }  // namespace EBPF
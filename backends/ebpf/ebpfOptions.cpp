@@ -26,4 +26,8 @@ EbpfOptions::EbpfOptions() {
         registerOption("--trace", nullptr,
                 [this](const char*) { emitTraceMessages = true; return true; },
                 "Generate tracing messages of packet processing");
+        registerOption("--per-cpu-counters", nullptr,
+                [this](const char*) { perCPUCounters = true; return true; },
+                "[ebpf back-end] Store counters in per-CPU maps and update them "
+                "without atomic operations; readers must sum the values of all CPUs.");
 }
@@ -31,6 +31,8 @@ class EbpfOptions : public CompilerOptions {
     bool emitExterns = false;
     // tracing eBPF code execution
     bool emitTraceMessages = false;
+    // use per-CPU maps and non-atomic updates for counters
+    bool perCPUCounters = false;
     EbpfOptions();
 };
 
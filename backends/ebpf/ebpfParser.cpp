@@ -29,7 +29,10 @@ class StateTranslationVisitor : public CodeGenInspector {
 
     P4::P4CoreLibrary& p4lib;
     const EBPFParserState* state;
+    // true when the packet length was checked for all extracts of the state
+    bool stateLengthChecked = false;
 
+    void emitCheckPacketLength(unsigned width);
     void compileExtractField(const IR::Expression* expr, cstring name,
                              unsigned alignment, EBPFType* type);
     void compileExtract(const IR::Expression* destination);
@@ -154,7 +157,12 @@ bool StateTranslationVisitor::preorder(const IR::ParserState* parserState) {
     cstring msgStr = Util::printf_format("Parser: state %s", parserState->name.name);
     builder->target->emitTraceMessage(builder, msgStr.c_str());
 
+    unsigned width = state->coalescedExtractWidth();
+    if (width != 0)
+        emitCheckPacketLength(width);
+    stateLengthChecked = width != 0;
     visit(parserState->components, "components");
+    stateLengthChecked = false;
     if (parserState->selectExpression == nullptr) {
         builder->emitIndent();
         builder->append("goto ");
@@ -226,6 +234,34 @@ bool StateTranslationVisitor::preorder(const IR::SelectCase* selectCase) {
     return false;
 }
 
+void StateTranslationVisitor::emitCheckPacketLength(unsigned width) {
+    auto program = state->parser->program;
+
+    cstring offsetStr = Util::printf_format("BYTES(%s + %s)",
+                                            program->offsetVar, cstring::to_cstring(width));
+    builder->target->emitTraceMessage(builder, "Parser: check pkt_len=%d >= last_read_byte=%d",
+                                      2, program->lengthVar.c_str(), offsetStr.c_str());
+
+    builder->emitIndent();
+    builder->appendFormat("if (%s < %s + BYTES(%s + %d)) ",
+                          program->packetEndVar.c_str(),
+                          program->packetStartVar.c_str(),
+                          program->offsetVar.c_str(), width);
+    builder->blockStart();
+
+    builder->target->emitTraceMessage(builder, "Parser: invalid packet (packet too short)");
+
+    builder->emitIndent();
+    builder->appendFormat("%s = %s;", program->errorVar.c_str(),
+                          p4lib.packetTooShort.str());
+    builder->newline();
+
+    builder->emitIndent();
+    builder->appendFormat("goto %s;", IR::ParserState::reject.c_str());
+    builder->newline();
+    builder->blockEnd(true);
+}
+
 void
 StateTranslationVisitor::compileExtractField(
     const IR::Expression* expr, cstring field, unsigned alignment, EBPFType* type) {
@@ -240,7 +276,7 @@ StateTranslationVisitor::compileExtractField(
         unsigned lastBitIndex = widthToExtract + alignment - 1;
         unsigned lastWordIndex = lastBitIndex / 8;
         unsigned wordsToRead = lastWordIndex + 1;
-        unsigned loadSize;
+        unsigned loadSize = 0;
 
         const char* helper = nullptr;
         if (wordsToRead <= 1) {
@@ -252,33 +288,57 @@ StateTranslationVisitor::compileExtractField(
         } else if (wordsToRead <= 4) {
             helper = "load_word";
             loadSize = 32;
-        } else {
-            // TODO: this is wrong, since a 60-bit unaligned read may require 9 words.
-            if (wordsToRead > 64) BUG("Unexpected width %d", widthToExtract);
+        } else if (wordsToRead <= 8) {
             helper = "load_dword";
             loadSize = 64;
+        } else {
+            // An unaligned field may span 9 bytes; combine a 64-bit load with
+            // the following byte, then drop the bits past the end of the field.
+            builder->emitIndent();
+            visit(expr);
+            builder->appendFormat(".%s = (", field.c_str());
+            type->emit(builder);
+            builder->appendFormat(")(((load_dword(%s, BYTES(%s)) << %d) | "
+                                  "(load_byte(%s, BYTES(%s) + 8) >> %d)) >> %d)",
+                                  program->packetStartVar.c_str(),
+                                  program->offsetVar.c_str(), alignment,
+                                  program->packetStartVar.c_str(),
+                                  program->offsetVar.c_str(), 8 - alignment,
+                                  64 - widthToExtract);
+            builder->endOfStatement(true);
         }
 
-        unsigned shift = loadSize - alignment - widthToExtract;
+        if (helper != nullptr) {
+            unsigned shift = loadSize - alignment - widthToExtract;
+            builder->emitIndent();
+            visit(expr);
+            builder->appendFormat(".%s = (", field.c_str());
+            type->emit(builder);
+            builder->appendFormat(")((%s(%s, BYTES(%s))",
+                                  helper,
+                                  program->packetStartVar.c_str(),
+                                  program->offsetVar.c_str());
+            if (shift != 0)
+                builder->appendFormat(" >> %d", shift);
+            builder->append(")");
+
+            if (widthToExtract != loadSize) {
+                builder->append(" & EBPF_MASK(");
+                type->emit(builder);
+                builder->appendFormat(", %d)", widthToExtract);
+            }
+
+            builder->append(")");
+            builder->endOfStatement(true);
+        }
+    } else if (alignment == 0 && widthToExtract % 8 == 0) {
+        // wide byte-aligned values are stored in network order; copy them at once.
         builder->emitIndent();
+        builder->append("__builtin_memcpy(&");
         visit(expr);
-        builder->appendFormat(".%s = (", field.c_str());
-        type->emit(builder);
-        builder->appendFormat(")((%s(%s, BYTES(%s))",
-                              helper,
+        builder->appendFormat(".%s, (u8*)%s + BYTES(%s), %d)", field.c_str(),
                               program->packetStartVar.c_str(),
-                              program->offsetVar.c_str());
-        if (shift != 0)
-            builder->appendFormat(" >> %d", shift);
-        builder->append(")");
-
-        if (widthToExtract != loadSize) {
-            builder->append(" & EBPF_MASK(");
-            type->emit(builder);
-            builder->appendFormat(", %d)", widthToExtract);
-        }
-
-        builder->append(")");
+                              program->offsetVar.c_str(), widthToExtract / 8);
         builder->endOfStatement(true);
     } else {
         // wide values; read all bytes one by one.
@@ -346,32 +406,8 @@ StateTranslationVisitor::compileExtract(const IR::Expression* destination) {
         return;
     }
 
-    unsigned width = ht->width_bits();
-    auto program = state->parser->program;
-
-    cstring offsetStr = Util::printf_format("BYTES(%s + %s)",
-                                            program->offsetVar, cstring::to_cstring(width));
-    builder->target->emitTraceMessage(builder, "Parser: check pkt_len=%d >= last_read_byte=%d",
-                                      2, program->lengthVar.c_str(), offsetStr.c_str());
-
-    builder->emitIndent();
-    builder->appendFormat("if (%s < %s + BYTES(%s + %d)) ",
-                          program->packetEndVar.c_str(),
-                          program->packetStartVar.c_str(),
-                          program->offsetVar.c_str(), width);
-    builder->blockStart();
-
-    builder->target->emitTraceMessage(builder, "Parser: invalid packet (packet too short)");
-
-    builder->emitIndent();
-    builder->appendFormat("%s = %s;", program->errorVar.c_str(),
-                          p4lib.packetTooShort.str());
-    builder->newline();
-
-    builder->emitIndent();
-    builder->appendFormat("goto %s;", IR::ParserState::reject.c_str());
-    builder->newline();
-    builder->blockEnd(true);
+    if (!stateLengthChecked)
+        emitCheckPacketLength(ht->width_bits());
 
     msgStr = Util::printf_format("Parser: extracting header %s", destination->toString());
     builder->target->emitTraceMessage(builder, msgStr.c_str());
@@ -489,6 +525,50 @@ void EBPFParserState::emit(CodeBuilder* builder) {
     state->apply(visitor);
 }
 
+unsigned EBPFParserState::coalescedExtractWidth() const {
+    auto refMap = parser->program->refMap;
+    auto typeMap = parser->program->typeMap;
+    auto& p4lib = P4::P4CoreLibrary::instance;
+    unsigned width = 0;
+    unsigned extracts = 0;
+
+    for (auto c : state->components) {
+        const IR::MethodCallExpression* mce = nullptr;
+        if (auto mcs = c->to<IR::MethodCallStatement>()) {
+            mce = mcs->methodCall;
+        } else if (auto assign = c->to<IR::AssignmentStatement>()) {
+            mce = assign->right->to<IR::MethodCallExpression>();
+        } else if (!c->is<IR::Declaration>()) {
+            return 0;
+        }
+        if (mce == nullptr)
+            continue;
+
+        auto mi = P4::MethodInstance::resolve(mce, refMap, typeMap);
+        auto extMethod = mi->to<P4::ExternMethod>();
+        if (extMethod == nullptr || extMethod->object != parser->packet)
+            continue;
+        if (extMethod->method->name.name == p4lib.packetIn.length.name)
+            continue;
+        // lookahead and advance move or read past the extracted data
+        if (extMethod->method->name.name != p4lib.packetIn.extract.name ||
+            mce->arguments->size() != 1)
+            return 0;
+
+        auto type = typeMap->getType(mce->arguments->at(0)->expression);
+        auto ht = type ? type->to<IR::Type_StructLike>() : nullptr;
+        if (ht == nullptr)
+            return 0;
+        for (auto f : ht->fields) {
+            if (!typeMap->getType(f)->is<IR::Type_Bits>())
+                return 0;
+        }
+        width += ht->width_bits();
+        extracts++;
+    }
+    return extracts > 1 ? width : 0;
+}
+
 EBPFParser::EBPFParser(const EBPFProgram* program, const IR::ParserBlock* block,
                        const P4::TypeMap* typeMap) :
         program(program), typeMap(typeMap), parserBlock(block),
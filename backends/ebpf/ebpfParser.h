@@ -33,6 +33,11 @@ class EBPFParserState : public EBPFObject {
     EBPFParserState(const IR::ParserState* state, EBPFParser* parser) :
             state(state), parser(parser) {}
     void emit(CodeBuilder* builder);
+    /// Returns the number of bits extracted by this state when the state
+    /// contains at least two extracts and all its packet accesses are
+    /// extracts of fixed-width headers; returns 0 otherwise.  In the former
+    /// case a single bounds check on entry covers all the extracts.
+    unsigned coalescedExtractWidth() const;
 };
 
 class EBPFParser : public EBPFObject {
@@ -66,9 +66,19 @@ EBPFTable::EBPFTable(const EBPFProgram* program, const IR::TableBlock* table,
     base = table->container->name.name + "_actions";
     actionEnumName = program->refMap->newName(base);
 
+    tuplesMapName = instanceName + "_tuples_map";
+    prefixesMapName = instanceName + "_prefixes";
+
     keyGenerator = table->container->getKey();
     actionList = table->container->getActionList();
 
+    // The generated control plane only adds the entries of the program
+    if (auto annotation =
+            table->container->getAnnotation(IR::Annotation::entriesFileAnnotation))
+        ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                "%1%: tables cannot read their entries from a file on this target",
+                annotation);
+
     initKey();
 }
 
@@ -220,6 +230,13 @@ void EBPFTable::emitValueActionIDNames(CodeBuilder* builder) {
 }
 
 void EBPFTable::emitValueStructStructure(CodeBuilder* builder) {
+    if (isTernaryTable()) {
+        // entries of different tuples are ordered by priority
+        builder->emitIndent();
+        builder->append("u32 priority;");
+        builder->newline();
+    }
+
     builder->emitIndent();
     builder->append("unsigned int action;");
     builder->newline();
@@ -253,6 +270,39 @@ void EBPFTable::emitTypes(CodeBuilder* builder) {
     validateKeys();
     emitKeyType(builder);
     emitValueType(builder);
+    if (isTernaryTable())
+        emitTernaryTypes(builder);
+}
+
+void EBPFTable::emitTernaryTypes(CodeBuilder* builder) {
+    // A mask covers the whole key structure, so that the key can be
+    // masked in 32-bit chunks (the key structure is aligned to 4 bytes).
+    builder->emitIndent();
+    builder->appendFormat("struct %s_mask ", keyTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("u8 mask[sizeof(struct %s)];", keyTypeName.c_str());
+    builder->newline();
+    builder->blockEnd(false);
+    builder->append(" __attribute__((aligned(4)))");
+    builder->endOfStatement(true);
+
+    // An element of the list of masks; the list head is stored under the all-zero mask.
+    // The control plane keeps the list ordered by decreasing max_priority.
+    builder->emitIndent();
+    builder->appendFormat("struct %s_mask ", valueTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("u32 tuple_id;");
+    builder->emitIndent();
+    builder->appendFormat("struct %s_mask next_tuple_mask;", keyTypeName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendLine("u8 has_next;");
+    builder->emitIndent();
+    builder->appendLine("u32 max_priority;");
+    builder->blockEnd(false);
+    builder->endOfStatement(true);
 }
 
 void EBPFTable::emitInstance(CodeBuilder* builder) {
@@ -288,6 +338,13 @@ void EBPFTable::emitInstance(CodeBuilder* builder) {
 
         TableKind tableKind;
         auto extBlock = block->to<IR::ExternBlock>();
+        if (isTernaryTable() && extBlock->type->name.name != program->model.hash_table.name) {
+            ::error(ErrorType::ERR_UNSUPPORTED,
+                    "%1%: ternary tables can only be implemented as %2%",
+                    impl, program->model.hash_table.name);
+            return;
+        }
+
         if (extBlock->type->name.name == program->model.array_table.name) {
             tableKind = TableArray;
         } else if (extBlock->type->name.name == program->model.hash_table.name) {
@@ -330,16 +387,145 @@ void EBPFTable::emitInstance(CodeBuilder* builder) {
             return;
         }
 
-        cstring name = EBPFObject::externalName(table->container);
-        builder->target->emitTableDecl(builder, name, tableKind,
-                                       cstring("struct ") + keyTypeName,
-                                       cstring("struct ") + valueTypeName, size);
+        if (isTernaryTable()) {
+            emitTernaryInstance(builder, size);
+        } else {
+            cstring name = EBPFObject::externalName(table->container);
+            builder->target->emitTableDecl(builder, name, tableKind,
+                                           cstring("struct ") + keyTypeName,
+                                           cstring("struct ") + valueTypeName, size);
+        }
     }
     builder->target->emitTableDecl(builder, defaultActionMapName, TableArray,
                                    program->arrayIndexType,
                                    cstring("struct ") + valueTypeName, 1);
 }
 
+void EBPFTable::emitTernaryInstance(CodeBuilder* builder, int size) {
+    // Every tuple is a hash map holding the entries which share a mask;
+    // all tuples live in an array of maps indexed by tuple id.
+    builder->target->emitMapInMapDecl(builder, instanceName + "_tuple", TableHash,
+                                      cstring("struct ") + keyTypeName,
+                                      cstring("struct ") + valueTypeName, size,
+                                      tuplesMapName, TableArray, "u32", maxTernaryMasks);
+    builder->target->emitTableDecl(builder, prefixesMapName, TableHash,
+                                   cstring("struct ") + keyTypeName + "_mask",
+                                   cstring("struct ") + valueTypeName + "_mask",
+                                   maxTernaryMasks);
+}
+
+// Tuple space search: the key is masked with every mask from the list of masks
+// and looked up in the tuple holding entries with that mask. The entry with the
+// highest priority wins. Because the list is ordered by the maximum priority of
+// the entries of each tuple, the search stops as soon as no remaining tuple
+// can contain an entry with a higher priority than the best match found so far.
+void EBPFTable::emitTernaryLookup(CodeBuilder* builder, cstring key, cstring value) {
+    cstring keyMaskType = cstring("struct ") + keyTypeName + "_mask";
+    cstring valueMaskType = cstring("struct ") + valueTypeName + "_mask";
+
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s head = {0}", keyMaskType.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("%s *", valueMaskType.c_str());
+    builder->target->emitTableLookup(builder, prefixesMapName, "head", "val");
+    builder->endOfStatement(true);
+
+    builder->emitIndent();
+    builder->append("if (val && val->has_next != 0) ");
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s next = val->next_tuple_mask", keyMaskType.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendLine("#pragma clang loop unroll(disable)");
+    builder->emitIndent();
+    builder->appendFormat("for (int i = 0; i < %u; i++) ", maxTernaryMasks);
+    builder->blockStart();
+
+    builder->emitIndent();
+    builder->appendFormat("%s *", valueMaskType.c_str());
+    builder->target->emitTableLookup(builder, prefixesMapName, "next", "v");
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendLine("if (!v)");
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendLine("break;");
+    builder->decreaseIndent();
+
+    builder->emitIndent();
+    builder->appendLine("/* remaining tuples cannot hold an entry with higher priority */");
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL && %s->priority >= v->max_priority)",
+                          value.c_str(), value.c_str());
+    builder->newline();
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendLine("break;");
+    builder->decreaseIndent();
+
+    builder->emitIndent();
+    builder->appendFormat("struct %s k = {}", keyTypeName.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendLine("u32 *chunk = (u32 *) &k;");
+    builder->emitIndent();
+    builder->appendLine("u32 *mask = (u32 *) &next;");
+    builder->emitIndent();
+    builder->appendLine("#pragma clang loop unroll(disable)");
+    builder->emitIndent();
+    builder->appendFormat("for (int j = 0; j < sizeof(struct %s) / 4; j++) ",
+                          keyTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("chunk[j] = ((u32 *) &%s)[j] & mask[j];", key.c_str());
+    builder->newline();
+    builder->blockEnd(true);
+
+    builder->emitIndent();
+    builder->appendLine("u32 tuple_id = v->tuple_id;");
+    builder->emitIndent();
+    builder->appendLine("next = v->next_tuple_mask;");
+    builder->emitIndent();
+    builder->append("void *");
+    builder->target->emitTableLookup(builder, tuplesMapName, "tuple_id", "tuple");
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendLine("if (!tuple)");
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendLine("break;");
+    builder->decreaseIndent();
+
+    builder->emitIndent();
+    builder->appendFormat("struct %s *tuple_entry = bpf_map_lookup_elem(tuple, &k);",
+                          valueTypeName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendFormat("if (tuple_entry != NULL && "
+                          "(%s == NULL || tuple_entry->priority > %s->priority))",
+                          value.c_str(), value.c_str());
+    builder->newline();
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendFormat("%s = tuple_entry;", value.c_str());
+    builder->newline();
+    builder->decreaseIndent();
+
+    builder->emitIndent();
+    builder->appendLine("if (v->has_next == 0)");
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendLine("break;");
+    builder->decreaseIndent();
+
+    builder->blockEnd(true);
+    builder->blockEnd(true);
+    builder->blockEnd(true);
+}
+
 void EBPFTable::emitKey(CodeBuilder* builder, cstring keyName) {
     if (keyGenerator == nullptr) {
         return;
@@ -567,6 +753,12 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
     if (entries == nullptr)
         return;
 
+    if (isTernaryTable()) {
+        ::error(ErrorType::ERR_UNSUPPORTED,
+                "%1%: entries are not supported for ternary tables", entries);
+        return;
+    }
+
     builder->emitIndent();
     builder->blockStart();
     builder->emitIndent();
@@ -670,11 +862,23 @@ bool EBPFTable::isLPMTable() {
     return isLPM;
 }
 
+bool EBPFTable::isTernaryTable() const {
+    if (keyGenerator == nullptr)
+        return false;
+    for (auto it : keyGenerator->keyElements) {
+        auto mtdecl = program->refMap->getDeclaration(it->matchType->path, true);
+        auto matchType = mtdecl->getNode()->to<IR::Declaration_ID>();
+        if (matchType->name.name == P4::P4CoreLibrary::instance.ternaryMatch.name)
+            return true;
+    }
+    return false;
+}
+
 ////////////////////////////////////////////////////////////////
 
 EBPFCounterTable::EBPFCounterTable(const EBPFProgram* program, const IR::ExternBlock* block,
                                    cstring name, CodeGenInspector* codeGen) :
-        EBPFTableBase(program, name, codeGen) {
+        EBPFTableBase(program, name, codeGen), perCPU(program->options.perCPUCounters) {
     auto sz = block->getParameterValue(program->model.counterArray.max_index.name);
     if (sz == nullptr || !sz->is<IR::Constant>()) {
         ::error(ErrorType::ERR_INVALID,
@@ -705,67 +909,59 @@ EBPFCounterTable::EBPFCounterTable(const EBPFProgram* program, const IR::ExternB
 }
 
 void EBPFCounterTable::emitInstance(CodeBuilder* builder) {
-    TableKind kind = isHash ? TableHash : TableArray;
+    TableKind kind;
+    if (isHash)
+        kind = perCPU ? TablePerCPUHash : TableHash;
+    else
+        kind = perCPU ? TablePerCPUArray : TableArray;
     builder->target->emitTableDecl(
         builder, dataMapName, kind, keyTypeName, valueTypeName, size);
 }
 
-void EBPFCounterTable::emitCounterIncrement(CodeBuilder* builder,
-                                            const IR::MethodCallExpression *expression) {
-    cstring keyName = program->refMap->newName("key");
-    cstring valueName = program->refMap->newName("value");
-
-    builder->emitIndent();
-    builder->append(valueTypeName);
-    builder->spc();
-    builder->append("*");
-    builder->append(valueName);
-    builder->endOfStatement(true);
+void EBPFCounterTable::emitInitializer(CodeBuilder* builder) {
+    // Array counters are looked up without an insert-on-miss fallback
+    // when per-CPU counters are enabled, so every index must exist.
+    if (isHash || !perCPU || builder->target->arrayMapsArePreallocated())
+        return;
+    cstring fd = "tableFileDescriptor";
+    cstring key = "key";
+    cstring value = "value";
 
     builder->emitIndent();
-    builder->append(valueTypeName);
-    builder->spc();
-    builder->appendLine("init_val = 1;");
-
+    builder->blockStart();
     builder->emitIndent();
-    builder->append(keyTypeName);
-    builder->spc();
-    builder->append(keyName);
-    builder->append(" = ");
-
-    BUG_CHECK(expression->arguments->size() == 1, "Expected just 1 argument for %1%", expression);
-    auto arg = expression->arguments->at(0);
-
-    codeGen->visit(arg);
+    builder->appendFormat("int %s = BPF_OBJ_GET(MAP_PATH \"/%s\")",
+                          fd.c_str(), dataMapName.c_str());
     builder->endOfStatement(true);
-
     builder->emitIndent();
-    builder->target->emitTableLookup(builder, dataMapName, keyName, valueName);
+    builder->appendFormat("if (%s < 0) { fprintf(stderr, \"map %s not loaded\\n\"); exit(1); }",
+                          fd.c_str(), dataMapName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendFormat("%s %s = 0", valueTypeName.c_str(), value.c_str());
     builder->endOfStatement(true);
-
     builder->emitIndent();
-    builder->appendFormat("if (%s != NULL)", valueName.c_str());
-    builder->newline();
-    builder->increaseIndent();
+    builder->appendFormat("for (%s %s = 0; %s < %u; %s++) ", keyTypeName.c_str(), key.c_str(),
+                          key.c_str(), static_cast<unsigned>(size), key.c_str());
+    builder->blockStart();
     builder->emitIndent();
-    builder->appendFormat("__sync_fetch_and_add(%s, 1);", valueName.c_str());
+    builder->append("int ok = ");
+    builder->target->emitUserTableUpdate(builder, fd, key, value);
     builder->newline();
-    builder->decreaseIndent();
-
-    builder->emitIndent();
-    builder->appendLine("else");
-    builder->increaseIndent();
     builder->emitIndent();
-    builder->target->emitTableUpdate(builder, dataMapName, keyName, "init_val");
+    builder->appendFormat("if (ok != 0) { "
+                          "perror(\"Could not write in %s\"); exit(1); }",
+                          dataMapName.c_str());
     builder->newline();
-    builder->decreaseIndent();
+    builder->blockEnd(true);
+    builder->blockEnd(true);
 }
 
-void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
-                                            const IR::MethodCallExpression *expression) {
+void EBPFCounterTable::emitCounterUpdate(CodeBuilder* builder, const IR::Expression* index,
+                                         const IR::Expression* increment) {
     cstring keyName = program->refMap->newName("key");
     cstring valueName = program->refMap->newName("value");
-    cstring incName = program->refMap->newName("inc");
+    cstring incName = "1";
 
     builder->emitIndent();
     builder->append(valueTypeName);
@@ -774,33 +970,24 @@ void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
     builder->append(valueName);
     builder->endOfStatement(true);
 
-    builder->emitIndent();
-    builder->append(valueTypeName);
-    builder->spc();
-    builder->appendLine("init_val = 1;");
-
     builder->emitIndent();
     builder->append(keyTypeName);
     builder->spc();
     builder->append(keyName);
     builder->append(" = ");
-
-    BUG_CHECK(expression->arguments->size() == 2, "Expected just 2 arguments for %1%", expression);
-    auto index = expression->arguments->at(0);
-
     codeGen->visit(index);
     builder->endOfStatement(true);
 
-    builder->emitIndent();
-    builder->append(valueTypeName);
-    builder->spc();
-    builder->append(incName);
-    builder->append(" = ");
-
-    auto inc = expression->arguments->at(1);
-
-    codeGen->visit(inc);
-    builder->endOfStatement(true);
+    if (increment != nullptr) {
+        incName = program->refMap->newName("inc");
+        builder->emitIndent();
+        builder->append(valueTypeName);
+        builder->spc();
+        builder->append(incName);
+        builder->append(" = ");
+        codeGen->visit(increment);
+        builder->endOfStatement(true);
+    }
 
     builder->emitIndent();
     builder->target->emitTableLookup(builder, dataMapName, keyName, valueName);
@@ -811,17 +998,48 @@ void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
     builder->newline();
     builder->increaseIndent();
     builder->emitIndent();
-    builder->appendFormat("__sync_fetch_and_add(%s, %s);", valueName.c_str(), incName.c_str());
+    // A per-CPU entry is only updated by the CPU owning it, and the
+    // program is not preempted while running, so no atomic is needed.
+    if (perCPU)
+        builder->appendFormat("*%s += %s;", valueName.c_str(), incName.c_str());
+    else
+        builder->appendFormat("__sync_fetch_and_add(%s, %s);",
+                              valueName.c_str(), incName.c_str());
     builder->newline();
     builder->decreaseIndent();
 
+    // Per-CPU arrays are preallocated (or populated by the control plane),
+    // so a lookup only fails for an index out of range, which cannot be
+    // inserted either.
+    if (perCPU && !isHash)
+        return;
+
+    cstring initName = program->refMap->newName("init_val");
     builder->emitIndent();
-    builder->appendLine("else");
+    builder->appendLine("else {");
     builder->increaseIndent();
     builder->emitIndent();
-    builder->target->emitTableUpdate(builder, dataMapName, keyName, "init_val");
+    builder->appendFormat("%s %s = %s", valueTypeName.c_str(), initName.c_str(), incName.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableUpdate(builder, dataMapName, keyName, initName);
     builder->newline();
     builder->decreaseIndent();
+    builder->emitIndent();
+    builder->appendLine("}");
+}
+
+void EBPFCounterTable::emitCounterIncrement(CodeBuilder* builder,
+                                            const IR::MethodCallExpression *expression) {
+    BUG_CHECK(expression->arguments->size() == 1, "Expected just 1 argument for %1%", expression);
+    emitCounterUpdate(builder, expression->arguments->at(0)->expression, nullptr);
+}
+
+void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
+                                            const IR::MethodCallExpression *expression) {
+    BUG_CHECK(expression->arguments->size() == 2, "Expected just 2 arguments for %1%", expression);
+    emitCounterUpdate(builder, expression->arguments->at(0)->expression,
+                      expression->arguments->at(1)->expression);
 }
 
 void
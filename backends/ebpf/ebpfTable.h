@@ -71,8 +71,15 @@ class EBPFTable : public EBPFTableBase {
 
  protected:
     const cstring prefixFieldName = "prefixlen";
+    // Upper bound on the number of distinct masks (tuples) of a ternary table;
+    // it also bounds the number of iterations of the tuple space search.
+    const unsigned maxTernaryMasks = 128;
 
     bool isLPMTable();
+    bool isTernaryTable() const;
+    void emitTernaryTypes(CodeBuilder* builder);
+    void emitTernaryInstance(CodeBuilder* builder, int size);
+    void emitTernaryLookup(CodeBuilder* builder, cstring key, cstring value);
     virtual void validateKeys() const;
     virtual ActionTranslationVisitor*
     createActionTranslationVisitor(cstring valueName, const EBPFProgram* program) const {
@@ -87,6 +94,11 @@ class EBPFTable : public EBPFTableBase {
     cstring               actionEnumName;
     std::map<const IR::KeyElement*, cstring> keyFieldNames;
     std::map<const IR::KeyElement*, EBPFType*> keyTypes;
+    // Maps used to implement ternary tables with tuple space search:
+    // one hash map per mask (tuple), stored in an array of maps, plus
+    // a list of masks ordered by the maximum priority of their entries.
+    cstring tuplesMapName;
+    cstring prefixesMapName;
 
     EBPFTable(const EBPFProgram* program, const IR::TableBlock* table, CodeGenInspector* codeGen);
 
@@ -103,6 +115,10 @@ class EBPFTable : public EBPFTableBase {
     virtual void emitAction(CodeBuilder* builder, cstring valueName, cstring actionRunVariable);
     virtual void emitInitializer(CodeBuilder* builder);
     virtual void emitLookup(CodeBuilder* builder, cstring key, cstring value) {
+        if (isTernaryTable()) {
+            emitTernaryLookup(builder, key, value);
+            return;
+        }
         builder->target->emitTableLookup(builder, dataMapName, key, value);
         builder->endOfStatement(true);
     }
@@ -112,7 +128,8 @@ class EBPFTable : public EBPFTableBase {
     }
     virtual bool isMatchTypeSupported(const IR::Declaration_ID* matchType) {
         return matchType->name.name == P4::P4CoreLibrary::instance.exactMatch.name ||
-               matchType->name.name == P4::P4CoreLibrary::instance.lpmMatch.name;
+               matchType->name.name == P4::P4CoreLibrary::instance.lpmMatch.name ||
+               matchType->name.name == P4::P4CoreLibrary::instance.ternaryMatch.name;
     }
     // Whether to drop packet if no match entry found.
     // Some table implementations may want to continue processing.
@@ -123,15 +140,23 @@ class EBPFCounterTable : public EBPFTableBase {
  protected:
     size_t    size;
     bool      isHash;
+    // Keep one copy of each counter per CPU and update it non-atomically;
+    // the control plane sums the per-CPU values when reading a counter.
+    bool      perCPU;
+
+    void emitCounterUpdate(CodeBuilder* builder, const IR::Expression* index,
+                           const IR::Expression* increment);
 
  public:
     EBPFCounterTable(const EBPFProgram* program, const IR::ExternBlock* block,
                      cstring name, CodeGenInspector* codeGen);
     EBPFCounterTable(const EBPFProgram* program, cstring name, CodeGenInspector* codeGen,
                      size_t size, bool isHash) :
-            EBPFTableBase(program, name, codeGen), size(size), isHash(isHash) { }
+            EBPFTableBase(program, name, codeGen), size(size), isHash(isHash),
+            perCPU(program->options.perCPUCounters) { }
     virtual void emitTypes(CodeBuilder*);
     virtual void emitInstance(CodeBuilder* builder);
+    virtual void emitInitializer(CodeBuilder* builder);
     virtual void emitCounterIncrement(CodeBuilder* builder,
                                       const IR::MethodCallExpression* expression);
     virtual void emitCounterAdd(CodeBuilder* builder, const IR::MethodCallExpression* expression);
@@ -181,8 +181,10 @@ if __name__ == '__main__':
     options.target = args.target
     options.extern = args.extern
 
-    # All args after '--' are intended for the p4 compiler
-    argv = argv[1:]
+    # All args after '--' are intended for the p4 compiler, as are the
+    # options this script does not know
+    if '--' in argv:
+        argv.remove('--')
     # Run the test with the extracted options and modified argv
     result = run_test(options, argv)
     sys.exit(result)
@@ -47,12 +47,42 @@ limitations under the License.
  */
 #ifdef CONTROL_PLANE // BEGIN EBPF USER SPACE DEFINITIONS
 
+#include <errno.h>
 #include <bpf/bpf.h> // bpf_obj_get/pin, bpf_map_update_elem
+#include <bpf/libbpf.h> // libbpf_num_possible_cpus
 
 #define BPF_USER_MAP_UPDATE_ELEM(index, key, value, flags)\
     bpf_map_update_elem(index, key, value, flags)
 #define BPF_OBJ_PIN(table, name) bpf_obj_pin(table, name)
 #define BPF_OBJ_GET(name) bpf_obj_get(name)
+#define BPF_USER_COUNTER_READ(index, key, value) \
+    user_counter_read(index, key, value)
+
+/* Reads the u32 counter @key of the map @index into @value. A missing entry
+ * reads as 0. A per-CPU map returns one value per possible CPU, each padded
+ * to 8 bytes, and the counter is their sum.
+ */
+static inline int user_counter_read(int index, void *key, u32 *value) {
+    struct bpf_map_info info = {};
+    __u32 length = sizeof(info);
+    if (bpf_obj_get_info_by_fd(index, &info, &length) != 0)
+        return -1;
+    int copies = 1;
+    __u32 stride = info.value_size;
+    if (info.type == BPF_MAP_TYPE_PERCPU_ARRAY || info.type == BPF_MAP_TYPE_PERCPU_HASH) {
+        copies = libbpf_num_possible_cpus();
+        if (copies <= 0)
+            return -1;
+        stride = (info.value_size + 7) & ~7;
+    }
+    char values[copies * stride];
+    *value = 0;
+    if (bpf_map_lookup_elem(index, key, values) != 0)
+        return errno == ENOENT ? 0 : -1;
+    for (int i = 0; i < copies; i++)
+        *value += *(u32 *)(values + i * stride);
+    return 0;
+}
 
 #else // BEGIN EBPF KERNEL DEFINITIONS
 
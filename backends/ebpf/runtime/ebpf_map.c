@@ -89,3 +89,14 @@ int bpf_map_delete_map(struct bpf_map *map) {
     free(map);
     return EXIT_SUCCESS;
 }
+
+struct bpf_map *bpf_map_clone(struct bpf_map *map, unsigned int key_size, unsigned int value_size) {
+    struct bpf_map *new_map = NULL;
+    struct bpf_map *curr_map, *tmp_map;
+    HASH_ITER(hh, map, curr_map, tmp_map) {
+        int ret = bpf_map_update_elem(&new_map, curr_map->key, key_size,
+                                      curr_map->value, value_size, USER_BPF_NOEXIST);
+        assert(ret == EXIT_SUCCESS);
+    }
+    return new_map;
+}
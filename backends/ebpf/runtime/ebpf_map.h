@@ -67,5 +67,14 @@ int bpf_map_delete_elem(struct bpf_map *map, void *key, unsigned int key_size);
  */
 int bpf_map_delete_map(struct bpf_map *map);
 
+/**
+ * @brief Copy the entire map.
+ * @details Allocates a new map holding copies of all the keys and values
+ * of the given map. The copy is independent of the original map.
+ *
+ * @return The new map, NULL if the given map is empty.
+ */
+struct bpf_map *bpf_map_clone(struct bpf_map *map, unsigned int key_size, unsigned int value_size);
+
 
 #endif  // BACKENDS_EBPF_RUNTIME_EBPF_MAP_H_
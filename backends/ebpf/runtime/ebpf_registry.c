@@ -40,16 +40,53 @@ static int table_indexer = 0;
 static registry_entry *reg_tables_name = NULL;
 static registry_entry *reg_tables_id = NULL;
 
+/* Private copies of the registry, see registry_create_view() */
+static __thread registry_entry *view_tables_name = NULL;
+static __thread registry_entry *view_tables_id = NULL;
+
 static registry_entry *find_register(const char *name) {
     if (strlen(name) > MAX_TABLE_NAME_LENGTH){
         fprintf(stderr, "Error: Key name %s exceeds maximum size %d", name, MAX_TABLE_NAME_LENGTH);
         return NULL;
     }
     registry_entry *tmp_reg;
-    HASH_FIND(h_name, reg_tables_name, name, strlen(name), tmp_reg);
+    registry_entry *tables = view_tables_name ? view_tables_name : reg_tables_name;
+    HASH_FIND(h_name, tables, name, strlen(name), tmp_reg);
     return tmp_reg;
 }
 
+void registry_create_view() {
+    registry_entry *curr_reg, *tmp_reg;
+    HASH_ITER(h_name, reg_tables_name, curr_reg, tmp_reg) {
+        registry_entry *view_reg = malloc(sizeof(registry_entry));
+        struct bpf_table *view_tbl = malloc(sizeof(struct bpf_table));
+        if (!view_reg || !view_tbl) {
+            perror("Fatal: Could not allocate memory\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(view_tbl, curr_reg->tbl, sizeof(struct bpf_table));
+        view_tbl->bpf_map = bpf_map_clone(curr_reg->tbl->bpf_map,
+                                          view_tbl->key_size, view_tbl->value_size);
+        memcpy(view_reg, curr_reg, sizeof(registry_entry));
+        view_reg->tbl = view_tbl;
+        HASH_ADD(h_name, view_tables_name, name, strlen(view_tbl->name), view_reg);
+        HASH_ADD(h_id, view_tables_id, handle, sizeof(int), view_reg);
+    }
+}
+
+void registry_delete_view() {
+    registry_entry *curr_reg, *tmp_reg;
+    HASH_ITER(h_id, view_tables_id, curr_reg, tmp_reg) {
+        HASH_DELETE(h_id, view_tables_id, curr_reg);
+    }
+    HASH_ITER(h_name, view_tables_name, curr_reg, tmp_reg) {
+        HASH_DELETE(h_name, view_tables_name, curr_reg);
+        bpf_map_delete_map(curr_reg->tbl->bpf_map);
+        free(curr_reg->tbl);
+        free(curr_reg);
+    }
+}
+
 int registry_add(struct bpf_table *tbl) {
     /* Check if the register exists already */
     registry_entry *tmp_reg = find_register(tbl->name);
@@ -114,7 +151,8 @@ struct bpf_table *registry_lookup_table(const char *name) {
 
 struct bpf_table *registry_lookup_table_id(int tbl_id) {
     registry_entry *tmp_reg;
-    HASH_FIND(h_id, reg_tables_id, &tbl_id, sizeof(int), tmp_reg);
+    registry_entry *tables = view_tables_id ? view_tables_id : reg_tables_id;
+    HASH_FIND(h_id, tables, &tbl_id, sizeof(int), tmp_reg);
     if (tmp_reg == NULL)
         return NULL;
     return tmp_reg->tbl;
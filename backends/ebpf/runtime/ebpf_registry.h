@@ -18,7 +18,8 @@ limitations under the License.
  * This file defines a shared registry. It is required by the p4c-ebpf test framework
  * and acts as an interface between the emulated control and data plane. It provides
  * a mechanism to access shared tables by name or id and is intended to approximate the
- * kernel ebpf object API as closely as possible. This library is currently not thread-safe.
+ * kernel ebpf object API as closely as possible. This library is currently not thread-safe,
+ * but a thread may work on a private copy of all the tables, see registry_create_view().
  */
 
 #ifndef BACKENDS_EBPF_RUNTIME_EBPF_REGISTRY_H_
@@ -71,6 +72,22 @@ int registry_delete_tbl(const char *name);
  */
 void registry_delete();
 
+/**
+ * @brief Create a private view of the registry for the calling thread.
+ * @details Copies all the registered tables, including their entries.
+ * Until registry_delete_view() is called, all lookups and updates
+ * issued by the calling thread operate on these copies instead of the
+ * shared tables. Tables must not be added or removed while views exist.
+ */
+void registry_create_view();
+
+/**
+ * @brief Delete the private view of the calling thread.
+ * @details Frees all the table copies created by registry_create_view().
+ * The calling thread subsequently operates on the shared tables again.
+ */
+void registry_delete_view();
+
 /**
  * @brief Retrieve a table from the registry.
  * @details Retrieves a table from the shared registry.
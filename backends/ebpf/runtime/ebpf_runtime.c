@@ -34,6 +34,8 @@ limitations under the License.
 #define DELIM   '_'
 
 static int debug = 0;
+static int num_threads = 1;
+static int stats = 0;
 
 void usage(char *name) {
     fprintf(stderr, "This program expects a pcap file pattern, "
@@ -41,11 +43,14 @@ void usage(char *name) {
             "in the order given by the packet time,"
             "then feeds the individual packets into a filter function, "
             "and returns the output.\n");
-    fprintf(stderr, "Usage: %s [-d] -f file.pcap -n num_pcaps\n", name);
+    fprintf(stderr, "Usage: %s [-d] [-s] [-t threads] -f file.pcap -n num_pcaps\n", name);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "\t-d: Turn on debug messages\n");
     fprintf(stderr, "\t-f: The input pcap file\n");
     fprintf(stderr, "\t-n: Specifies the number of input pcap files\n");
+    fprintf(stderr, "\t-s: Print the packet processing rate\n");
+    fprintf(stderr, "\t-t: Number of threads feeding packets; each thread "
+            "uses a private copy of the tables (default 1)\n");
     exit(EXIT_FAILURE);
 }
 
@@ -86,9 +91,10 @@ void launch_runtime(const char *pcap_name, uint16_t num_pcaps) {
     /* Sort the list */
     sort_pcap_list(input_list);
     /* Run the "program" and retrieve output lists */
-    RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug);
-    /* Delete the list of input packets */
+    RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug, num_threads, stats);
+    /* Delete the list of input packets and unmap the capture files */
     delete_list(input_list);
+    release_pcap_mappings();
 }
 
 int main(int argc, char **argv) {
@@ -97,7 +103,7 @@ int main(int argc, char **argv) {
     int c;
     opterr = 0;
 
-    while ((c = getopt (argc, argv, "dn:f:")) != -1) {
+    while ((c = getopt (argc, argv, "dn:f:st:")) != -1) {
         switch (c) {
             case 'd':
             debug = 1;
@@ -114,6 +120,16 @@ int main(int argc, char **argv) {
             case 'f':
                 pcap_name = optarg;
             break;
+            case 's':
+                stats = 1;
+            break;
+            case 't':
+                num_threads = (int)strtol(optarg, (char **)NULL, 10);
+                if (num_threads < 1) {
+                    fprintf(stderr, "Number of threads must be positive\n");
+                    return EXIT_FAILURE;
+                }
+            break;
             case '?':
                 if (optopt == 'f')
                     fprintf(stderr, "The input trace file is missing. "
@@ -143,6 +159,12 @@ int main(int argc, char **argv) {
 #endif
 
     launch_runtime(pcap_name, num_pcaps);
+#ifdef CONTROL_PLANE
+    /* Compare the counters with the values the control file expects */
+    int failed_checks = check_counters();
+#else
+    int failed_checks = 0;
+#endif
     DELETE_EBPF_TABLES(debug);
-    return EXIT_SUCCESS;
+    return failed_checks == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -29,7 +29,9 @@ limitations under the License.
 
 void run_and_record_output(pcap_list_t *pkt_list, char *pcap_base, uint16_t num_pcaps, int debug);
 
-#define RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug) \
+/* The kernel target runs the packets through the network stack,
+   so the thread count and statistics options are ignored. */
+#define RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug, num_threads, stats) \
     run_and_record_output(input_list, pcap_base, num_pcaps, debug)
 #define INIT_EBPF_TABLES(debug)
 #define DELETE_EBPF_TABLES(debug)
@@ -18,40 +18,129 @@ limitations under the License.
 #include <ctype.h>      // isprint()
 #include <string.h>     // memcpy()
 #include <stdlib.h>     // malloc()
+#include <pthread.h>    // pthread_create()
+#include <time.h>       // clock_gettime()
 #include "ebpf_test.h"
 #include "ebpf_runtime_test.h"
 
 #define PCAPOUT "_out.pcap"
 
+/* A contiguous range of input packets processed by one thread */
+struct feed_shard {
+    packet_filter ebpf_filter;
+    pcap_list_t *pkt_list;
+    uint32_t start;
+    uint32_t end;
+    int debug;
+    int private_tables;
+    pcap_list_t *output_pkts;
+};
+
 /**
- * @brief Feed a list packets into an eBPF program.
+ * @brief Feed a range of packets into an eBPF program.
  * @details This is a mock function emulating the behavior of a running
- * eBPF program. It takes a list of input packets and iteratively parses them
- * using the given imported ebpf_filter function. The output defines whether
- * or not the packet is "dropped." If the packet is not dropped, its content is
- * copied and appended to an output packet list.
- *
- * @param pkt_list A list of input packets running through the filter.
- * @return The list of packets "surviving" the filter function
+ * eBPF program. It iteratively parses the packets of the shard using the
+ * given imported ebpf_filter function. The output defines whether or not the
+ * packet is "dropped." If the packet is not dropped, it is removed from the
+ * input list and appended to the output list of the shard. The filter works
+ * on the packet data in place, so no copy is needed to emulate an outgoing
+ * packet.
  */
-pcap_list_t *feed_packets(packet_filter ebpf_filter, pcap_list_t *pkt_list, int debug) {
-    pcap_list_t *output_pkts = allocate_pkt_list();
-    uint32_t list_len = get_pkt_list_length(pkt_list);
-    for (uint32_t i = 0; i < list_len; i++) {
+static void *feed_shard(void *arg) {
+    struct feed_shard *shard = arg;
+    if (shard->private_tables)
+        registry_create_view();
+    shard->output_pkts = allocate_pkt_list();
+    for (uint32_t i = shard->start; i < shard->end; i++) {
         /* Parse each packet in the list and check the result */
         struct sk_buff skb;
-        pcap_pkt *input_pkt = get_packet(pkt_list, i);
+        pcap_pkt *input_pkt = get_packet(shard->pkt_list, i);
         skb.data = (void *) input_pkt->data;
-        skb.len = input_pkt->pcap_hdr.len;
-        int result = ebpf_filter(&skb);
+        skb.len = input_pkt->pcap_hdr.caplen;
+        int result = shard->ebpf_filter(&skb);
         if (result != 0) {
-            /* We copy the entire content to emulate an outgoing packet */
-            pcap_pkt *out_pkt = copy_pkt(input_pkt);
-            output_pkts = append_packet(output_pkts, out_pkt);
+            /* Hand the packet over to the output */
+            remove_packet(shard->pkt_list, i);
+            shard->output_pkts = append_packet(shard->output_pkts, input_pkt);
         }
-        if (debug)
+        if (shard->debug)
             printf("Result of the eBPF parsing is: %d\n", result);
     }
+    if (shard->private_tables)
+        registry_delete_view();
+    return NULL;
+}
+
+/**
+ * @brief Feed a list packets into an eBPF program.
+ * @details Splits the list of input packets into num_threads contiguous
+ * shards and feeds each shard into the filter function on its own thread.
+ * With more than one thread, every thread operates on a private copy of the
+ * tables, so table updates made by the program are not shared between
+ * shards. The outputs of the shards are concatenated in the input order.
+ * If stats is set, the achieved packet rate is printed.
+ *
+ * @param pkt_list A list of input packets running through the filter.
+ * Packets surviving the filter are moved out of this list.
+ * @return The list of packets "surviving" the filter function
+ */
+pcap_list_t *feed_packets(packet_filter ebpf_filter, pcap_list_t *pkt_list,
+                          int debug, int num_threads, int stats) {
+    uint32_t list_len = get_pkt_list_length(pkt_list);
+    if (num_threads < 1)
+        num_threads = 1;
+    if ((uint32_t) num_threads > list_len)
+        num_threads = list_len ? list_len : 1;
+
+    struct feed_shard shards[num_threads];
+    pthread_t threads[num_threads];
+    uint32_t shard_len = list_len / num_threads;
+    uint32_t remainder = list_len % num_threads;
+    uint32_t start = 0;
+    for (int t = 0; t < num_threads; t++) {
+        shards[t].ebpf_filter = ebpf_filter;
+        shards[t].pkt_list = pkt_list;
+        shards[t].start = start;
+        start += shard_len + ((uint32_t) t < remainder ? 1 : 0);
+        shards[t].end = start;
+        shards[t].debug = debug;
+        shards[t].private_tables = num_threads > 1;
+        shards[t].output_pkts = NULL;
+    }
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    if (num_threads == 1) {
+        feed_shard(&shards[0]);
+    } else {
+        for (int t = 0; t < num_threads; t++) {
+            if (pthread_create(&threads[t], NULL, feed_shard, &shards[t]) != 0) {
+                perror("Fatal: Could not create thread");
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (int t = 0; t < num_threads; t++)
+            pthread_join(threads[t], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (stats) {
+        double elapsed_ns = (end.tv_sec - begin.tv_sec) * 1e9 +
+                            (end.tv_nsec - begin.tv_nsec);
+        printf("Processed %u packets on %d thread(s) in %.3f ms: "
+               "%.0f packets/s, %.1f ns/packet\n", list_len, num_threads,
+               elapsed_ns / 1e6, elapsed_ns > 0 ? list_len * 1e9 / elapsed_ns : 0.0,
+               list_len ? elapsed_ns / list_len : 0.0);
+    }
+
+    /* Concatenate the outputs of the shards */
+    pcap_list_t *output_pkts = shards[0].output_pkts;
+    for (int t = 1; t < num_threads; t++) {
+        uint32_t out_len = get_pkt_list_length(shards[t].output_pkts);
+        for (uint32_t i = 0; i < out_len; i++)
+            output_pkts = append_packet(output_pkts, remove_packet(shards[t].output_pkts, i));
+        delete_list(shards[t].output_pkts);
+    }
     return output_pkts;
 }
 
@@ -67,11 +156,12 @@ void write_pkts_to_pcaps(const char *pcap_base, pcap_list_array_t *output_array,
     }
 }
 
-void *run_and_record_output(packet_filter ebpf_filter, const char *pcap_base, pcap_list_t *pkt_list, int debug) {
+void *run_and_record_output(packet_filter ebpf_filter, const char *pcap_base, pcap_list_t *pkt_list,
+                            int debug, int num_threads, int stats) {
     /* Create an array of packet lists */
     pcap_list_array_t *output_array = allocate_pkt_list_array();
     /* Feed the packets into our "loaded" program */
-    pcap_list_t *output_pkts = feed_packets(ebpf_filter, pkt_list, debug);
+    pcap_list_t *output_pkts = feed_packets(ebpf_filter, pkt_list, debug, num_threads, stats);
     /* Split the output packet list by interface. This destroys the list. */
     output_array = split_and_delete_list(output_pkts, output_array);
     /* Write each list to a separate pcap output file */
@@ -28,12 +28,13 @@ limitations under the License.
 
 typedef int (*packet_filter)(SK_BUFF* s);
 
-void *run_and_record_output(packet_filter ebpf_filter, const char *pcap_base, pcap_list_t *pkt_list, int debug);
+void *run_and_record_output(packet_filter ebpf_filter, const char *pcap_base, pcap_list_t *pkt_list,
+                            int debug, int num_threads, int stats);
 void init_ebpf_tables(int debug);
 void delete_ebpf_tables(int debug);
 
-#define RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug) \
-    run_and_record_output(ebpf_filter, pcap_base, input_list, debug)
+#define RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug, num_threads, stats) \
+    run_and_record_output(ebpf_filter, pcap_base, input_list, debug, num_threads, stats)
 #define INIT_EBPF_TABLES(debug) init_ebpf_tables(debug)
 #define DELETE_EBPF_TABLES(debug) delete_ebpf_tables(debug)
 
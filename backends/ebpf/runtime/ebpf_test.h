@@ -102,6 +102,17 @@ struct bpf_table tables[] = {
     registry_update_table_id(index, key, value, flags)
 #define BPF_OBJ_PIN(table, name) registry_add(table)
 #define BPF_OBJ_GET(name) registry_get_id(name)
+#define BPF_USER_COUNTER_READ(index, key, value) \
+    user_counter_read(index, key, value)
+
+/* Reads the counter @key of the table @tbl_id into @value. A missing entry
+ * reads as 0. The userspace tables keep one copy of a per-CPU map.
+ */
+static inline int user_counter_read(int tbl_id, void *key, u32 *value) {
+    u32 *entry = registry_lookup_table_elem_id(tbl_id, key);
+    *value = entry != NULL ? *entry : 0;
+    return 0;
+}
 
 
 /* These should be automatically generated and included in the generated x.h header file */
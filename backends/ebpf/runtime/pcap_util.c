@@ -16,16 +16,52 @@ limitations under the License.
 
 #include <stdlib.h>     // EXIT_SUCCESS, EXIT_FAILURE
 #include <string.h>     // memcpy()
+#include <fcntl.h>      // open()
+#include <unistd.h>     // close()
+#include <byteswap.h>   // bswap_32()
+#include <sys/mman.h>   // mmap()
+#include <sys/stat.h>   // fstat()
 #include "pcap_util.h"
 
 #define DLT_EN10MB 1        // Ethernet Link Type, see also 'man pcap-linktype'
 
+/* Classic pcap file format, see also 'man pcap-savefile' */
+#define PCAP_MAGIC_USEC 0xa1b2c3d4
+#define PCAP_MAGIC_NSEC 0xa1b23c4d
+#define PCAP_MAGIC_USEC_SWAPPED 0xd4c3b2a1
+#define PCAP_MAGIC_NSEC_SWAPPED 0x4d3cb2a1
+
+struct pcap_file_hdr {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+};
+
+struct pcap_record_hdr {
+    uint32_t ts_sec;
+    uint32_t ts_frac;       // microseconds or nanoseconds, depending on magic
+    uint32_t incl_len;
+    uint32_t orig_len;
+};
+
+/* Capture files mapped by map_pkts_from_pcap() */
+struct pcap_mapping {
+    void *addr;
+    size_t len;
+};
+static struct pcap_mapping *mappings = NULL;
+static uint32_t num_mappings = 0;
 
 /* Dynamically-allocated list of packets.
  */
 struct pcap_list {
     pcap_pkt **pkts;
     uint32_t len;
+    uint32_t capacity;
 };
 
 /* An array of lists of packets */
@@ -38,17 +74,30 @@ pcap_list_t *append_packet(pcap_list_t *pkt_list, pcap_pkt *pkt) {
     if (!pkt_list)
         /* If the list is not allocated yet, create it */
         pkt_list = allocate_pkt_list();
-    pkt_list->len++;
-    pkt_list->pkts = realloc(pkt_list->pkts, pkt_list->len * sizeof(pcap_pkt *));
-    if (pkt_list->pkts == NULL) {
-        fprintf(stderr, "Fatal: Failed to expand the"
-            "packet list with size %u !\n", pkt_list->len);
-        exit(EXIT_FAILURE);
+    if (pkt_list->len == pkt_list->capacity) {
+        uint32_t capacity = pkt_list->capacity ? pkt_list->capacity * 2 : 64;
+        pkt_list->pkts = realloc(pkt_list->pkts, capacity * sizeof(pcap_pkt *));
+        if (pkt_list->pkts == NULL) {
+            fprintf(stderr, "Fatal: Failed to expand the "
+                "packet list with size %u !\n", pkt_list->len);
+            exit(EXIT_FAILURE);
+        }
+        pkt_list->capacity = capacity;
     }
-    pkt_list->pkts[pkt_list->len - 1] = pkt;
+    pkt_list->pkts[pkt_list->len++] = pkt;
     return pkt_list;
 }
 
+pcap_pkt *remove_packet(pcap_list_t *pkt_list, uint32_t index) {
+    if (index >= pkt_list->len) {
+        fprintf(stderr, "Index %u exceeds list size %u!\n", index, pkt_list->len);
+        return NULL;
+    }
+    pcap_pkt *pkt = pkt_list->pkts[index];
+    pkt_list->pkts[index] = NULL;
+    return pkt;
+}
+
 pcap_list_array_t *insert_list(pcap_list_array_t *pkt_array, pcap_list_t *pkt_list, uint16_t index) {
     if (!pkt_array)
         /* If the array is not allocated yet, create it */
@@ -107,7 +156,11 @@ pcap_list_array_t *allocate_pkt_list_array() {
 
 void delete_list(pcap_list_t *pkt_list) {
     for(uint32_t i = 0; i < pkt_list->len; i++) {
-        free(pkt_list->pkts[i]->data);
+        /* Skip packets handed over with remove_packet() */
+        if (pkt_list->pkts[i] == NULL)
+            continue;
+        if (!pkt_list->pkts[i]->mapped)
+            free(pkt_list->pkts[i]->data);
         /* Set the data pointer to NULL, to mitigate duplicate frees */
         pkt_list->pkts[i]->data = NULL;
         free(pkt_list->pkts[i]);
@@ -124,7 +177,89 @@ void delete_array(pcap_list_array_t *pkt_list_array) {
     free(pkt_list_array);
 }
 
+/* Memory-maps a classic pcap file and lists its packets in place. The mapping
+   is private, so filters may modify packets without altering the file.
+   Returns NULL if the file cannot be mapped or is in another format. */
+static pcap_list_t *map_pkts_from_pcap(const char *pcap_file_name, iface_index index) {
+    struct pcap_file_hdr file_hdr;
+    struct pcap_record_hdr rec_hdr;
+    struct stat st;
+    int fd = open(pcap_file_name, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(file_hdr)) {
+        close(fd);
+        return NULL;
+    }
+    size_t file_len = st.st_size;
+    char *base = mmap(NULL, file_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    memcpy(&file_hdr, base, sizeof(file_hdr));
+    int swapped = 0, nsec = 0;
+    switch (file_hdr.magic) {
+        case PCAP_MAGIC_USEC: break;
+        case PCAP_MAGIC_NSEC: nsec = 1; break;
+        case PCAP_MAGIC_USEC_SWAPPED: swapped = 1; break;
+        case PCAP_MAGIC_NSEC_SWAPPED: swapped = 1; nsec = 1; break;
+        default:
+            munmap(base, file_len);
+            return NULL;
+    }
+
+    pcap_list_t *pkt_list = allocate_pkt_list();
+    size_t offset = sizeof(file_hdr);
+    while (offset + sizeof(rec_hdr) <= file_len) {
+        memcpy(&rec_hdr, base + offset, sizeof(rec_hdr));
+        offset += sizeof(rec_hdr);
+        if (swapped) {
+            rec_hdr.ts_sec = bswap_32(rec_hdr.ts_sec);
+            rec_hdr.ts_frac = bswap_32(rec_hdr.ts_frac);
+            rec_hdr.incl_len = bswap_32(rec_hdr.incl_len);
+            rec_hdr.orig_len = bswap_32(rec_hdr.orig_len);
+        }
+        if (rec_hdr.incl_len > file_len - offset) {
+            fprintf(stderr, "Warning: Truncated packet in %s\n", pcap_file_name);
+            break;
+        }
+        pcap_pkt *pkt = calloc(1, sizeof(pcap_pkt));
+        pkt->data = base + offset;
+        pkt->mapped = 1;
+        pkt->pcap_hdr.ts.tv_sec = rec_hdr.ts_sec;
+        pkt->pcap_hdr.ts.tv_usec = nsec ? rec_hdr.ts_frac / 1000 : rec_hdr.ts_frac;
+        pkt->pcap_hdr.caplen = rec_hdr.incl_len;
+        pkt->pcap_hdr.len = rec_hdr.orig_len;
+        pkt->ifindex = index;
+        pkt_list = append_packet(pkt_list, pkt);
+        offset += rec_hdr.incl_len;
+    }
+
+    mappings = realloc(mappings, (num_mappings + 1) * sizeof(struct pcap_mapping));
+    if (mappings == NULL) {
+        fprintf(stderr, "Fatal: Failed to record the mapping of %s!\n", pcap_file_name);
+        exit(EXIT_FAILURE);
+    }
+    mappings[num_mappings].addr = base;
+    mappings[num_mappings].len = file_len;
+    num_mappings++;
+    return pkt_list;
+}
+
+void release_pcap_mappings() {
+    for (uint32_t i = 0; i < num_mappings; i++)
+        munmap(mappings[i].addr, mappings[i].len);
+    free(mappings);
+    mappings = NULL;
+    num_mappings = 0;
+}
+
 pcap_list_t *read_pkts_from_pcap(const char *pcap_file_name, iface_index index) {
+    pcap_list_t *mapped_list = map_pkts_from_pcap(pcap_file_name, index);
+    if (mapped_list != NULL)
+        return mapped_list;
+
     struct pcap_pkthdr *pcap_hdr;
     const unsigned char *tmp_pkt;
     char errbuf[PCAP_ERRBUF_SIZE];
@@ -141,8 +276,9 @@ pcap_list_t *read_pkts_from_pcap(const char *pcap_file_name, iface_index index)
     while ((ret = pcap_next_ex(in_handle, &pcap_hdr, &tmp_pkt)) == 1) {
         /* Save the data we extracted from the pcap buffer */
         pcap_pkt *pkt = calloc(1, sizeof(pcap_pkt));
-        pkt->data = calloc(pcap_hdr->len, 1);
-        memcpy(pkt->data, tmp_pkt, pcap_hdr->len);
+        /* Only the captured bytes are stored, as in copy_pkt */
+        pkt->data = calloc(pcap_hdr->caplen, 1);
+        memcpy(pkt->data, tmp_pkt, pcap_hdr->caplen);
         /* Also save the header and the interface "index" */
         pkt->pcap_hdr = *pcap_hdr;
         pkt->ifindex = index;
@@ -220,8 +356,10 @@ pcap_list_array_t *split_and_delete_list(pcap_list_t *input_list, pcap_list_arra
 }
 
 pcap_pkt *copy_pkt(pcap_pkt *src_pkt) {
-    pcap_pkt *new_pkt = malloc(sizeof(pcap_pkt));
-    uint32_t datalen = src_pkt->pcap_hdr.len;
+    /* The copy owns its data, even if the source is mapped */
+    pcap_pkt *new_pkt = calloc(1, sizeof(pcap_pkt));
+    /* Only the captured bytes are stored */
+    uint32_t datalen = src_pkt->pcap_hdr.caplen;
     new_pkt->data = malloc(datalen);
     memcpy(new_pkt->data, src_pkt->data, datalen);
     new_pkt->pcap_hdr = src_pkt->pcap_hdr;
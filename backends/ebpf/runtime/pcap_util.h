@@ -37,6 +37,8 @@ typedef struct {
     char *data;
     struct pcap_pkthdr pcap_hdr;
     iface_index ifindex;
+    /* data points into a memory-mapped capture file and is not freed */
+    uint8_t mapped;
 } pcap_pkt;
 
 struct pcap_list;
@@ -48,10 +50,12 @@ typedef struct pcap_list_array pcap_list_array_t;
  * @brief Retrieve packets from a pcap file.
  * @details Retrieves a list of packets from a given pcap file.
  * Allocates a packet list and fills it with the packets from the
- * supplied pcap file. All data in the capture file is copied to the new list.
+ * supplied pcap file. Files in the classic pcap format are memory-mapped
+ * privately and the packets reference their data in place; other formats
+ * are read with libpcap and their data is copied to the new list.
  * Each packet is assigned the given interface index as meta-information.
  * A list allocated by this function should subsequently be freed by
- * delete_list().
+ * delete_list(), and the mapped files released by release_pcap_mappings().
  *
  * @param pcap_file_name The exact name of the pcap file.
  * @param index Interface index of the file.
@@ -61,6 +65,12 @@ typedef struct pcap_list_array pcap_list_array_t;
  */
 pcap_list_t *read_pkts_from_pcap(const char *pcap_file_name, iface_index index);
 
+/**
+ * @brief Unmap all capture files mapped by read_pkts_from_pcap().
+ * @details Packets referencing mapped data must not be used afterwards.
+ */
+void release_pcap_mappings();
+
 /**
  * @brief Write a list of packets to a pcap file.
  * @details Iteratively dumps the packets to the given filename.
@@ -100,8 +110,8 @@ pcap_list_array_t *split_and_delete_list(pcap_list_t *input_list, pcap_list_arra
 /**
  * @brief Appends a  packet to a given list of packets.
  * @details This function takes a pointer to a packet and appends it to the
- * given list. If the list is Null, it is allocated. For each new packet
- * to append, the list is expanded by the size of the packet pointer.
+ * given list. If the list is Null, it is allocated. When the list is full,
+ * its capacity is doubled, so appending takes amortized constant time.
  *
  * @param pkt_list List descriptor. Can be Null
  * @param pkt Pointer of the packet to append.
@@ -111,6 +121,18 @@ pcap_list_array_t *split_and_delete_list(pcap_list_t *input_list, pcap_list_arra
  */
 pcap_list_t *append_packet(pcap_list_t *pkt_list, pcap_pkt *pkt);
 
+/**
+ * @brief Removes a packet from a list without deleting it.
+ * @details Hands the ownership of the packet at the given index over to the
+ * caller. The slot is left empty and is skipped when the list is deleted.
+ *
+ * @param pkt_list A list.
+ * @param index Index of the packet to remove.
+ *
+ * @return The removed packet. Null if the index is out of bounds.
+ */
+pcap_pkt *remove_packet(pcap_list_t *pkt_list, uint32_t index);
+
 /**
  * @brief Inserts a packet list in the array at a given index.
  * @details This function takes a pointer to a packet list and inserts it at
@@ -24,7 +24,7 @@ BUILDDIR:= $(BPFDIR)build
 override INCLUDES+= -I$(ROOT_DIR) -include $(ROOT_DIR)ebpf_runtime_$(TARGET).h
 # Optimization flags to save space
 override CFLAGS+= -O2 -g # -Wall -Werror
-override LIBS+= -lpcap
+override LIBS+= -lpcap -lpthread
 
 # The base files required to build the runtime
 SOURCE_BASE= $(ROOT_DIR)ebpf_runtime.c $(ROOT_DIR)pcap_util.c
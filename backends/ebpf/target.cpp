@@ -279,6 +279,10 @@ void BccTarget::emitTableDecl(Util::SourceCodeBuilder* builder,
         kind = "hash";
     else if (tableKind == TableArray)
         kind = "array";
+    else if (tableKind == TablePerCPUHash)
+        kind = "percpu_hash";
+    else if (tableKind == TablePerCPUArray)
+        kind = "percpu_array";
     else if (tableKind == TableLPMTrie)
         kind = "lpm_trie";
     else
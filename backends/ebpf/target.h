@@ -31,6 +31,7 @@ enum TableKind {
     TableHash,
     TableArray,
     TablePerCPUArray,
+    TablePerCPUHash,
     TableProgArray,
     TableLPMTrie,  // longest prefix match trie
     TableHashLRU,
@@ -105,6 +106,8 @@ class Target {
     // Path on /sys filesystem where maps are stored
     virtual cstring sysMapPath() const = 0;
     virtual cstring packetDescriptorType() const = 0;
+    // Whether all the entries of array maps exist as soon as the map is created.
+    virtual bool arrayMapsArePreallocated() const { return true; }
 
     virtual void emitPreamble(Util::SourceCodeBuilder* builder) const;
     /// Emit trace message which will be printed during packet processing (if enabled).
@@ -136,6 +139,8 @@ class KernelSamplesTarget : public Target {
             return "BPF_MAP_TYPE_ARRAY";
         } else if (kind == TablePerCPUArray) {
             return "BPF_MAP_TYPE_PERCPU_ARRAY";
+        } else if (kind == TablePerCPUHash) {
+            return "BPF_MAP_TYPE_PERCPU_HASH";
         } else if (kind == TableLPMTrie) {
             return "BPF_MAP_TYPE_LPM_TRIE";
         } else if (kind == TableHashLRU) {
@@ -239,6 +244,16 @@ class TestTarget : public EBPF::KernelSamplesTarget {
     void emitTableDecl(Util::SourceCodeBuilder* builder,
                        cstring tblName, TableKind tableKind,
                        cstring keyType, cstring valueType, unsigned size) const override;
+    // The userspace maps do not implement map-in-map.
+    void emitMapInMapDecl(Util::SourceCodeBuilder* builder,
+                          cstring innerName, TableKind innerTableKind,
+                          cstring innerKeyType, cstring innerValueType, unsigned innerSize,
+                          cstring outerName, TableKind outerTableKind,
+                          cstring outerKeyType, unsigned outerSize) const override {
+        Target::emitMapInMapDecl(builder, innerName, innerTableKind, innerKeyType,
+                                 innerValueType, innerSize, outerName, outerTableKind,
+                                 outerKeyType, outerSize);
+    }
     cstring dataOffset(cstring base) const override
     { return cstring("((void*)(long)")+ base + "->data)"; }
     cstring dataEnd(cstring base) const override
@@ -248,6 +263,8 @@ class TestTarget : public EBPF::KernelSamplesTarget {
     cstring abortReturnCode() const override { return "false"; }
     cstring sysMapPath() const override { return "/sys/fs/bpf"; }
     cstring packetDescriptorType() const override { return "struct __sk_buff"; }
+    // Userspace maps are hash maps regardless of their kind.
+    bool arrayMapsArePreallocated() const override { return false; }
 };
 
 }  // namespace EBPF
@@ -36,32 +36,165 @@ class eBPFCommand(object):
         self.extra = extra          # could also be "pcapng"
 
 
+# Adds an entry to a ternary table (see the tuple space search section of
+# backends/ebpf/README.md). The tuple of a new mask is a hash map created
+# like the <table>_tuple map the program declares, and the list of masks
+# is rewritten sorted by decreasing maximum priority.
+TERNARY_ADD = """
+static void {table}_add_ternary(struct {table}_key *key, struct {table}_key *mask,
+                               struct {table}_value *value) {{
+    int prefixes = BPF_OBJ_GET(MAP_PATH "/{table}_prefixes");
+    int tuples = BPF_OBJ_GET(MAP_PATH "/{table}_tuples_map");
+    int prototype = BPF_OBJ_GET(MAP_PATH "/{table}_tuple");
+    if (prefixes < 0 || tuples < 0 || prototype < 0) {{
+        fprintf(stderr, "map {table} not loaded\\n"); exit(1);
+    }}
+    struct {table}_key_mask head, m, masks[MAX_TERNARY_MASKS];
+    struct {table}_value_mask elem, elems[MAX_TERNARY_MASKS];
+    memset(&head, 0, sizeof(head));
+    memset(&m, 0, sizeof(m));
+    memcpy(m.mask, mask, sizeof(*mask));
+    if (memcmp(&m, &head, sizeof(m)) == 0) {{
+        fprintf(stderr, "{table}: the all-zero mask is the list head\\n"); exit(1);
+    }}
+    for (unsigned i = 0; i < sizeof(*key); i++)
+        ((u8 *) key)[i] &= m.mask[i];
+
+    int count = 0, found = -1;
+    if (bpf_map_lookup_elem(prefixes, &head, &elem) == 0 && elem.has_next) {{
+        masks[0] = elem.next_tuple_mask;
+        while (bpf_map_lookup_elem(prefixes, &masks[count], &elems[count]) == 0) {{
+            if (memcmp(&masks[count], &m, sizeof(m)) == 0)
+                found = count;
+            if (!elems[count++].has_next || count == MAX_TERNARY_MASKS)
+                break;
+            masks[count] = elems[count - 1].next_tuple_mask;
+        }}
+    }}
+
+    int tuple;
+    if (found < 0) {{
+        if (count == MAX_TERNARY_MASKS - 1) {{
+            fprintf(stderr, "{table}: too many masks\\n"); exit(1);
+        }}
+        struct bpf_map_info info;
+        __u32 length = sizeof(info);
+        memset(&info, 0, sizeof(info));
+        if (bpf_obj_get_info_by_fd(prototype, &info, &length) != 0) {{
+            perror("Could not read {table}_tuple"); exit(1);
+        }}
+        tuple = bpf_create_map(info.type, info.key_size, info.value_size, info.max_entries, 0);
+        u32 id = count;
+        if (tuple < 0 || BPF_USER_MAP_UPDATE_ELEM(tuples, &id, &tuple, BPF_ANY) != 0) {{
+            perror("Could not write in {table}_tuples_map"); exit(1);
+        }}
+        masks[count] = m;
+        memset(&elems[count], 0, sizeof(elems[count]));
+        elems[count].tuple_id = id;
+        elems[count].max_priority = value->priority;
+        found = count++;
+    }} else {{
+        u32 inner_id;
+        if (bpf_map_lookup_elem(tuples, &elems[found].tuple_id, &inner_id) != 0 ||
+            (tuple = bpf_map_get_fd_by_id(inner_id)) < 0) {{
+            perror("Could not read {table}_tuples_map"); exit(1);
+        }}
+        if (elems[found].max_priority < value->priority)
+            elems[found].max_priority = value->priority;
+    }}
+    if (BPF_USER_MAP_UPDATE_ELEM(tuple, key, value, BPF_ANY) != 0) {{
+        perror("Could not write in {table}"); exit(1);
+    }}
+
+    for (int i = 1; i < count; i++) {{
+        for (int j = i; j > 0 && elems[j - 1].max_priority < elems[j].max_priority; j--) {{
+            m = masks[j]; masks[j] = masks[j - 1]; masks[j - 1] = m;
+            elem = elems[j]; elems[j] = elems[j - 1]; elems[j - 1] = elem;
+        }}
+    }}
+    for (int i = count - 1; i >= -1; i--) {{
+        struct {table}_value_mask *e = i < 0 ? &elem : &elems[i];
+        if (i < 0)
+            memset(&elem, 0, sizeof(elem));
+        memset(&e->next_tuple_mask, 0, sizeof(e->next_tuple_mask));
+        e->has_next = i + 1 < count;
+        if (e->has_next)
+            e->next_tuple_mask = masks[i + 1];
+        if (BPF_USER_MAP_UPDATE_ELEM(prefixes, i < 0 ? &head : &masks[i], e, BPF_ANY) != 0) {{
+            perror("Could not write in {table}_prefixes"); exit(1);
+        }}
+    }}
+}}
+"""
+
+
+def _ternary_tables(cmds):
+    """ Returns the tables with an entry with a ternary ("*") match value:
+    the entries of these tables are added with a <table>_add_ternary
+    function. """
+    return sorted(set(cmd.table for cmd in cmds if cmd.a_type == "add" and
+                      any("*" in str(key_field[1]) for key_field in cmd.match)))
+
+
+def _generate_ternary_functions(cmds):
+    generated = ""
+    tables = _ternary_tables(cmds)
+    if tables:
+        # As many masks as p4c-ebpf allows, the list head included
+        generated += "#define MAX_TERNARY_MASKS 128\n"
+    for table in tables:
+        generated += TERNARY_ADD.format(table=table)
+    return generated
+
+
 def _generate_control_actions(cmds):
     """ Generates the actual control plane commands.
     This function inserts C code for all the "add" commands that have
     been parsed. """
     generated = ""
+    ternary_tables = _ternary_tables(cmds)
     for index, cmd in enumerate(cmds):
         key_name = "key_%s%d" % (cmd.table, index)
+        mask_name = "mask_%s%d" % (cmd.table, index)
         value_name = "value_%s%d" % (cmd.table, index)
+        ternary = cmd.a_type == "add" and cmd.table in ternary_tables
         if cmd.a_type == "setdefault":
             tbl_name = cmd.table + "_defaultAction"
             generated += "u32 %s = 0;\n\t" % (key_name)
         else:
             generated += "struct %s_key %s = {};\n\t" % (cmd.table, key_name)
+            if ternary:
+                generated += "struct %s_key %s;\n\t" % (cmd.table, mask_name)
+                generated += "memset(&%s, 0, sizeof(%s));\n\t" % (mask_name, mask_name)
             tbl_name = cmd.table
             for key_num, key_field in enumerate(cmd.match):
                 field = key_field[0].split('.')[1]
+                value = key_field[1]
+                if ternary and "*" in value:
+                    # Each "*" is a nibble which is not part of the match
+                    digits = value[2:]
+                    generated += ("%s.%s = 0x%s;\n\t"
+                                  % (key_name, field, digits.replace("*", "0")))
+                    generated += ("%s.%s = 0x%s;\n\t"
+                                  % (mask_name, field,
+                                     "".join("0" if d == "*" else "f" for d in digits)))
+                    continue
                 generated += ("%s.%s = %s;\n\t"
-                              % (key_name, field, key_field[1]))
-        generated += ("tableFileDescriptor = "
-                      "BPF_OBJ_GET(MAP_PATH \"/%s\");\n\t" %
-                      tbl_name)
-        generated += ("if (tableFileDescriptor < 0) {"
-                      "fprintf(stderr, \"map %s not loaded\");"
-                      " exit(1); }\n\t" % tbl_name)
+                              % (key_name, field, value))
+                if ternary:
+                    generated += ("memset(&%s.%s, 0xff, sizeof(%s.%s));\n\t"
+                                  % (mask_name, field, mask_name, field))
+        if not ternary:
+            generated += ("tableFileDescriptor = "
+                          "BPF_OBJ_GET(MAP_PATH \"/%s\");\n\t" %
+                          tbl_name)
+            generated += ("if (tableFileDescriptor < 0) {"
+                          "fprintf(stderr, \"map %s not loaded\");"
+                          " exit(1); }\n\t" % tbl_name)
         generated += ("struct %s_value %s = {\n\t\t" % (
             cmd.table, value_name))
+        if ternary:
+            generated += ".priority = %s,\n\t\t" % (cmd.priority or 0)
         if cmd.action[0] == "_NoAction":
             generated += ".action = 0,\n\t\t"
         else:
@@ -72,6 +205,10 @@ def _generate_control_actions(cmds):
             generated += "%s," % val_field[1]
         generated += "}},\n\t"
         generated += "};\n\t"
+        if ternary:
+            generated += ("%s_add_ternary(&%s, &%s, &%s);\n"
+                          % (cmd.table, key_name, mask_name, value_name))
+            continue
         generated += ("ok = BPF_USER_MAP_UPDATE_ELEM"
                       "(tableFileDescriptor, &%s, &%s, BPF_ANY);\n\t"
                       % (key_name, value_name))
@@ -80,7 +217,36 @@ def _generate_control_actions(cmds):
     return generated
 
 
-def create_table_file(actions, tmpdir, file_name):
+def _generate_counter_checks(checks):
+    """ Generates the function which compares the counters with the
+    "check_counter" commands after the packets are processed. An eBPF
+    counter holds a single value, which is compared whatever the count
+    type of the command. @return the number of failed checks. """
+    generated = "static inline int check_counters() {\n\t"
+    generated += "int failed = 0;\n\t"
+    if checks:
+        generated += "int counterFileDescriptor;\n\t"
+        generated += "u32 counterKey;\n\t"
+        generated += "u32 counterValue;\n\t"
+    for counter, index, (_, op, expected) in checks:
+        generated += ("counterFileDescriptor = "
+                      "BPF_OBJ_GET(MAP_PATH \"/%s\");\n\t" % counter)
+        generated += ("if (counterFileDescriptor < 0) {"
+                      "fprintf(stderr, \"map %s not loaded\");"
+                      " exit(1); }\n\t" % counter)
+        generated += "counterKey = %s;\n\t" % index
+        generated += ("if (BPF_USER_COUNTER_READ(counterFileDescriptor, "
+                      "&counterKey, &counterValue) != 0) {"
+                      "perror(\"Could not read %s\"); exit(1); }\n\t" % counter)
+        generated += ("if (!(counterValue %s %s)) {"
+                      "fprintf(stderr, \"counter %s(%s) is %%u, expected %s %s\\n\", "
+                      "counterValue); failed++; }\n\t"
+                      % (op, expected, counter, index, op, expected))
+    generated += "return failed;\n}\n"
+    return generated
+
+
+def create_table_file(actions, tmpdir, file_name, checks=[]):
     """ Create the control plane file.
     The control commands are provided by the stf parser.
     This generated file is required by ebpf_runtime.c to initialize
@@ -89,13 +255,15 @@ def create_table_file(actions, tmpdir, file_name):
     try:
         with open(tmpdir + "/" + file_name, "w+") as control_file:
             control_file.write("#include \"test.h\"\n\n")
+            control_file.write(_generate_ternary_functions(actions))
             control_file.write("static inline void setup_control_plane() {")
             control_file.write("\n\t")
             control_file.write("int ok;\n\t")
             control_file.write("int tableFileDescriptor;\n\t")
             generated_cmds = _generate_control_actions(actions)
             control_file.write(generated_cmds)
-            control_file.write("}\n")
+            control_file.write("}\n\n")
+            control_file.write(_generate_counter_checks(checks))
     except OSError as e:
         err = e
         return FAILURE, err
@@ -110,6 +278,7 @@ def parse_stf_file(raw_stf):
     stf_map, errs = parser.parse(stf_str)
     input_pkts = {}
     cmds = []
+    checks = []
     expected = {}
     for stf_entry in stf_map:
         if stf_entry[0] == "packet":
@@ -134,4 +303,6 @@ def parse_stf_file(raw_stf):
             cmd = eBPFCommand(
                 a_type=stf_entry[0], table=stf_entry[1], action=stf_entry[2])
             cmds.append(cmd)
-    return input_pkts, cmds, expected
+        elif stf_entry[0] == "check_counter":
+            checks.append(stf_entry[1:])
+    return input_pkts, cmds, checks, expected
@@ -147,9 +147,10 @@ class EBPFTarget(object):
             header for the runtime, which contains the extracted control
              plane commands """
         with open(stffile) as raw_stf:
-            input_pkts, cmds, self.expected = parse_stf_file(
+            input_pkts, cmds, checks, self.expected = parse_stf_file(
                 raw_stf)
-            result, err = create_table_file(cmds, self.tmpdir, "control.h")
+            result, err = create_table_file(cmds, self.tmpdir, "control.h",
+                                            checks)
             if result != SUCCESS:
                 return result
             result = self._write_pcap_files(input_pkts)
@@ -21,6 +21,7 @@ limitations under the License.
 #include "control-plane/p4RuntimeSerializer.h"
 #include "ir/ir.h"
 #include "ir/json_loader.h"
+#include "lib/compile_server.h"
 #include "lib/log.h"
 #include "lib/error.h"
 #include "lib/exceptions.h"
@@ -83,10 +84,7 @@ static void log_dump(const IR::Node *node, const char *head) {
             std::cout << *node << std::endl; }
 }
 
-int main(int argc, char *const argv[]) {
-    setup_gc_logging();
-    setup_signals();
-
+static int compile(int argc, char *const argv[]) {
     AutoCompileContext autoP4TestContext(new P4TestContext);
     auto& options = P4TestContext::get().options();
     options.langVersion = CompilerOptions::FrontendVersion::P4_16;
@@ -188,3 +186,12 @@ int main(int argc, char *const argv[]) {
         std::cerr << "Done." << std::endl;
     return ::errorCount() > 0;
 }
+
+int main(int argc, char *const argv[]) {
+    setup_gc_logging();
+    setup_signals();
+
+    if (Util::CompileServer::requested(argc, argv))
+        return Util::CompileServer::serve(argc, argv, compile);
+    return compile(argc, argv);
+}
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Compiles P4 programs with p4test, directly and on a p4test compile server
+# through the p4c driver, and checks that both give the same exit code,
+# output files, standard output and standard error.
+
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+SUCCESS = 0
+FAILURE = 1
+
+
+def usage(binary):
+    print(binary, "usage:")
+    print(binary, "rootdir file.p4 [file.p4 ...]")
+    print("Compiles each file twice on a compile server and once directly, and")
+    print("compares the results; run from the folder with the p4test binary.")
+    print("`rootdir` is the root directory of the compiler source tree")
+
+
+class Run(object):
+    # the results of one compilation
+    def __init__(self, code, files):
+        self.code = code
+        self.files = files          # output file name -> contents
+
+    def diff(self, other, what):
+        if self.code != other.code:
+            print(what, "exit code", other.code, "instead of", self.code)
+            return FAILURE
+        result = SUCCESS
+        for name in sorted(self.files):
+            if self.files[name] != other.files[name]:
+                print(what, name, "differs:")
+                print(other.files[name])
+                result = FAILURE
+        return result
+
+
+class Tester(object):
+    def __init__(self, rootdir, tmpdir):
+        sys.path.insert(0, os.path.join(rootdir, "tools", "driver"))
+        from p4c_src.driver import BackendDriver
+        self.tmpdir = tmpdir
+        self.socket = os.path.join(tmpdir, "socket")
+        self.driver = BackendDriver("p4test", "v1model")
+        self.driver._server_socket = self.socket
+        self.server = None
+
+    def start(self):
+        self.server = subprocess.Popen(["./p4test", "--server", self.socket])
+        for _ in range(300):
+            if os.path.exists(self.socket):
+                return SUCCESS
+            time.sleep(0.1)
+        print("The compile server did not start")
+        return FAILURE
+
+    def stop(self):
+        if self.server is not None:
+            self.server.kill()
+            self.server.wait()
+
+    def run(self, args, onServer):
+        # Runs p4test with args, directly or on the server, with its
+        # standard output and error in files.
+        out = os.path.join(self.tmpdir, "stdout")
+        err = os.path.join(self.tmpdir, "stderr")
+        pp = os.path.join(self.tmpdir, "pp.p4")
+        if os.path.exists(pp):
+            os.remove(pp)
+        args = ["./p4test"] + [a.replace("PP", pp) for a in args]
+        with open(out, "w") as stdout, open(err, "w") as stderr:
+            if onServer:
+                # The server writes to our own standard output and error.
+                sys.stdout.flush()
+                sys.stderr.flush()
+                saved = [os.dup(1), os.dup(2)]
+                os.dup2(stdout.fileno(), 1)
+                os.dup2(stderr.fileno(), 2)
+                try:
+                    code = self.driver.runOnServer(args)
+                finally:
+                    os.dup2(saved[0], 1)
+                    os.dup2(saved[1], 2)
+                    for fd in saved:
+                        os.close(fd)
+                if code is None:
+                    print("The compile server did not run", " ".join(args))
+                    code = -1
+            else:
+                code = subprocess.call(args, stdout=stdout, stderr=stderr)
+        files = {}
+        for name in [out, err, pp]:
+            if os.path.exists(name):
+                with open(name) as f:
+                    files[os.path.basename(name)] = f.read()
+            else:
+                files[os.path.basename(name)] = None
+        return Run(code, files)
+
+    def check(self, args):
+        # Runs args directly, then twice on the server, and compares.
+        print("Checking", " ".join(args))
+        expected = self.run(args, False)
+        result = SUCCESS
+        for what in ["First server run:", "Second server run:"]:
+            if expected.diff(self.run(args, True), what) != SUCCESS:
+                result = FAILURE
+        return result
+
+
+def main(argv):
+    if len(argv) < 3:
+        usage(argv[0])
+        return FAILURE
+    rootdir = argv[1]
+    tmpdir = tempfile.mkdtemp(dir=".")
+    tester = Tester(rootdir, tmpdir)
+    result = tester.start()
+    try:
+        if result == SUCCESS:
+            for p4file in argv[2:]:
+                if tester.check(["--pp", "PP", p4file]) != SUCCESS:
+                    result = FAILURE
+            # This request ends the worker with exit(); the next one runs in
+            # a new worker.
+            if tester.check(["--listFrontendPasses"]) != SUCCESS:
+                result = FAILURE
+            if tester.check(["--pp", "PP", argv[-1]]) != SUCCESS:
+                result = FAILURE
+    finally:
+        tester.stop()
+    if result == SUCCESS:
+        shutil.rmtree(tmpdir)
+    else:
+        print("Results are in", tmpdir)
+    return result
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
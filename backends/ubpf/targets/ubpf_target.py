@@ -100,7 +100,7 @@ class Target(EBPFTarget):
 
     def generate_model_inputs(self, stffile):
         with open(stffile) as raw_stf:
-            input_pkts, cmds, self.expected = parse_stf_file(
+            input_pkts, cmds, _, self.expected = parse_stf_file(
                 raw_stf)
             result, err = self.create_ubpf_table_file(cmds, self.tmpdir, "control.h")
             if result != SUCCESS:
@@ -75,13 +75,13 @@ namespace UBPF {
         UbpfCodeBuilder c(target);
         UbpfCodeBuilder h(target);
 
+        // The code is written to the files as it is generated.
+        c.setOutput(cstream);
+        h.setOutput(hstream);
         prog->emitH(&h, hfile);
         prog->emitC(&c, UBPF::extract_file_name(hfile.c_str()));
-
-        *cstream << c.toString();
-        *hstream << h.toString();
-        cstream->flush();
-        hstream->flush();
+        c.flush();
+        h.flush();
     }
 
     std::string extract_file_name(const std::string &fullPath) {
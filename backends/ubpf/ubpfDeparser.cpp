@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "ubpfDeparser.h"
+#include "ubpfParser.h"
 #include "ubpfType.h"
 #include "frontends/p4/methodInstance.h"
 
@@ -264,8 +265,32 @@ void UBPFDeparserTranslationVisitor::compileEmit(const IR::Vector<IR::Argument>
     builder->emitIndent();
     builder->newline();
 
+    if (deparser->inPlaceEmit) {
+        builder->emitIndent();
+        builder->appendFormat("if (%s == 0) ", program->outerHdrOffsetVar.c_str());
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("/* header is at its parsed offset */");
+        compileEmitFields(expr, ht, true);
+        builder->blockEnd(false);
+        builder->append(" else ");
+        builder->blockStart();
+        compileEmitFields(expr, ht, false);
+        builder->blockEnd(true);
+    } else {
+        compileEmitFields(expr, ht, false);
+    }
+
+    builder->blockEnd(true);
+}
+
+void UBPFDeparserTranslationVisitor::compileEmitFields(const IR::Expression *expr,
+                                                       const IR::Type_Header *header,
+                                                       bool modifiedOnly) {
+    auto program = deparser->program;
     unsigned alignment = 0;
-    for (auto f : ht->fields) {
+    unsigned skipped = 0;
+    for (auto f : header->fields) {
         auto ftype = typeMap->getType(f);
         auto etype = UBPFTypeFactory::instance->create(ftype);
         auto et = dynamic_cast<EBPF::IHasWidth *>(etype);
@@ -274,12 +299,26 @@ void UBPFDeparserTranslationVisitor::compileEmit(const IR::Vector<IR::Argument>
                     "Only headers with fixed widths supported %1%", f);
             return;
         }
-        compileEmitField(expr, f->name, alignment, etype);
+        if (modifiedOnly && !deparser->modifiedFields->isModified(header, f->name)) {
+            // the packet already holds the parsed value of this field
+            skipped += et->widthInBits();
+        } else {
+            if (skipped != 0) {
+                builder->emitIndent();
+                builder->appendFormat("%s += %d", program->offsetVar.c_str(), skipped);
+                builder->endOfStatement(true);
+                skipped = 0;
+            }
+            compileEmitField(expr, f->name, alignment, etype);
+        }
         alignment += et->widthInBits();
         alignment %= 8;
     }
-
-    builder->blockEnd(true);
+    if (skipped != 0) {
+        builder->emitIndent();
+        builder->appendFormat("%s += %d", program->offsetVar.c_str(), skipped);
+        builder->endOfStatement(true);
+    }
 }
 
 bool UBPFDeparserTranslationVisitor::preorder(const IR::MethodCallExpression *expression) {
@@ -319,6 +358,14 @@ bool UBPFDeparser::build() {
     codeGen = new UBPFDeparserTranslationVisitor(this);
     codeGen->substitute(headers, parserHeaders);
 
+    auto finder = new EBPF::FindModifiedHeaderFields(program->refMap, program->typeMap);
+    program->program->apply(*finder);
+    modifiedFields = finder;
+    inPlaceEmit = !finder->validityChanged &&
+            EBPF::emitOrderMatchesParser(program->parser->parserBlock->container,
+                                         controlBlock->container,
+                                         program->refMap, program->typeMap);
+
     return ::errorCount() == 0;
 }
 
@@ -20,6 +20,7 @@ limitations under the License.
 #include "ir/ir.h"
 #include "ubpfProgram.h"
 #include "ebpf/ebpfObject.h"
+#include "ebpf/ebpfDeparser.h"
 #include "ubpfHelpers.h"
 
 namespace UBPF {
@@ -35,6 +36,8 @@ namespace UBPF {
 
         virtual void compileEmitField(const IR::Expression *expr, cstring field,
                                       unsigned alignment, EBPF::EBPFType *type);
+        virtual void compileEmitFields(const IR::Expression *expr, const IR::Type_Header *header,
+                                       bool modifiedOnly);
         virtual void compileEmit(const IR::Vector<IR::Argument> *args);
 
         bool notSupported(const IR::Expression* expression)
@@ -67,6 +70,13 @@ namespace UBPF {
 
         UBPFDeparserTranslationVisitor *codeGen;
 
+        // Set when the headers are emitted in the order in which the parser
+        // extracts them and no header validity may change. If in addition the
+        // packet length does not change, the headers are at their parsed
+        // offsets, and only the fields which may have been modified are written.
+        bool inPlaceEmit = false;
+        const EBPF::FindModifiedHeaderFields *modifiedFields = nullptr;
+
         UBPFDeparser(const UBPFProgram *program, const IR::ControlBlock *block,
                      const IR::Parameter *parserHeaders) :
                 program(program), controlBlock(block), headers(nullptr),
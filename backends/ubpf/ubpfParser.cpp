@@ -31,6 +31,8 @@ class UBPFStateTranslationVisitor : public EBPF::CodeGenInspector {
 
     P4::P4CoreLibrary& p4lib;
     const UBPFParserState* state;
+    // true when the packet length was checked for all extracts of the state
+    bool stateLengthChecked = false;
 
     void emitCheckPacketLength(const IR::Expression* expr, const char * varname, unsigned width);
     void emitCheckPacketLength(const IR::Expression* expr)
@@ -104,7 +106,12 @@ bool UBPFStateTranslationVisitor::preorder(const IR::ParserState* parserState) {
     builder->spc();
     builder->blockStart();
 
+    unsigned width = state->coalescedExtractWidth();
+    if (width != 0)
+        emitCheckPacketLength(width);
+    stateLengthChecked = width != 0;
     visit(parserState->components, "components");
+    stateLengthChecked = false;
     if (parserState->selectExpression == nullptr) {
         builder->emitIndent();
         builder->append(" goto ");
@@ -301,8 +308,8 @@ UBPFStateTranslationVisitor::compileExtract(const IR::Expression* destination) {
         return;
     }
 
-    unsigned width = ht->width_bits();
-    emitCheckPacketLength(width);
+    if (!stateLengthChecked)
+        emitCheckPacketLength(ht->width_bits());
 
     unsigned alignment = 0;
     for (auto f : ht->fields) {
@@ -181,6 +181,12 @@ UBPFTable::UBPFTable(const UBPFProgram *program,
     keyGenerator = table->container->getKey();
     actionList = table->container->getActionList();
 
+    if (auto annotation =
+            table->container->getAnnotation(IR::Annotation::entriesFileAnnotation))
+        ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                "%1%: tables cannot read their entries from a file on the uBPF target",
+                annotation);
+
     keyType = new IR::Type_Struct(IR::ID(keyTypeName));
     valueType = new IR::Type_Struct(IR::ID(valueTypeName));
 
@@ -4,6 +4,9 @@
 /* Define to 1 if you have the boost graph headers */
 #cmakedefine HAVE_LIBBOOST_GRAPH 1
 
+/* Define to 1 if you have the boost wave library */
+#cmakedefine HAVE_LIBBOOST_WAVE 1
+
 /* Define to 1 if you have the execinfo.h header */
 #cmakedefine HAVE_EXECINFO_H 1
 
@@ -0,0 +1,480 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "bulkEntries.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/coreLibrary.h"
+#include "frontends/p4/typeMap.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+namespace ControlPlaneAPI {
+
+namespace {
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && isspace(static_cast<unsigned char>(*p)))
+        p++;
+    return p;
+}
+
+/// Parses a number in [begin, end); returns false if it is not one.
+bool parseNumber(const char* begin, const char* end, big_int& value) {
+    unsigned base = 10;
+    if (end - begin > 2 && begin[0] == '0') {
+        if (begin[1] == 'x' || begin[1] == 'X') {
+            base = 16;
+            begin += 2;
+        } else if (begin[1] == 'b' || begin[1] == 'B') {
+            base = 2;
+            begin += 2;
+        }
+    }
+    if (begin == end)
+        return false;
+    value = 0;
+    for (auto p = begin; p < end; p++) {
+        unsigned digit;
+        if (*p >= '0' && *p <= '9')
+            digit = *p - '0';
+        else if (*p >= 'a' && *p <= 'f')
+            digit = *p - 'a' + 10;
+        else if (*p >= 'A' && *p <= 'F')
+            digit = *p - 'A' + 10;
+        else
+            return false;
+        if (digit >= base)
+            return false;
+        value = value * base + digit;
+    }
+    return true;
+}
+
+/// Finds the first occurrence of @pattern in [begin, end), or end.
+const char* find(const char* begin, const char* end, const char* pattern) {
+    size_t n = strlen(pattern);
+    for (auto p = begin; p + n <= end; p++) {
+        if (memcmp(p, pattern, n) == 0)
+            return p;
+    }
+    return end;
+}
+
+bool fits(const big_int& value, int width) {
+    return value >= 0 && (value >> width) == 0;
+}
+
+/// An entries file mapped in memory. Mappings outlive a compilation, so that
+/// a compile server reads an unchanged file only once.
+struct MappedFile {
+    /// Identity of the file when it was mapped.
+    struct stat status;
+    const char* data = nullptr;
+    size_t length = 0;
+    size_t count = 0;
+    /// Shapes of the tables (see BulkEntries::shape) which the entries were
+    /// found valid for.
+    std::set<std::string> validFor;
+};
+
+bool sameFile(const struct stat& a, const struct stat& b) {
+#ifdef __APPLE__
+    auto& aTime = a.st_mtimespec;
+    auto& bTime = b.st_mtimespec;
+#else
+    auto& aTime = a.st_mtim;
+    auto& bTime = b.st_mtim;
+#endif
+    return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_size == b.st_size &&
+           aTime.tv_sec == bTime.tv_sec && aTime.tv_nsec == bTime.tv_nsec;
+}
+
+/// @return @file as an absolute path. A compile server runs in the folder
+/// of each client, so relative names of different files can be the same.
+cstring absolutePath(cstring file) {
+    if (file.startsWith("/"))
+        return file;
+    char* cwd = getcwd(nullptr, 0);
+    if (cwd == nullptr)
+        return file;
+    cstring result = cstring(cwd) + "/" + file;
+    free(cwd);
+    return result;
+}
+
+/// @return the mapping of @file, or nullptr if it cannot be read. A file
+/// which changed since it was last mapped is mapped again.
+MappedFile* mapFile(cstring file) {
+    static std::map<cstring, MappedFile> files;
+
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat status;
+    if (fstat(fd, &status) < 0) {
+        close(fd);
+        return nullptr;
+    }
+    auto it = files.find(file);
+    if (it != files.end()) {
+        if (sameFile(it->second.status, status)) {
+            close(fd);
+            return &it->second;
+        }
+        if (it->second.length > 0)
+            munmap(const_cast<char*>(it->second.data), it->second.length);
+        files.erase(it);
+    }
+
+    MappedFile mapped;
+    mapped.status = status;
+    mapped.length = status.st_size;
+    if (mapped.length > 0) {
+        void* data = mmap(nullptr, mapped.length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return nullptr;
+        }
+        // The pages are only read sequentially, once per consumer.
+        madvise(data, mapped.length, MADV_SEQUENTIAL);
+        mapped.data = static_cast<const char*>(data);
+    }
+    close(fd);
+    return &files.emplace(file, std::move(mapped)).first->second;
+}
+
+}  // namespace
+
+bool BulkEntries::parse(const char* begin, const char* end, size_t line, Entry& entry) const {
+    entry.line = line;
+    entry.keys.clear();
+    entry.arguments.clear();
+    entry.action = nullptr;
+
+    auto arrow = find(begin, end, "=>");
+    if (arrow == end) {
+        ::error(ErrorType::ERR_INVALID, "%1%:%2%: expected '=>' between keys and action",
+                fileName, line);
+        return false;
+    }
+
+    auto p = skipSpaces(begin, arrow);
+    while (p < arrow) {
+        auto tokenEnd = p;
+        while (tokenEnd < arrow && !isspace(static_cast<unsigned char>(*tokenEnd)))
+            tokenEnd++;
+        // "value &&& mask" may be written with spaces around the operator
+        auto next = skipSpaces(tokenEnd, arrow);
+        if (arrow - next >= 3 && strncmp(next, "&&&", 3) == 0) {
+            tokenEnd = skipSpaces(next + 3, arrow);
+            while (tokenEnd < arrow && !isspace(static_cast<unsigned char>(*tokenEnd)))
+                tokenEnd++;
+        } else if (tokenEnd - p >= 3 && strncmp(tokenEnd - 3, "&&&", 3) == 0) {
+            tokenEnd = next;
+            while (tokenEnd < arrow && !isspace(static_cast<unsigned char>(*tokenEnd)))
+                tokenEnd++;
+        }
+
+        Key key;
+        bool ok;
+        const char* op;
+        if (tokenEnd - p == 1 && *p == '_') {
+            key.kind = Key::DONT_CARE;
+            ok = true;
+        } else if ((op = find(p, tokenEnd, "&&&")) != tokenEnd) {
+            key.kind = Key::MASK;
+            auto valueEnd = op;
+            while (valueEnd > p && isspace(static_cast<unsigned char>(valueEnd[-1])))
+                valueEnd--;
+            ok = parseNumber(p, valueEnd, key.value) &&
+                 parseNumber(skipSpaces(op + 3, tokenEnd), tokenEnd, key.mask);
+        } else if ((op = find(p, tokenEnd, "..")) != tokenEnd) {
+            key.kind = Key::RANGE;
+            ok = parseNumber(p, op, key.value) && parseNumber(op + 2, tokenEnd, key.mask);
+        } else if ((op = find(p, tokenEnd, "/")) != tokenEnd) {
+            key.kind = Key::PREFIX;
+            big_int prefix;
+            ok = parseNumber(p, op, key.value) && parseNumber(op + 1, tokenEnd, prefix) &&
+                 prefix <= 0xffff;
+            if (ok)
+                key.prefixLength = static_cast<unsigned>(prefix);
+        } else {
+            ok = parseNumber(p, tokenEnd, key.value);
+        }
+        if (!ok) {
+            ::error(ErrorType::ERR_INVALID, "%1%:%2%: invalid key '%3%'",
+                    fileName, line, std::string(p, tokenEnd));
+            return false;
+        }
+        entry.keys.push_back(key);
+        p = skipSpaces(tokenEnd, arrow);
+    }
+
+    // Action name, optionally followed by a parenthesized argument list
+    p = skipSpaces(arrow + 2, end);
+    auto nameEnd = p;
+    while (nameEnd < end && (isalnum(static_cast<unsigned char>(*nameEnd)) ||
+                             *nameEnd == '_' || *nameEnd == '.'))
+        nameEnd++;
+    cstring name(std::string(p, nameEnd));
+    auto action = actions.find(name);
+    if (action == actions.end()) {
+        ::error(ErrorType::ERR_INVALID, "%1%:%2%: '%3%' is not an action of the table",
+                fileName, line, name);
+        return false;
+    }
+    entry.action = action->second;
+
+    p = skipSpaces(nameEnd, end);
+    if (p < end && *p == '(') {
+        auto close = std::find(p, end, ')');
+        if (close == end) {
+            ::error(ErrorType::ERR_INVALID, "%1%:%2%: expected ')'", fileName, line);
+            return false;
+        }
+        p = skipSpaces(p + 1, close);
+        while (p < close) {
+            auto comma = std::find(p, close, ',');
+            auto argEnd = comma;
+            while (argEnd > p && isspace(static_cast<unsigned char>(argEnd[-1])))
+                argEnd--;
+            big_int value;
+            if (!parseNumber(p, argEnd, value)) {
+                ::error(ErrorType::ERR_INVALID, "%1%:%2%: invalid action argument '%3%'",
+                        fileName, line, std::string(p, argEnd));
+                return false;
+            }
+            entry.arguments.push_back(value);
+            p = comma == close ? close : skipSpaces(comma + 1, close);
+        }
+        p = skipSpaces(close + 1, end);
+    }
+    if (p != end) {
+        ::error(ErrorType::ERR_INVALID, "%1%:%2%: unexpected '%3%' after action",
+                fileName, line, std::string(p, end));
+        return false;
+    }
+    return true;
+}
+
+bool BulkEntries::validate(const Entry& entry) const {
+    auto& corelib = P4CoreLibrary::instance;
+    if (entry.keys.size() != widths.size()) {
+        ::error(ErrorType::ERR_INVALID, "%1%:%2%: expected %3% keys, found %4%",
+                fileName, entry.line, widths.size(), entry.keys.size());
+        return false;
+    }
+    for (size_t i = 0; i < entry.keys.size(); i++) {
+        auto& key = entry.keys[i];
+        auto width = widths[i];
+        auto kind = matchKinds[i];
+        bool allowed;
+        switch (key.kind) {
+        case Key::EXACT:
+            allowed = true;
+            break;
+        case Key::MASK:
+            allowed = kind == corelib.ternaryMatch.name;
+            break;
+        case Key::PREFIX:
+            allowed = kind == corelib.lpmMatch.name;
+            break;
+        case Key::RANGE:
+            allowed = kind == "range";
+            break;
+        default:
+            allowed = kind != corelib.exactMatch.name;
+            break;
+        }
+        if (!allowed) {
+            ::error(ErrorType::ERR_INVALID, "%1%:%2%: key %3% is not valid for a %4% match",
+                    fileName, entry.line, i + 1, kind);
+            return false;
+        }
+        if (!fits(key.value, width) ||
+            ((key.kind == Key::MASK || key.kind == Key::RANGE) && !fits(key.mask, width)) ||
+            (key.kind == Key::PREFIX && key.prefixLength > static_cast<unsigned>(width))) {
+            ::error(ErrorType::ERR_INVALID, "%1%:%2%: key %3% does not fit in %4% bits",
+                    fileName, entry.line, i + 1, width);
+            return false;
+        }
+        if (key.kind == Key::RANGE && key.value > key.mask) {
+            ::error(ErrorType::ERR_INVALID, "%1%:%2%: invalid range for key %3%",
+                    fileName, entry.line, i + 1);
+            return false;
+        }
+    }
+
+    auto& params = parameterWidths.at(entry.action);
+    if (entry.arguments.size() != params.size()) {
+        ::error(ErrorType::ERR_INVALID, "%1%:%2%: action %3% expects %4% arguments",
+                fileName, entry.line, entry.action->externalName(), params.size());
+        return false;
+    }
+    for (size_t i = 0; i < params.size(); i++) {
+        if (!fits(entry.arguments[i], params[i])) {
+            ::error(ErrorType::ERR_INVALID, "%1%:%2%: argument %3% does not fit in %4% bits",
+                    fileName, entry.line, i + 1, params[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void BulkEntries::forEach(std::function<void(const Entry&)> fn) const {
+    Entry entry;
+    size_t line = 0;
+    auto end = data + length;
+    for (auto p = data; p < end;) {
+        auto eol = std::find(p, end, '\n');
+        line++;
+        auto begin = skipSpaces(p, eol);
+        auto lineEnd = eol;
+        while (lineEnd > begin && isspace(static_cast<unsigned char>(lineEnd[-1])))
+            lineEnd--;
+        if (begin < lineEnd && *begin != '#' && parse(begin, lineEnd, line, entry))
+            fn(entry);
+        p = eol == end ? end : eol + 1;
+    }
+}
+
+void BulkEntries::describe(const IR::P4Table* table, ReferenceMap* refMap, TypeMap* typeMap) {
+    widths.clear();
+    matchKinds.clear();
+    actions.clear();
+    parameterWidths.clear();
+    if (auto key = table->getKey()) {
+        for (auto ke : key->keyElements) {
+            auto type = typeMap->getType(ke->expression, true);
+            widths.push_back(typeMap->widthBits(type, ke->expression, false));
+            auto mt = refMap->getDeclaration(ke->matchType->path, true)->to<IR::Declaration_ID>();
+            BUG_CHECK(mt != nullptr, "%1%: could not find declaration", ke->matchType);
+            matchKinds.push_back(mt->name.name);
+        }
+    }
+    for (auto ale : table->getActionList()->actionList) {
+        auto decl = refMap->getDeclaration(ale->getPath(), true)->to<IR::P4Action>();
+        BUG_CHECK(decl != nullptr, "%1%: not an action", ale);
+        if (ale->getAnnotation(IR::Annotation::defaultOnlyAnnotation))
+            continue;
+        actions.emplace(decl->name.name, decl);
+        actions.emplace(decl->externalName(), decl);
+        auto& paramWidths = parameterWidths[decl];
+        for (auto p : decl->parameters->parameters) {
+            if (p->direction != IR::Direction::None)
+                continue;
+            auto type = typeMap->getType(p, true);
+            paramWidths.push_back(typeMap->widthBits(type, p, false));
+        }
+    }
+}
+
+std::string BulkEntries::shape() const {
+    std::stringstream result;
+    for (size_t i = 0; i < widths.size(); i++)
+        result << matchKinds[i] << ":" << widths[i] << " ";
+    for (auto& action : actions) {
+        result << action.first << "(";
+        for (auto width : parameterWidths.at(action.second))
+            result << width << " ";
+        result << ") ";
+    }
+    return result.str();
+}
+
+/* static */
+const BulkEntries* BulkEntries::get(const IR::P4Table* table, ReferenceMap* refMap,
+                                    TypeMap* typeMap) {
+    auto annotation = table->getAnnotation(IR::Annotation::entriesFileAnnotation);
+    if (annotation == nullptr)
+        return nullptr;
+    if (table->getEntries() != nullptr) {
+        ::error(ErrorType::ERR_INVALID, "%1%: table cannot have both entries and %2%",
+                table, annotation);
+        return nullptr;
+    }
+
+    // Like #include "file": relative to the directory of the P4 source
+    // file first, then to the working folder.
+    auto file = annotation->getSingleString();
+    cstring path;
+    MappedFile* mapped = nullptr;
+    if (!file.startsWith("/")) {
+        auto source = table->srcInfo.toPosition().fileName;
+        auto slash = source.findlast('/');
+        if (slash != nullptr) {
+            path = source.before(slash) + "/" + file;
+            mapped = mapFile(absolutePath(path));
+        }
+    }
+    if (mapped == nullptr) {
+        path = file;
+        mapped = mapFile(absolutePath(path));
+    }
+    if (mapped == nullptr) {
+        ::error(ErrorType::ERR_IO, "%1%: cannot open entries file %2%", annotation, file);
+        return nullptr;
+    }
+
+    auto result = new BulkEntries();
+    result->fileName = path;
+    result->data = mapped->data;
+    result->length = mapped->length;
+    result->describe(table, refMap, typeMap);
+
+    // Check every entry once for each table shape the file is used with;
+    // the consumers only convert them. Invalid files are checked again
+    // each time, so that every compilation reports the errors.
+    auto shape = result->shape();
+    if (mapped->validFor.count(shape) == 0) {
+        auto errors = ::errorCount();
+        bool valid = true;
+        size_t count = 0;
+        result->forEach([&](const Entry& entry) {
+            if (!result->validate(entry))
+                valid = false;
+            count++;
+        });
+        if (!valid || ::errorCount() > errors)
+            return nullptr;
+        mapped->count = count;
+        mapped->validFor.insert(shape);
+    }
+    result->count = mapped->count;
+    LOG1("Read " << result->count << " entries for " << table->controlPlaneName()
+         << " from " << result->fileName);
+    return result;
+}
+
+}  // namespace ControlPlaneAPI
+
+}  // namespace P4
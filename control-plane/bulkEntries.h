@@ -0,0 +1,118 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef CONTROL_PLANE_BULKENTRIES_H_
+#define CONTROL_PLANE_BULKENTRIES_H_
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "lib/cstring.h"
+#include "lib/gmputil.h"
+
+namespace IR {
+
+class P4Action;
+class P4Table;
+
+}  // namespace IR
+
+namespace P4 {
+
+class ReferenceMap;
+class TypeMap;
+
+namespace ControlPlaneAPI {
+
+/**
+ * Static entries of a table kept outside of the IR. A table annotated with
+ * @entries_file("file") gets its entries from a text file, one entry per line:
+ *
+ *     <key> <key> ... => <action>(<arg>, <arg>, ...)
+ *
+ * Each key is a value (exact match), "value &&& mask" (ternary), "value/length"
+ * (lpm), "low..high" (range) or "_" (don't care); values are decimal, or
+ * hexadecimal and binary numbers prefixed with 0x and 0b. Lines starting with
+ * '#' are comments. As for "const entries", earlier entries take precedence.
+ *
+ * The file is memory-mapped and checked against the key and the actions of
+ * the table; the entries are then parsed again while they are emitted, so
+ * they never exist as IR nodes or all at once in memory. The mapping is kept
+ * while the file does not change, and a file is not checked again for a
+ * table with the same key and actions.
+ */
+class BulkEntries {
+ public:
+    struct Key {
+        enum Kind { EXACT, MASK, PREFIX, RANGE, DONT_CARE };
+        Kind kind = EXACT;
+        big_int value;
+        /// The mask for MASK, the upper bound for RANGE.
+        big_int mask;
+        unsigned prefixLength = 0;
+    };
+
+    struct Entry {
+        size_t line = 0;
+        std::vector<Key> keys;
+        const IR::P4Action* action = nullptr;
+        std::vector<big_int> arguments;
+    };
+
+    /// @return the entries of @table, or nullptr if it has no @entries_file
+    /// annotation or the file is not valid for the table. The result should
+    /// be used right away: it refers to the current mapping of the file,
+    /// which is replaced when a later call finds that the file changed.
+    static const BulkEntries* get(const IR::P4Table* table, ReferenceMap* refMap,
+                                  TypeMap* typeMap);
+
+    /// Calls @fn for each entry, in file order.
+    void forEach(std::function<void(const Entry&)> fn) const;
+    size_t size() const { return count; }
+    cstring getFileName() const { return fileName; }
+    /// Width of each key field and match kind of the table.
+    const std::vector<int>& keyWidths() const { return widths; }
+    const std::vector<cstring>& keyMatchKinds() const { return matchKinds; }
+    /// Width of each action data parameter of @action.
+    const std::vector<int>& actionDataWidths(const IR::P4Action* action) const {
+        return parameterWidths.at(action); }
+
+ private:
+    cstring fileName;
+    const char* data = nullptr;
+    size_t length = 0;
+    size_t count = 0;
+    std::vector<int> widths;
+    std::vector<cstring> matchKinds;
+    /// Actions of the table by name.
+    std::map<cstring, const IR::P4Action*> actions;
+    std::map<const IR::P4Action*, std::vector<int>> parameterWidths;
+
+    BulkEntries() = default;
+    /// Reads the key and the actions of @table.
+    void describe(const IR::P4Table* table, ReferenceMap* refMap, TypeMap* typeMap);
+    bool parse(const char* begin, const char* end, size_t line, Entry& entry) const;
+    bool validate(const Entry& entry) const;
+    /// @return a description of the key and the actions of the table, which
+    /// is all that the validity of an entry depends on.
+    std::string shape() const;
+};
+
+}  // namespace ControlPlaneAPI
+
+}  // namespace P4
+
+#endif  // CONTROL_PLANE_BULKENTRIES_H_
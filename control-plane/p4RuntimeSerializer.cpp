@@ -56,6 +56,7 @@ limitations under the License.
 #include "lib/nullstream.h"
 #include "lib/ordered_set.h"
 
+#include "bulkEntries.h"
 #include "bytestrings.h"
 #include "flattenHeader.h"
 #include "p4RuntimeSerializer.h"
@@ -1465,6 +1466,11 @@ class P4RuntimeEntriesConverter {
         CHECK_NULL(tableBlock);
         auto table = tableBlock->container;
 
+        if (auto bulk = BulkEntries::get(table, refMap, typeMap)) {
+            addBulkEntries(table, archHandler->getControlPlaneName(tableBlock), bulk, refMap);
+            return;
+        }
+
         auto entriesList = table->getEntries();
         if (entriesList == nullptr) return;
 
@@ -1499,6 +1505,85 @@ class P4RuntimeEntriesConverter {
         }
     }
 
+    /// Appends the entries read from the @entries_file of the table to the
+    /// WriteRequest message, one at a time and without creating IR nodes.
+    void addBulkEntries(const IR::P4Table* table, cstring tableName,
+                        const BulkEntries* bulk, ReferenceMap* refMap) {
+        using Key = BulkEntries::Key;
+        auto tableId = symbols.getId(P4RuntimeSymbolType::TABLE(), tableName);
+        // Same priorities as for 'const entries': the first entry wins
+        int entryPriority = bulk->size();
+        auto needsPriority = tableNeedsPriority(table, refMap);
+        auto& widths = bulk->keyWidths();
+        auto& matchKinds = bulk->keyMatchKinds();
+        bulk->forEach([&](const BulkEntries::Entry& e) {
+            auto protoUpdate = entries->add_updates();
+            protoUpdate->set_type(p4v1::Update::INSERT);
+            auto protoEntry = protoUpdate->mutable_entity()->mutable_table_entry();
+            protoEntry->set_table_id(tableId);
+
+            for (size_t i = 0; i < e.keys.size(); i++) {
+                auto& k = e.keys[i];
+                auto width = widths[i];
+                auto matchType = matchKinds[i];
+                // don't care keys are omitted from P4Runtime messages
+                if (k.kind == Key::DONT_CARE) continue;
+                auto protoMatch = protoEntry->add_match();
+                protoMatch->set_field_id(i + 1);
+                if (matchType == P4CoreLibrary::instance.exactMatch.name) {
+                    protoMatch->mutable_exact()->set_value(*stringReprConstant(k.value, width));
+                } else if (matchType == P4CoreLibrary::instance.lpmMatch.name) {
+                    int prefixLen = width;
+                    if (k.kind == Key::PREFIX) prefixLen = k.prefixLength;
+                    if (prefixLen == 0) {
+                        protoEntry->mutable_match()->RemoveLast();
+                        continue;
+                    }
+                    auto mask = Util::maskFromSlice(width - 1, width - prefixLen);
+                    auto protoLpm = protoMatch->mutable_lpm();
+                    protoLpm->set_value(*stringReprConstant(k.value & mask, width));
+                    protoLpm->set_prefix_len(prefixLen);
+                } else if (matchType == P4CoreLibrary::instance.ternaryMatch.name) {
+                    big_int mask = k.kind == Key::MASK ? k.mask : Util::mask(width);
+                    if (mask == 0) {
+                        protoEntry->mutable_match()->RemoveLast();
+                        continue;
+                    }
+                    auto protoTernary = protoMatch->mutable_ternary();
+                    protoTernary->set_value(*stringReprConstant(k.value & mask, width));
+                    protoTernary->set_mask(*stringReprConstant(mask, width));
+                } else if (matchType == P4V1::V1Model::instance.rangeMatchType.name) {
+                    big_int high = k.kind == Key::RANGE ? k.mask : k.value;
+                    if (k.value == 0 && high == Util::mask(width)) {
+                        protoEntry->mutable_match()->RemoveLast();
+                        continue;
+                    }
+                    auto protoRange = protoMatch->mutable_range();
+                    protoRange->set_low(*stringReprConstant(k.value, width));
+                    protoRange->set_high(*stringReprConstant(high, width));
+                } else if (matchType == P4V1::V1Model::instance.optionalMatchType.name) {
+                    protoMatch->mutable_optional()->set_value(
+                        *stringReprConstant(k.value, width));
+                } else {
+                    ::error(ErrorType::ERR_UNSUPPORTED,
+                         "%1%: match type not supported by P4Runtime serializer", matchType);
+                    protoEntry->mutable_match()->RemoveLast();
+                }
+            }
+
+            auto actionName = e.action->controlPlaneName();
+            auto protoAction = protoEntry->mutable_action()->mutable_action();
+            protoAction->set_action_id(symbols.getId(P4RuntimeSymbolType::ACTION(), actionName));
+            auto& dataWidths = bulk->actionDataWidths(e.action);
+            for (size_t i = 0; i < e.arguments.size(); i++) {
+                auto protoParam = protoAction->add_params();
+                protoParam->set_param_id(i + 1);
+                protoParam->set_value(*stringReprConstant(e.arguments[i], dataWidths[i]));
+            }
+            if (needsPriority) protoEntry->set_priority(entryPriority--);
+        });
+    }
+
     /// Checks if the @table entries need to be assigned a priority, i.e. does
     /// the match key for the table includes a ternary, range, or optional match?
     bool tableNeedsPriority(const IR::P4Table* table, ReferenceMap* refMap) const {
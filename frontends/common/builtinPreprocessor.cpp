@@ -0,0 +1,773 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "builtinPreprocessor.h"
+
+#include "config.h"
+
+#if HAVE_LIBBOOST_WAVE
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include <boost/wave.hpp>
+#include <boost/wave/cpplexer/cpp_lex_iterator.hpp>
+#include <boost/wave/cpplexer/cpp_lex_token.hpp>
+#endif
+
+#include "lib/error.h"
+#include "lib/log.h"
+
+namespace P4 {
+
+#if HAVE_LIBBOOST_WAVE
+
+namespace {
+
+/// @return the macro X of an include guard "#ifndef X" or "#if !defined(X)"
+/// ... "#endif" which covers all of @text but whitespace, or an empty string.
+/// cpp does not read such a file again while X is defined. As comments are
+/// kept (-C), a comment outside of the guard disables this.
+std::string findIncludeGuard(const char* text, size_t size) {
+    const char* end = text + size;
+    auto skipBlanks = [end](const char*& p) {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+    };
+    auto identifier = [end](const char*& p) {
+        auto start = p;
+        while (p < end && (isalnum(*p) || *p == '_'))
+            p++;
+        return std::string(start, p);
+    };
+    auto directive = [&](const char*& p) {
+        skipBlanks(p);
+        if (p == end || *p != '#')
+            return std::string();
+        p++;
+        skipBlanks(p);
+        return identifier(p);
+    };
+    // Moves to the next line, following comments and string literals.
+    bool comment = false;
+    auto nextLine = [end, &comment](const char* p) {
+        while (p < end && *p != '\n') {
+            if (comment) {
+                if (*p == '*' && p + 1 < end && p[1] == '/') {
+                    comment = false;
+                    p++;
+                }
+            } else if (*p == '/' && p + 1 < end && p[1] == '*') {
+                comment = true;
+                p++;
+            } else if (*p == '/' && p + 1 < end && p[1] == '/') {
+                while (p < end && *p != '\n')
+                    p++;
+                break;
+            } else if (*p == '"') {
+                for (p++; p < end && *p != '"' && *p != '\n'; p++)
+                    if (*p == '\\' && p + 1 < end)
+                        p++;
+                if (p == end || *p == '\n')
+                    break;
+            }
+            p++;
+        }
+        return p < end ? p + 1 : end;
+    };
+
+    auto p = text;
+    while (p < end && isspace(*p))
+        p++;
+    auto name = directive(p);
+    std::string macro;
+    skipBlanks(p);
+    if (name == "ifndef") {
+        macro = identifier(p);
+    } else if (name == "if" && p < end && *p == '!') {
+        p++;
+        skipBlanks(p);
+        if (identifier(p) == "defined") {
+            skipBlanks(p);
+            bool parenthesis = p < end && *p == '(';
+            if (parenthesis) {
+                p++;
+                skipBlanks(p);
+            }
+            macro = identifier(p);
+            skipBlanks(p);
+            if (parenthesis && (p == end || *p++ != ')'))
+                macro.clear();
+        }
+    }
+    if (macro.empty())
+        return macro;
+
+    int depth = 1;
+    for (p = nextLine(p); p < end; p = nextLine(p)) {
+        if (comment)
+            continue;
+        auto name = directive(p);
+        if (name == "if" || name == "ifdef" || name == "ifndef") {
+            depth++;
+        } else if ((name == "else" || name == "elif") && depth == 1) {
+            return "";
+        } else if (name == "endif" && --depth == 0) {
+            for (p = nextLine(p); p < end && isspace(*p); p++) {}
+            return p == end && !comment ? macro : "";
+        }
+    }
+    return "";
+}
+
+/// The contents of a source file, mapped in memory.
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    dev_t device = 0;
+    ino_t inode = 0;
+    off_t fileSize = -1;
+    struct timespec modified = {};
+    /// A copy of the file with a newline appended, used if the file does not
+    /// end with one: Wave rejects a directive on the last line otherwise.
+    std::string terminated;
+    /// See findIncludeGuard.
+    std::string includeGuard;
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    ~MappedFile() {
+        if (size != 0 && terminated.empty())
+            munmap(const_cast<char*>(data), size);
+    }
+
+    /// @return true if @st describes the file as it was mapped.
+    bool current(const struct stat& st) const {
+        return device == st.st_dev && inode == st.st_ino && fileSize == st.st_size &&
+               modified.tv_sec == st.st_mtim.tv_sec && modified.tv_nsec == st.st_mtim.tv_nsec;
+    }
+};
+
+/// Mapped files in the folders of the include path, by name. They stay
+/// mapped until they change, so a compile server maps the architecture
+/// includes once.
+std::map<std::string, std::unique_ptr<MappedFile>> cachedFiles;
+/// The other mapped files, and the cached mappings of files which changed;
+/// the tokens of the current run may point into them until its end.
+std::map<std::string, std::unique_ptr<MappedFile>> runFiles;
+std::vector<std::unique_ptr<MappedFile>> replacedFiles;
+/// The include path of the current run.
+std::vector<std::string> cachedFolders;
+
+/// Unmaps the files which are not cached at the end of a run.
+struct ReleaseRunFiles {
+    ~ReleaseRunFiles() {
+        runFiles.clear();
+        replacedFiles.clear();
+        cachedFolders.clear();
+    }
+};
+
+bool inIncludePath(const std::string& file) {
+    for (auto& folder : cachedFolders) {
+        if (file.size() > folder.size() && file.compare(0, folder.size(), folder) == 0 &&
+            file[folder.size()] == '/')
+            return true;
+    }
+    return false;
+}
+
+/// @return the contents of @file, or nullptr if it cannot be read.
+const MappedFile* mapFile(const std::string& file) {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return nullptr;
+    auto& files = inIncludePath(file) ? cachedFiles : runFiles;
+    auto& entry = files[file];
+    if (entry && entry->current(st))
+        return entry.get();
+    if (entry)
+        replacedFiles.push_back(std::move(entry));
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile);
+    if (st.st_size == 0) {
+        mapped->data = "";
+    } else {
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            files.erase(file);
+            return nullptr;
+        }
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            files.erase(file);
+            return nullptr;
+        }
+        mapped->data = static_cast<const char*>(data);
+        mapped->size = st.st_size;
+        if (mapped->data[mapped->size - 1] != '\n') {
+            mapped->terminated.assign(mapped->data, mapped->size);
+            mapped->terminated += '\n';
+            munmap(data, st.st_size);
+            mapped->data = mapped->terminated.data();
+            mapped->size = mapped->terminated.size();
+        }
+    }
+    mapped->device = st.st_dev;
+    mapped->inode = st.st_ino;
+    mapped->fileSize = st.st_size;
+    mapped->modified = st.st_mtim;
+    mapped->includeGuard = findIncludeGuard(mapped->data, mapped->size);
+    LOG2("Mapped " << file);
+    entry = std::move(mapped);
+    return entry.get();
+}
+
+bool isFile(const std::string& file) {
+    struct stat st;
+    return stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+/// Input policy of the Wave context: the lexer reads the mapped files.
+struct MappedInput {
+    template <typename IterationContext>
+    class inner {
+     public:
+        template <typename Position>
+        static void init_iterators(IterationContext& iterationContext, Position const& position,
+                                   boost::wave::language_support language) {
+            typedef typename IterationContext::iterator_type Iterator;
+            auto file = mapFile(iterationContext.filename.c_str());
+            if (file == nullptr) {
+                BOOST_WAVE_THROW_CTX(iterationContext.ctx, boost::wave::preprocess_exception,
+                                     bad_include_file, iterationContext.filename.c_str(),
+                                     position);
+                return;
+            }
+            iterationContext.first = Iterator(file->data, file->data + file->size,
+                                              Position(iterationContext.filename), language);
+            iterationContext.last = Iterator();
+        }
+    };
+};
+
+typedef boost::wave::cpplexer::lex_token<> Token;
+
+/// Writes the preprocessed tokens the way cpp does (see c-ppoutput.c in gcc).
+class Writer {
+    struct File {
+        /// Name the file was opened with.
+        std::string name;
+        /// Name in the line markers, changed by #line.
+        std::string presumed;
+        /// Line of the #include directive being processed.
+        unsigned includeLine;
+    };
+
+    std::string& out;
+    /// __FILE__ in the main file as expanded by Wave, which only knows the
+    /// absolute name, and as expanded by cpp.
+    std::string waveMainName, mainName;
+    std::vector<std::string> includePath;
+    /// The files being read, the innermost last.
+    std::vector<File> files;
+    /// The files included so far.
+    std::set<std::string> included;
+    /// Source line of the current output line.
+    unsigned line = 0;
+    /// True if the current output line has text.
+    bool printed = false;
+    /// True until the first token of each source line.
+    bool lineStart = true;
+    /// True if whitespace precedes the next token.
+    bool space = false;
+    /// Set if the first token of the line comes from a macro expansion: the
+    /// position of the outermost macro call.
+    bool fromMacro = false;
+    unsigned macroLine = 0, macroColumn = 0;
+    unsigned directiveLine = 0;
+    /// The last token written on the current line, if any.
+    Token previous;
+    bool hasPrevious = false;
+
+    static std::string escape(const std::string& name) {
+        std::string result;
+        for (auto c : name) {
+            if (c == '\\' || c == '"')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+
+    void marker(unsigned at, const std::string& file, const char* flags) {
+        if (printed)
+            out += '\n';
+        printed = false;
+        out += "# " + std::to_string(at) + " \"" + escape(file) + "\"" + flags + "\n";
+        line = at;
+    }
+
+    /// Ends the current output line and moves to line @at, with newlines if
+    /// it is close and with a marker otherwise.
+    void moveTo(unsigned at) {
+        if (printed) {
+            out += '\n';
+            line++;
+            printed = false;
+        }
+        if (at >= line && at < line + 8) {
+            out.append(at - line, '\n');
+            line = at;
+        } else {
+            marker(at, files.back().presumed, "");
+        }
+    }
+
+    void endLine() {
+        lineStart = true;
+        space = false;
+        fromMacro = false;
+        hasPrevious = false;
+    }
+
+    /// @return true if @second follows @first in the source without whitespace.
+    static bool adjacent(const Token& first, const Token& second) {
+        auto& a = first.get_position();
+        auto& b = second.get_position();
+        return a.get_line() == b.get_line() &&
+               a.get_column() + first.get_value().size() == b.get_column() &&
+               a.get_file() == b.get_file();
+    }
+
+    /// @return true if @first and @second would read as different tokens
+    /// when written without a space (cpp_avoid_paste in gcc).
+    static bool mayPaste(const Token& first, const Token& second) {
+        enum Kind { Name, Number, Char, String, Operator };
+        auto kind = [](const std::string& text) {
+            if (isalpha(text[0]) || text[0] == '_')
+                return Name;
+            if (isdigit(text[0]) || (text[0] == '.' && text.size() > 1 && isdigit(text[1])))
+                return Number;
+            return text[0] == '\'' ? Char : text[0] == '"' ? String : Operator;
+        };
+        std::string a = first.get_value().c_str(), b = second.get_value().c_str();
+        if (a.empty() || b.empty())
+            return false;
+        auto kindA = kind(a), kindB = kind(b);
+        int c = kindB == Operator ? b[0] : EOF;
+        static const std::set<std::string> assignable = {
+            "=", "!", ">", "<", "+", "-", "*", "/", "%", "&", "|", "^", ">>", "<<" };
+        if (c == '=' && assignable.count(a))
+            return true;
+        if (kindA == Name)
+            return kindB == Name || kindB == Char || kindB == String;
+        if (kindA == Number)
+            return kindB == Number || kindB == Name || kindB == Char ||
+                   c == '.' || c == '+' || c == '-';
+        if (a == ">") return c == '>';
+        if (a == "<") return c == '<' || c == '%' || c == ':';
+        if (a == "+") return c == '+';
+        if (a == "-") return c == '-' || c == '>';
+        if (a == "/") return c == '/' || c == '*';
+        if (a == "%") return c == ':' || c == '%';
+        if (a == "&") return c == '&';
+        if (a == "|") return c == '|';
+        if (a == ":") return c == ':' || c == '>';
+        if (a == "->") return c == '*';
+        if (a == ".") return c == '.' || c == '%' || kindB == Number;
+        if (a == "#") return c == '#' || c == '%';
+        return false;
+    }
+
+ public:
+    Writer(std::string& out, const std::string& file, const std::string& waveName,
+           std::vector<std::string> includePath)
+            : out(out), waveMainName("\"" + escape(waveName) + "\""),
+              mainName("\"" + escape(file) + "\""), includePath(std::move(includePath)) {
+        files.push_back({ file, file, 0 });
+        marker(0, file, "");
+        marker(0, "<built-in>", "");
+        marker(0, "<command-line>", "");
+        marker(1, file, "");
+    }
+
+    void token(const Token& token) {
+        using namespace boost::wave;
+        auto id = token_id(token);
+        switch (id) {
+            case T_NEWLINE:
+            case T_GENERATEDNEWLINE:
+                endLine();
+                return;
+            case T_SPACE:
+            case T_SPACE2:
+            case T_CONTLINE:
+                space = true;
+                return;
+            case T_EOF:
+            case T_EOI:
+                return;
+            default:
+                break;
+        }
+
+        auto& value = token.get_value();
+        // A C++ comment ends with the newline which ends the line.
+        bool newline = id == T_CPPCOMMENT && !value.empty() && value[value.size() - 1] == '\n';
+        if (lineStart) {
+            auto& position = token.get_position();
+            unsigned at = fromMacro ? macroLine : position.get_line();
+            unsigned column = fromMacro ? macroColumn : position.get_column();
+            moveTo(at);
+            out.append(column > 1 ? column - 1 : 0, ' ');
+            lineStart = false;
+        } else if (space || (hasPrevious && !adjacent(previous, token) &&
+                             mayPaste(previous, token))) {
+            // Tokens which come from different places, such as the end of a
+            // macro expansion and the text after it, must not paste.
+            out += ' ';
+        }
+        space = false;
+        printed = true;
+        previous = token;
+        hasPrevious = true;
+        if (id == T_STRINGLIT && files.size() == 1 && value == waveMainName.c_str())
+            out += mainName;
+        else
+            out.append(value.begin(), value.end() - (newline ? 1 : 0));
+        if (id == T_CCOMMENT)
+            line += std::count(value.begin(), value.end(), '\n');
+        if (newline)
+            endLine();
+    }
+
+    void expanding(const Token& call) {
+        if (lineStart && !fromMacro) {
+            fromMacro = true;
+            macroLine = call.get_position().get_line();
+            macroColumn = call.get_position().get_column();
+        }
+    }
+
+    void directive(const Token& directive) {
+        directiveLine = directive.get_position().get_line();
+        endLine();
+    }
+
+    /// @return the name of the file included as @name, or an empty string.
+    /// Like cpp, "file" is looked up in the folder of the current file first,
+    /// then in the include path.
+    std::string locate(const std::string& name, bool system) const {
+        if (!name.empty() && name[0] == '/')
+            return isFile(name) ? name : "";
+        if (!system) {
+            auto& current = files.back().name;
+            auto slash = current.rfind('/');
+            auto file = slash == std::string::npos ? name : current.substr(0, slash + 1) + name;
+            if (isFile(file))
+                return file;
+        }
+        for (auto& folder : includePath) {
+            auto file = folder + "/" + name;
+            if (isFile(file))
+                return file;
+        }
+        return "";
+    }
+
+    /// @return the include guard of @file if it was included before.
+    std::string includeGuard(const std::string& file) const {
+        if (!included.count(file))
+            return "";
+        auto mapped = mapFile(file);
+        return mapped ? mapped->includeGuard : "";
+    }
+
+    void enter(const std::string& file) {
+        included.insert(file);
+        files.back().includeLine = directiveLine;
+        moveTo(directiveLine);
+        files.push_back({ file, file, 0 });
+        marker(1, file, " 1");
+        endLine();
+    }
+
+    void leave() {
+        files.pop_back();
+        marker(files.back().includeLine + 1, files.back().presumed, " 2");
+        endLine();
+    }
+
+    void setLine(unsigned at, const std::string& file) {
+        if (!file.empty())
+            files.back().presumed = file;
+        marker(at, files.back().presumed, "");
+        endLine();
+    }
+
+    /// Ends the output.
+    void finish() {
+        if (printed)
+            out += '\n';
+    }
+
+    /// @return the name of @file in messages.
+    std::string presumedName(const std::string& file) const {
+        for (auto it = files.rbegin(); it != files.rend(); ++it)
+            if (it->name == file)
+                return it->presumed;
+        return file;
+    }
+};
+
+/// Connects the Wave context to the Writer.
+class Hooks : public boost::wave::context_policies::default_preprocessing_hooks {
+    Writer* writer = nullptr;
+
+ public:
+    Hooks() = default;
+    explicit Hooks(Writer* writer) : writer(writer) {}
+
+    template <typename Context, typename TokenT>
+    bool may_skip_whitespace(Context const&, TokenT&, bool&) { return false; }
+
+    template <typename Context, typename TokenT>
+    bool found_directive(Context const&, TokenT const& directive) {
+        writer->directive(directive);
+        return false;
+    }
+
+    template <typename Context, typename TokenT, typename Container>
+    bool expanding_object_like_macro(Context const&, TokenT const&, Container const&,
+                                     TokenT const& call) {
+        writer->expanding(call);
+        return false;
+    }
+
+    template <typename Context, typename TokenT, typename Container, typename Iterator>
+    bool expanding_function_like_macro(Context const&, TokenT const&,
+                                       std::vector<TokenT> const&, Container const&,
+                                       TokenT const& call, std::vector<Container> const&,
+                                       Iterator const&, Iterator const&) {
+        writer->expanding(call);
+        return false;
+    }
+
+    template <typename Context, typename TokenT, typename Container>
+    bool evaluated_conditional_expression(Context const&, TokenT const& directive,
+                                          Container const&, bool) {
+        writer->directive(directive);
+        return false;
+    }
+
+    template <typename Context>
+    bool found_include_directive(Context const& context, std::string const& include, bool) {
+        if (include.size() < 2)
+            return false;
+        auto file = writer->locate(include.substr(1, include.size() - 2), include[0] == '<');
+        auto guard = writer->includeGuard(file);
+        return !guard.empty() && context.is_defined_macro(guard);
+    }
+
+    template <typename Context>
+    bool locate_include_file(Context&, std::string& path, bool system, char const*,
+                             std::string& folder, std::string& name) {
+        name = writer->locate(path, system);
+        if (name.empty())
+            return false;
+        auto slash = name.rfind('/');
+        folder = slash == std::string::npos ? "." : name.substr(0, slash);
+        path = name;
+        return true;
+    }
+
+    template <typename Context>
+    void opened_include_file(Context const&, std::string const&, std::string const& file,
+                             bool) {
+        writer->enter(file);
+    }
+
+    template <typename Context>
+    void returning_from_include_file(Context const&) { writer->leave(); }
+
+    template <typename Context, typename Container>
+    void found_line_directive(Context const&, Container const&, unsigned int line,
+                              std::string const& file) {
+        writer->setLine(line, file);
+    }
+};
+
+typedef boost::wave::cpplexer::lex_iterator<Token> LexIterator;
+typedef boost::wave::context<const char*, LexIterator, MappedInput, Hooks> Context;
+
+/// Reads the folders of -I options and the macro definitions of -D and -U
+/// options from @arguments.
+bool parseArguments(cstring arguments, std::vector<std::string>& includePath,
+                    std::vector<std::pair<char, std::string>>& macros) {
+    std::istringstream stream(arguments.c_str());
+    std::set<std::pair<dev_t, ino_t>> folders;
+    std::string arg;
+    while (stream >> arg) {
+        if (arg.size() < 2 || arg[0] != '-' || (arg[1] != 'I' && arg[1] != 'D' && arg[1] != 'U')) {
+            ::error(ErrorType::ERR_UNSUPPORTED,
+                    "%1%: option not supported by the built-in preprocessor", arg);
+            return false;
+        }
+        char option = arg[1];
+        std::string value = arg.substr(2);
+        if (value.empty() && !(stream >> value)) {
+            ::error(ErrorType::ERR_EXPECTED, "Missing argument for -%1%", option);
+            return false;
+        }
+        if (option != 'I') {
+            macros.emplace_back(option, value);
+            continue;
+        }
+        // Like cpp, ignore folders which do not exist or appear twice.
+        while (value.size() > 1 && value.back() == '/')
+            value.pop_back();
+        struct stat st;
+        if (stat(value.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+            continue;
+        if (folders.emplace(st.st_dev, st.st_ino).second)
+            includePath.push_back(value);
+    }
+    return true;
+}
+
+/// Leaves the macros cpp defines with -undef.
+void predefineMacros(Context& context) {
+    static const std::set<std::string> standard = {
+        "__STDC__", "__FILE__", "__BASE_FILE__", "__LINE__", "__DATE__", "__TIME__",
+        "__INCLUDE_LEVEL__" };
+    std::vector<std::string> names;
+    for (auto it = context.macro_names_begin(); it != context.macro_names_end(); ++it)
+        names.emplace_back(it->c_str());
+    for (auto& name : names)
+        if (!standard.count(name))
+            context.remove_macro_definition(name, true);
+    context.add_macro_definition("__STDC_HOSTED__=1", true);
+    context.add_macro_definition("__ASSEMBLER__=1", true);
+}
+
+}  // namespace
+
+bool BuiltinPreprocessor::available() { return true; }
+
+bool BuiltinPreprocessor::run(cstring file, cstring arguments, std::string& output) {
+    ReleaseRunFiles release;
+    std::vector<std::string> includePath;
+    std::vector<std::pair<char, std::string>> macros;
+    if (!parseArguments(arguments, includePath, macros))
+        return false;
+    cachedFolders = includePath;
+    auto mapped = mapFile(file.c_str());
+    if (mapped == nullptr) {
+        ::error(ErrorType::ERR_IO, "input file %s does not exist", file);
+        return false;
+    }
+
+    // Wave completes relative file names with the folder the process started
+    // in, which a compile server leaves; give it an absolute name.
+    std::string absolute = file.c_str();
+    if (absolute[0] != '/') {
+        char folder[PATH_MAX];
+        if (getcwd(folder, sizeof(folder)) != nullptr)
+            absolute = std::string(folder) + "/" + absolute;
+    }
+
+    output.clear();
+    Writer writer(output, file.c_str(), absolute, includePath);
+    Context context(mapped->data, mapped->data + mapped->size, absolute.c_str(), Hooks(&writer));
+    context.set_language(boost::wave::language_support(
+        boost::wave::support_c99 |
+        boost::wave::support_option_preserve_comments |
+        boost::wave::support_option_prefer_pp_numbers));
+    auto report = [&](const boost::wave::cpp_exception& e) {
+        auto name = e.file_name() == absolute ? std::string(file.c_str())
+                                              : writer.presumedName(e.file_name());
+        if (e.get_severity() == boost::wave::util::severity_warning)
+            ::warning(ErrorType::WARN_FAILED, "%1%:%2%: %3%", name, e.line_no(), e.description());
+        else
+            ::error(ErrorType::ERR_INVALID, "%1%:%2%: %3%", name, e.line_no(), e.description());
+        return e.is_recoverable();
+    };
+
+    LOG1("Preprocessing " << file << " in-process");
+    Context::iterator_type it, end;
+    try {
+        predefineMacros(context);
+        for (auto& macro : macros) {
+            if (macro.first == 'U') {
+                context.remove_macro_definition(macro.second);
+            } else {
+                auto definition = macro.second;
+                if (definition.find('=') == std::string::npos)
+                    definition += "=1";
+                context.add_macro_definition(definition);
+            }
+        }
+        it = context.begin();
+        end = context.end();
+    } catch (const boost::wave::cpp_exception& e) {
+        report(e);
+        return false;
+    }
+    // After an error in ++it, the iterator still points to the last token.
+    bool written = false;
+    while (it != end) {
+        try {
+            if (!written)
+                writer.token(*it);
+            written = true;
+            ++it;
+            written = false;
+        } catch (const boost::wave::cpp_exception& e) {
+            if (!report(e))
+                return false;
+        } catch (const std::exception& e) {
+            ::error(ErrorType::ERR_IO, "%1%: %2%", file, e.what());
+            return false;
+        }
+    }
+    writer.finish();
+    return ::errorCount() == 0;
+}
+
+#else
+
+bool BuiltinPreprocessor::available() { return false; }
+
+bool BuiltinPreprocessor::run(cstring, cstring, std::string&) {
+    ::error(ErrorType::ERR_UNSUPPORTED,
+            "The compiler was built without the built-in preprocessor");
+    return false;
+}
+
+#endif  // HAVE_LIBBOOST_WAVE
+
+}  // namespace P4
@@ -0,0 +1,49 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef FRONTENDS_COMMON_BUILTINPREPROCESSOR_H_
+#define FRONTENDS_COMMON_BUILTINPREPROCESSOR_H_
+
+#include <string>
+
+#include "lib/cstring.h"
+
+namespace P4 {
+
+/**
+ * A C preprocessor running in the compiler process (--builtin-preprocessor),
+ * instead of "cpp -C -undef -nostdinc -x assembler-with-cpp" in a child
+ * process. It is built on Boost.Wave, when that library is available.
+ *
+ * The output is written the way cpp writes it: each line keeps the
+ * indentation of its first token, other whitespace is a single space,
+ * comments are kept, and "# <line> "<file>" <flags>" markers are written
+ * when entering and leaving included files and after gaps of 8 lines or
+ * more. Source files are memory-mapped. The files in the include path stay
+ * mapped until they change, so a compile server (--server) reads the
+ * architecture includes only once; the others are unmapped after each run.
+ */
+class BuiltinPreprocessor {
+ public:
+    /// @return false if the compiler was built without Boost.Wave.
+    static bool available();
+    /// Preprocesses @file into @output. @arguments holds the -I, -D and -U
+    /// options, as they would be passed to cpp. @return false after
+    /// reporting errors.
+    static bool run(cstring file, cstring arguments, std::string& output);
+};
+
+}  // namespace P4
+
+#endif  /* FRONTENDS_COMMON_BUILTINPREPROCESSOR_H_ */
@@ -0,0 +1,256 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "frontendCache.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "options.h"
+#include "frontends/parsers/parserDriver.h"
+#include "ir/ir.h"
+#include "ir/json_generator.h"
+#include "ir/json_loader.h"
+#include "lib/hash.h"
+#include "lib/log.h"
+#include "lib/stringify.h"
+
+namespace P4 {
+
+namespace {
+
+const char* entrySuffix = ".json";
+
+/// @return true for the options which do not change the result of the
+/// front end, and are therefore not part of the key.
+bool isCacheOption(cstring arg) {
+    return arg == "--cache-dir" || arg == "--cache-size" || arg == "--pass-stats" ||
+           arg.startsWith("--cache-dir=") || arg.startsWith("--cache-size=") ||
+           arg.startsWith("--pass-stats=");
+}
+
+/// Writes the source positions of the nodes of @program as a JSON array of
+/// [node id, start line, start column, end line, end column], in the lines
+/// and columns of the preprocessed source.
+void writePositions(std::ostream& out, const IR::P4Program* program) {
+    class Positions : public Inspector {
+        std::ostream& out;
+        const char* separator = "";
+
+     public:
+        explicit Positions(std::ostream& out) : out(out) {}
+        bool preorder(const IR::Node* node) override {
+            if (!node->srcInfo.isValid())
+                return true;
+            auto& start = node->srcInfo.getStart();
+            auto& end = node->srcInfo.getEnd();
+            out << separator << "[" << node->id << "," << start.getLineNumber() << ","
+                << start.getColumnNumber() << "," << end.getLineNumber() << ","
+                << end.getColumnNumber() << "]";
+            separator = ",\n";
+            return true;
+        }
+    };
+
+    out << "[";
+    program->apply(Positions(out));
+    out << "]" << std::endl;
+}
+
+/// Gives the nodes read by @loader the positions in @json, which refer to
+/// @sources. @return false if @json is not a valid array of positions.
+bool readPositions(const JsonData* json, const JSONLoader& loader,
+                   const Util::InputSources* sources) {
+    auto positions = json ? json->to<JsonVector>() : nullptr;
+    if (positions == nullptr)
+        return false;
+    for (auto position : *positions) {
+        auto values = position->to<JsonVector>();
+        if (values == nullptr || values->size() != 5)
+            return false;
+        unsigned v[5];
+        for (size_t i = 0; i < 5; i++) {
+            auto number = values->at(i)->to<JsonNumber>();
+            if (number == nullptr || number->val < 0)
+                return false;
+            v[i] = unsigned(int(*number));
+        }
+        auto node = loader.node_refs.find(v[0]);
+        if (node == loader.node_refs.end() || v[1] == 0 || v[3] == 0 ||
+            v[3] > sources->getCurrentLineNumber())
+            return false;
+        Util::SourcePosition start(v[1], v[2]), end(v[3], v[4]);
+        if (end < start)
+            return false;
+        node->second->srcInfo = Util::SourceInfo(sources, start, end);
+    }
+    return true;
+}
+
+}  // namespace
+
+bool FrontEndCache::usable(const ParserOptions& options) {
+    // The source positions of P4-14 programs also refer to the sources of
+    // the model, which the cache does not keep.
+    if (options.cacheDir.isNullOrEmpty() || !options.top4.empty() || options.isv1())
+        return false;
+    auto compilerOptions = dynamic_cast<const CompilerOptions*>(&options);
+    return compilerOptions == nullptr || compilerOptions->prettyPrintFile.isNullOrEmpty();
+}
+
+cstring FrontEndCache::path(cstring key) const {
+    return options.cacheDir + "/" + key + entrySuffix;
+}
+
+cstring FrontEndCache::key(const std::string& source) const {
+    // Every component is followed by a NUL, so that moving characters from
+    // one component to the next changes the key.
+    std::string text = source;
+    text.push_back('\0');
+    for (cstring item : { options.exe_name, options.compilerVersion })
+        text.append(item.isNullOrEmpty() ? "" : item.c_str(), item.size() + 1);
+    text.push_back(options.langVersion == ParserOptions::FrontendVersion::P4_14 ? '1' : '6');
+    text.push_back('\0');
+    bool skipNext = false;
+    for (auto arg : options.arguments) {
+        if (skipNext) {
+            skipNext = false;
+            continue;
+        }
+        if (isCacheOption(arg)) {
+            skipNext = arg.find('=') == nullptr;
+            continue;
+        }
+        if (arg == options.file)
+            continue;
+        text.append(arg.c_str(), arg.size() + 1);
+    }
+
+    std::stringstream result;
+    result << std::hex << std::setfill('0')
+           << std::setw(16) << uint64_t(Util::Hash::fnv1a(text))
+           << std::setw(16) << uint64_t(Util::Hash::murmur(text));
+    return result.str();
+}
+
+const IR::P4Program* FrontEndCache::load(cstring key, const std::string& source) const {
+    auto file = path(key);
+    std::ifstream json(file);
+    if (!json)
+        return nullptr;
+    JSONLoader loader(json);
+    if (loader.json == nullptr) {
+        LOG1("Ignoring invalid front end cache entry " << file);
+        return nullptr;
+    }
+    const IR::Node* node = nullptr;
+    loader >> node;
+    auto program = node ? node->to<IR::P4Program>() : nullptr;
+    if (program == nullptr) {
+        LOG1("Ignoring invalid front end cache entry " << file);
+        return nullptr;
+    }
+    // The positions which follow the program refer to the preprocessed
+    // source, so that the nodes get valid source information again.
+    JsonData* positions = nullptr;
+    json >> positions;
+    if (!readPositions(positions, loader, P4ParserDriver::readSources(source, options.file))) {
+        LOG1("Ignoring front end cache entry " << file << " without valid source positions");
+        return nullptr;
+    }
+    // The modification time of an entry is the time it was last used.
+    utime(file, nullptr);
+    LOG1("Loaded front end result from " << file);
+    return program;
+}
+
+void FrontEndCache::store(cstring key, const IR::P4Program* program) const {
+    mkdir(options.cacheDir, 0777);
+    auto file = path(key);
+    // Write to a file private to this process and rename it, so that
+    // concurrent compilations never read a partial entry.
+    auto tmp = file + ".tmp." + Util::toString(getpid());
+    {
+        std::ofstream out(tmp);
+        if (!out) {
+            ::warning(ErrorType::WARN_IGNORE, "Cannot write front end cache entry %1%", tmp);
+            return;
+        }
+        JSONGenerator(out, true) << program << std::endl;
+        writePositions(out, program);
+        if (!out) {
+            out.close();
+            unlink(tmp);
+            ::warning(ErrorType::WARN_IGNORE, "Cannot write front end cache entry %1%", tmp);
+            return;
+        }
+    }
+    if (rename(tmp, file) != 0) {
+        unlink(tmp);
+        ::warning(ErrorType::WARN_IGNORE, "Cannot write front end cache entry %1%", file);
+        return;
+    }
+    LOG1("Stored front end result in " << file);
+    evict();
+}
+
+void FrontEndCache::evict() const {
+    struct Entry {
+        cstring file;
+        time_t used;
+        uint64_t size;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    DIR* dir = opendir(options.cacheDir);
+    if (dir == nullptr)
+        return;
+    while (auto dirEntry = readdir(dir)) {
+        cstring name = dirEntry->d_name;
+        if (!name.endsWith(entrySuffix))
+            continue;
+        auto file = options.cacheDir + "/" + name;
+        struct stat st;
+        if (stat(file, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        entries.push_back({ file, st.st_mtime, uint64_t(st.st_size) });
+        total += st.st_size;
+    }
+    closedir(dir);
+    if (total <= options.cacheMaxSize)
+        return;
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (auto& e : entries) {
+        if (total <= options.cacheMaxSize)
+            break;
+        // Another compilation may have removed the entry already.
+        if (unlink(e.file) == 0)
+            LOG1("Evicted front end cache entry " << e.file);
+        total -= e.size;
+    }
+}
+
+}  // namespace P4
@@ -0,0 +1,65 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef FRONTENDS_COMMON_FRONTENDCACHE_H_
+#define FRONTENDS_COMMON_FRONTENDCACHE_H_
+
+#include <string>
+
+#include "parser_options.h"
+#include "lib/cstring.h"
+
+namespace IR {
+class P4Program;
+}  // namespace IR
+
+namespace P4 {
+
+/**
+ * A content-addressed cache of front end results, stored in the folder given
+ * with --cache-dir. The key of a program is a hash of its preprocessed source,
+ * of the compiler and its version and of the command-line arguments other
+ * than the input file name and the cache options. Entries are IR dumps
+ * written by JSONGenerator and read by JSONLoader, followed by the source
+ * positions of the nodes in the preprocessed source. A loaded program gets
+ * the same source information as a parsed one, so diagnostics reported by
+ * later passes do not depend on the cache. Only P4-16 programs are cached.
+ *
+ * Entries are written to a temporary file which is then renamed, so
+ * concurrent compilations never see partial entries. Loading an entry
+ * updates its modification time; when the folder grows beyond the size
+ * limit the entries used least recently are removed.
+ */
+class FrontEndCache {
+    const ParserOptions& options;
+
+    cstring path(cstring key) const;
+    void evict() const;
+
+ public:
+    explicit FrontEndCache(const ParserOptions& options) : options(options) {}
+
+    /// @return false if the options ask for output produced while the front
+    /// end runs (such as --pp or --top4), which a cached result would skip.
+    static bool usable(const ParserOptions& options);
+    cstring key(const std::string& source) const;
+    /// @return the program stored for @key, or nullptr. @source is the
+    /// preprocessed source @key was computed from.
+    const IR::P4Program* load(cstring key, const std::string& source) const;
+    void store(cstring key, const IR::P4Program* program) const;
+};
+
+}  // namespace P4
+
+#endif  /* FRONTENDS_COMMON_FRONTENDCACHE_H_ */
@@ -17,6 +17,10 @@ limitations under the License.
 #ifndef _FRONTENDS_COMMON_PARSEINPUT_H_
 #define _FRONTENDS_COMMON_PARSEINPUT_H_
 
+#include <sstream>
+#include <string>
+
+#include "frontends/common/frontendCache.h"
 #include "frontends/common/options.h"
 #include "frontends/parsers/parserDriver.h"
 #include "frontends/p4/fromv1.0/converters.h"
@@ -61,6 +65,10 @@ parseV1Program(Input& stream, const char* sourceFile, unsigned sourceLine,
  * by @options. If the language version is not P4-16, then the program is
  * converted to P4-16 before being returned.
  *
+ * If a front end cache is configured (--cache-dir) and holds a result for
+ * the preprocessed source, the cached program, which has already been
+ * through the front end, is returned instead; FrontEnd::run recognizes it.
+ *
  * @return a P4-16 IR tree representing the contents of the given file, or null
  * on failure. If failure occurs, an error will also be reported.
  */
@@ -83,10 +91,33 @@ const IR::P4Program* parseP4File(ParserOptions& options) {
             return nullptr;
     }
 
-    auto result = options.isv1()
+    const IR::P4Program* result = nullptr;
+    if (FrontEndCache::usable(options)) {
+        // The cache key covers the preprocessed source, so read it all first.
+        std::string source;
+        char buffer[1 << 16];
+        size_t size;
+        while ((size = fread(buffer, 1, sizeof(buffer), in)) > 0)
+            source.append(buffer, size);
+        options.closeInput(in);
+
+        FrontEndCache cache(options);
+        options.frontEndCacheKey = cache.key(source);
+        if (auto cached = cache.load(options.frontEndCacheKey, source)) {
+            options.frontEndCacheHit = cached;
+            return cached;
+        }
+        std::istringstream stream(source);
+        result = options.isv1()
+                ? parseV1Program<std::istringstream, C>(stream, options.file, 1,
+                                                        options.getDebugHook())
+                : P4ParserDriver::parse(stream, options.file);
+    } else {
+        result = options.isv1()
                 ? parseV1Program<FILE*, C>(in, options.file, 1, options.getDebugHook())
                 : P4ParserDriver::parse(in, options.file);
-    options.closeInput(in);
+        options.closeInput(in);
+    }
 
     if (::errorCount() > 0) {
         ::error(ErrorType::ERR_OVERLIMIT,
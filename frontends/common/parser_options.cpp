@@ -22,8 +22,10 @@ limitations under the License.
 #include <regex>
 #include <unordered_set>
 
+#include "builtinPreprocessor.h"
 #include "frontends/p4/toP4/toP4.h"
 #include "ir/json_generator.h"
+#include "lib/compile_stats.h"
 #include "lib/exceptions.h"
 #include "lib/exename.h"
 #include "lib/log.h"
@@ -125,6 +127,20 @@ ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
             return true;
         },
         "Skip preprocess, assume input file is already preprocessed.");
+    registerOption(
+        "--builtin-preprocessor", nullptr,
+        [this](const char* ) {
+            if (!P4::BuiltinPreprocessor::available()) {
+                ::error(ErrorType::ERR_UNSUPPORTED,
+                        "--builtin-preprocessor: the compiler was built without Boost.Wave");
+                return false;
+            }
+            builtinPreprocessor = true;
+            return true;
+        },
+        "Preprocess the input in the compiler process instead of running cpp.\n"
+        "Included files stay in memory across the requests of a compile\n"
+        "server (--server).");
     registerOption(
         "--disable-annotations", "annotations",
         [this](const char* arg) {
@@ -238,6 +254,40 @@ ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
         "When the optimization is enabled, compiler tries to identify the cases,\n"
         "when it can inline the subparser's states only once for multiple\n"
         "invocations of the same subparser instance.");
+    registerOption(
+        "--cache-dir", "dir",
+        [this](const char* arg) {
+            cacheDir = arg;
+            return true;
+        },
+        "Cache the result of the front end in this folder; programs compiled\n"
+        "again from the same preprocessed source with the same options are\n"
+        "loaded from the cache instead of running the front end.");
+    registerOption(
+        "--cache-size", "MB",
+        [this](const char* arg) {
+            char* end;
+            auto size = strtoull(arg, &end, 10);
+            if (*end != 0 || size == 0) {
+                ::error(ErrorType::ERR_INVALID, "Illegal cache size %1%", arg);
+                return false;
+            }
+            cacheMaxSize = size << 20;
+            return true;
+        },
+        "Maximum size of the front end cache; the least recently used\n"
+        "entries are removed when it is exceeded (default 1024 MB).");
+    registerOption(
+        "--pass-stats", "file",
+        [](const char* arg) {
+            if (!Util::CompileStats::open(arg)) {
+                ::error(ErrorType::ERR_IO, "%1%: cannot open for writing", arg);
+                return false;
+            }
+            return true;
+        },
+        "Append the time and the allocations of each compiler pass to this\n"
+        "file, one JSON object per line (see tools/p4c-bench.py).");
     registerUsage(
         "loglevel format is: \"sourceFile:level,...,sourceFile:level\"\n"
         "where 'sourceFile' is a compiler source file and "
@@ -309,6 +359,8 @@ std::vector<const char*>* ParserOptions::process(int argc,
     searchForIncludePath(p4_14includePath,
         {"p4_14include", "../p4_14include", "../../p4_14include"}, exename(argv[0]));
 
+    for (int i = 1; i < argc; i++)
+        arguments.push_back(argv[i]);
     auto remainingOptions = Util::Options::process(argc, argv);
     validateOptions();
     return remainingOptions;
@@ -337,6 +389,16 @@ FILE* ParserOptions::preprocess() {
     if (file == "-") {
         file = "<stdin>";
         in = stdin;
+    } else if (builtinPreprocessor) {
+        cstring arguments = preprocessor_options + getIncludePath();
+        if (!P4::BuiltinPreprocessor::run(file, arguments, preprocessed))
+            return nullptr;
+        in = fmemopen(&preprocessed[0], preprocessed.size(), "r");
+        if (in == nullptr) {
+            ::error(ErrorType::ERR_IO, "Error reading the preprocessor output");
+            return nullptr;
+        }
+        close_input = true;
     } else {
 #ifdef __clang__
         std::string cmd("cc -E -x c -Wno-comment");
@@ -376,7 +438,9 @@ FILE* ParserOptions::preprocess() {
 }
 
 void ParserOptions::closeInput(FILE* inputStream) const {
-    if (close_input) {
+    if (close_input && builtinPreprocessor) {
+        fclose(inputStream);
+    } else if (close_input) {
         int exitCode = pclose(inputStream);
         if (WIFEXITED(exitCode) && WEXITSTATUS(exitCode) == 4)
             ::error(ErrorType::ERR_IO, "input file %s does not exist", file);
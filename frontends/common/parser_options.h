@@ -20,6 +20,7 @@ limitations under the License.
 #define FRONTENDS_COMMON_PARSER_OPTIONS_H_
 
 #include <set>
+#include <string>
 #include <unordered_map>
 
 #include "ir/configuration.h"
@@ -38,6 +39,8 @@ extern const char* p4_14includePath;
 // Each back-end should subclass this file.
 class ParserOptions : public Util::Options {
     bool close_input = false;
+    // output of the built-in preprocessor, read through a memory stream
+    std::string preprocessed;
     static const char* defaultMessage;
 
     // annotation names that are to be ignored by the compiler
@@ -68,12 +71,24 @@ class ParserOptions : public Util::Options {
     cstring compilerVersion;
     // if true skip preprocess
     bool doNotPreprocess = false;
+    // if true preprocess in this process instead of running cpp
+    bool builtinPreprocessor = false;
     // substrings matched against pass names
     std::vector<cstring> top4;
     // debugging dumps of programs written in this folder
     cstring dumpFolder = ".";
     // If false, optimization of callee parsers (subparsers) inlining is disabled.
     bool optimizeParserInlining = false;
+    // Command-line arguments, in order.
+    std::vector<cstring> arguments;
+    // Folder of the front end cache; no caching if null.
+    cstring cacheDir = nullptr;
+    // Maximum size of the front end cache in bytes.
+    uint64_t cacheMaxSize = uint64_t(1) << 30;
+    // Key of the input program in the front end cache, set by parseP4File.
+    cstring frontEndCacheKey = nullptr;
+    // The program loaded from the front end cache, if any.
+    const IR::P4Program* frontEndCacheHit = nullptr;
     // Expect that the only remaining argument is the input file.
     void setInputFile();
     // Return target specific include path.
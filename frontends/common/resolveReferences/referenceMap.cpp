@@ -93,7 +93,7 @@ void ReferenceMap::dbprint(std::ostream &out) const {
         out << dbp(e.first) << "->" << dbp(e.second) << std::endl;
 }
 
-cstring ReferenceMap::newName(cstring base) {
+cstring UsedNames::newName(cstring base) {
     // Maybe in the future we'll maintain information with per-scope identifiers,
     // but today we are content to generate globally-unique identifiers.
 
@@ -107,28 +107,30 @@ cstring ReferenceMap::newName(cstring base) {
     if (len > 0 && base[len - 1] == '_')
         base = base.substr(0, len - 1);
 
-    cstring name = cstring::make_unique(usedNames, base, '_');
-    usedNames.insert(name);
+    // Same result as cstring::make_unique(names, base, '_'), but the
+    // suffixes which were found used before are not tried again.
+    auto &suffix = nextSuffix.emplace(base, -1).first->second;
+    cstring name = base;
+    char buffer[12];
+    while (true) {
+        if (suffix >= 0) {
+            snprintf(buffer, sizeof(buffer), "_%d", suffix);
+            name = base + buffer;
+        }
+        suffix++;
+        if (names.count(name) == 0)
+            break;
+    }
+    names.insert(name);
     return name;
 }
 
-cstring MinimalNameGenerator::newName(cstring base) {
-    // Maybe in the future we'll maintain information with per-scope identifiers,
-    // but today we are content to generate globally-unique identifiers.
-
-    // If base has a suffix of the form _(\d+), then we discard the suffix.
-    // under the assumption that it is probably a generated suffix.
-    // This will not impact correctness.
-    unsigned len = base.size();
-    const char digits[] = "0123456789";
-    const char* s = base.c_str();
-    while (len > 0 && strchr(digits, s[len-1])) len--;
-    if (len > 0 && base[len - 1] == '_')
-        base = base.substr(0, len - 1);
+cstring ReferenceMap::newName(cstring base) {
+    return usedNames.newName(base);
+}
 
-    cstring name = cstring::make_unique(usedNames, base, '_');
-    usedNames.insert(name);
-    return name;
+cstring MinimalNameGenerator::newName(cstring base) {
+    return usedNames.newName(base);
 }
 
 }  // namespace P4
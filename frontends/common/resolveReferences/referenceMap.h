@@ -17,6 +17,9 @@ limitations under the License.
 #ifndef _COMMON_RESOLVEREFERENCES_REFERENCEMAP_H_
 #define _COMMON_RESOLVEREFERENCES_REFERENCEMAP_H_
 
+#include <unordered_map>
+#include <unordered_set>
+
 #include "ir/ir.h"
 #include "lib/cstring.h"
 #include "lib/map.h"
@@ -29,9 +32,28 @@ class NameGenerator {
     virtual cstring newName(cstring base) = 0;
 };
 
+/// A set of names which generates fresh names.  Names are only removed by
+/// clear(), so for each base the first suffix that may still be free is
+/// remembered, and a new name costs amortized constant time.
+class UsedNames {
+    std::unordered_set<cstring> names;
+    /// Next suffix to try for each base; -1 stands for the base itself.
+    std::unordered_map<cstring, int> nextSuffix;
+
+ public:
+    void insert(cstring name) { names.insert(name); }
+    template <class Iterator>
+    void insert(Iterator begin, Iterator end) { names.insert(begin, end); }
+    size_t count(cstring name) const { return names.count(name); }
+    void clear() { names.clear(); nextSuffix.clear(); }
+    /// Adds and returns the first of base, base_0, base_1, ... which is not
+    /// in the set, after removing a _(\d+) suffix from @p base.
+    cstring newName(cstring base);
+};
+
 // replacement for ReferenceMap NameGenerator to make it easier to remove uses of refMap
 class MinimalNameGenerator : public NameGenerator, public Inspector {
-    std::set<cstring> usedNames;
+    UsedNames usedNames;
     void postorder(const IR::Path *p) override { usedName(p->name.name); }
     void postorder(const IR::Type_Declaration *t) override { usedName(t->name.name); }
     void postorder(const IR::Declaration *d) override { usedName(d->name.name); }
@@ -73,7 +95,7 @@ class ReferenceMap final : public ProgramMap, public NameGenerator, public Decla
     std::map<const IR::This*, const IR::IDeclaration*> thisToDeclaration;
 
     /// Set containing all names used in the program.
-    std::set<cstring> usedNames;
+    UsedNames usedNames;
 
  public:
     ReferenceMap();
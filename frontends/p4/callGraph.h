@@ -18,6 +18,7 @@ limitations under the License.
 #define _FRONTENDS_P4_CALLGRAPH_H_
 
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
 #include "lib/log.h"
@@ -47,6 +48,7 @@ class CallGraph {
  public:
     ordered_set<T> nodes;    // all nodes; do not modify this directly
     typedef typename ordered_map<T, std::vector<T>*>::const_iterator const_iterator;
+    typedef std::unordered_set<T> Set;
 
     explicit CallGraph(cstring name) : name(name) {}
 
@@ -74,25 +76,31 @@ class CallGraph {
         auto n = nodes.find(node);
         BUG_CHECK(n != nodes.end(), "%1%: Node not in graph", node);
         nodes.erase(n);
+        // A neighbor may appear several times in a list; each neighbor's list
+        // is scanned only once, dropping all the edges to 'node' at once.
+        Set done;
         auto in = in_edges.find(node);
         if (in != in_edges.end()) {
             // remove all edges pointing to this node
             for (auto n : *in->second) {
+                if (!done.emplace(n).second)
+                    continue;
                 auto out = out_edges[n];
                 CHECK_NULL(out);
-                auto oe = std::find(out->begin(), out->end(), node);
-                out->erase(oe);
+                out->erase(std::remove(out->begin(), out->end(), node), out->end());
             }
             in_edges.erase(in);
         }
+        done.clear();
         auto it = out_edges.find(node);
         if (it != out_edges.end()) {
             // Remove all edges that point from this node
             for (auto n : *it->second) {
+                if (!done.emplace(n).second)
+                    continue;
                 auto in = in_edges[n];
                 CHECK_NULL(in);
-                auto ie = std::find(in->begin(), in->end(), node);
-                in->erase(ie);
+                in->erase(std::remove(in->begin(), in->end(), node), in->end());
             }
             out_edges.erase(it);
         }
@@ -149,8 +157,6 @@ class CallGraph {
             remove(n);
     }
 
-    typedef std::unordered_set<T> Set;
-
     // Compute for each node the set of dominators with the indicated start node.
     // Node d dominates node n if all paths from the start to n go through d
     // Result is deposited in 'dominators'.
@@ -265,78 +271,99 @@ class CallGraph {
     }
 
     // Helper for computing strongly-connected components
-    // using Tarjan's algorithm.
+    // using Tarjan's algorithm.  Each visited node gets a dense
+    // index, in visiting order; the rest of the state is kept in
+    // vectors indexed by it.
     struct sccInfo {
-        unsigned       crtIndex;
-        std::vector<T> stack;
-        std::set<T>    onStack;
-        std::map<T, unsigned> index;
-        std::map<T, unsigned> lowlink;
-
-        sccInfo() : crtIndex(0) {}
-        void push(T node) {
+        std::unordered_map<T, unsigned> index;
+        std::vector<unsigned> lowlink;
+        std::vector<bool>     onStack;
+        std::vector<T>        stack;
+
+        unsigned visit(T node) {
+            unsigned result = lowlink.size();
+            index.emplace(node, result);
+            lowlink.push_back(result);
+            onStack.push_back(true);
             stack.push_back(node);
-            onStack.emplace(node);
+            return result;
         }
-        bool isOnStack(T node)
-        { return onStack.count(node) != 0; }
-        bool unknown(T node)
+        bool unknown(T node) const
         { return index.count(node) == 0; }
-        void setLowLink(T node, unsigned value) {
-            lowlink[node] = value;
-            LOG1(node << ".lowlink = " << value << " = " << get(lowlink, node));
-        }
-        void setLowLink(T node, T successor) {
-            unsigned nlink = get(lowlink, node);
-            unsigned slink = get(lowlink, successor);
-            if (slink < nlink)
-                setLowLink(node, slink);
+        bool isOnStack(T node) const {
+            auto it = index.find(node);
+            return it != index.end() && onStack[it->second]; }
+        void setLowLink(unsigned node, unsigned successor) {
+            if (lowlink[successor] < lowlink[node])
+                lowlink[node] = lowlink[successor];
         }
         T pop() {
             T result = stack.back();
             stack.pop_back();
-            onStack.erase(result);
+            onStack[index.at(result)] = false;
             return result;
         }
     };
 
-    // helper for scSort
-    bool strongConnect(T node, sccInfo& helper, std::vector<T>& out) {
+    // helper for scSort; runs the depth-first search from 'root' with
+    // an explicit stack, so that long call chains cannot overflow the
+    // native stack.  Returns true if a cycle was found.
+    bool strongConnect(T root, sccInfo& helper, std::vector<T>& out) {
+        // A frame of the depth-first search: the node and its next out-edge.
+        struct Frame {
+            T node;
+            unsigned index;
+            const std::vector<T>* edges;
+            size_t next;
+        };
+        std::vector<Frame> frames;
         bool loop = false;
 
-        LOG1("scc " << cgMakeString(node));
-        helper.index.emplace(node, helper.crtIndex);
-        helper.setLowLink(node, helper.crtIndex);
-        helper.crtIndex++;
-        helper.push(node);
-        auto oe = out_edges[node];
-        if (oe != nullptr) {
-            for (auto next : *oe) {
+        auto enter = [&](T node) {
+            LOG1("scc " << cgMakeString(node));
+            unsigned index = helper.visit(node);
+            frames.push_back({ node, index, out_edges[node], 0 });
+        };
+
+        enter(root);
+        while (!frames.empty()) {
+            Frame& frame = frames.back();
+            if (frame.edges != nullptr && frame.next < frame.edges->size()) {
+                T node = frame.node;
+                unsigned index = frame.index;
+                T next = frame.edges->at(frame.next++);
                 LOG1(cgMakeString(node) << " => " << cgMakeString(next));
                 if (helper.unknown(next)) {
-                    bool l = strongConnect(next, helper, out);
-                    loop = loop | l;
-                    helper.setLowLink(node, next);
+                    // 'frame' is invalidated here; the successor's lowlink
+                    // is propagated when its frame is popped.
+                    enter(next);
                 } else if (helper.isOnStack(next)) {
-                    helper.setLowLink(node, next);
+                    helper.setLowLink(index, helper.index.at(next));
                     if (next == node)
                         // the check below does not find self-loops
                         loop = true;
                 }
+                continue;
             }
-        }
 
-        if (get(helper.lowlink, node) == get(helper.index, node)) {
-            LOG1(cgMakeString(node) << " index=" << get(helper.index, node)
-                      << " lowlink=" << get(helper.lowlink, node));
-            while (true) {
-                T sccMember = helper.pop();
-                LOG1("Scc order " << cgMakeString(sccMember) << "[" << cgMakeString(node) << "]");
-                out.push_back(sccMember);
-                if (sccMember == node)
-                    break;
-                loop = true;
+            T node = frame.node;
+            unsigned index = frame.index;
+            frames.pop_back();
+            if (helper.lowlink[index] == index) {
+                LOG1(cgMakeString(node) << " index=" << index
+                          << " lowlink=" << helper.lowlink[index]);
+                while (true) {
+                    T sccMember = helper.pop();
+                    LOG1("Scc order " << cgMakeString(sccMember) << "[" <<
+                         cgMakeString(node) << "]");
+                    out.push_back(sccMember);
+                    if (sccMember == node)
+                        break;
+                    loop = true;
+                }
             }
+            if (!frames.empty())
+                helper.setLowLink(frames.back().index, index);
         }
 
         return loop;
@@ -354,8 +381,11 @@ class CallGraph {
     bool sort(std::vector<T> &start, std::vector<T> &out) {
         sccInfo helper;
         bool cycles = false;
+        // Nodes already in 'out' are skipped; all the nodes
+        // added to it by strongConnect are known to 'helper'.
+        Set initial(out.begin(), out.end());
         for (auto n : start) {
-            if (std::find(out.begin(), out.end(), n) == out.end()) {
+            if (helper.unknown(n) && initial.count(n) == 0) {
                 bool c = strongConnect(n, helper, out);
                 cycles = cycles || c;
             }
@@ -365,8 +395,9 @@ class CallGraph {
     bool sort(std::vector<T> &out) {
         sccInfo helper;
         bool cycles = false;
+        Set initial(out.begin(), out.end());
         for (auto n : nodes) {
-            if (std::find(out.begin(), out.end(), n) == out.end()) {
+            if (helper.unknown(n) && initial.count(n) == 0) {
                 bool c = strongConnect(n, helper, out);
                 cycles = cycles || c;
             }
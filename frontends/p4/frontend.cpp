@@ -18,6 +18,7 @@ limitations under the License.
 #include <fstream>
 
 #include "ir/ir.h"
+#include "../common/frontendCache.h"
 #include "../common/options.h"
 #include "lib/nullstream.h"
 #include "lib/path.h"
@@ -146,6 +147,9 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
                                    bool skipSideEffectOrdering, std::ostream* outStream) {
     if (program == nullptr && options.listFrontendPasses == 0)
         return nullptr;
+    // Loaded from the front end cache by parseP4File: already done.
+    if (program != nullptr && program == options.frontEndCacheHit)
+        return program;
 
     bool isv1 = options.isv1();
     ReferenceMap  refMap;
@@ -255,6 +259,11 @@ const IR::P4Program *FrontEnd::run(const CompilerOptions &options, const IR::P4P
     passes.setStopOnError(true);
     passes.addDebugHooks(hooks, true);
     const IR::P4Program* result = program->apply(passes);
+    // Only cache results without diagnostics, so that compiling from the
+    // cache reports the same messages.
+    if (result != nullptr && options.frontEndCacheKey && !skipSideEffectOrdering &&
+        ::diagnosticCount() == 0)
+        FrontEndCache(options).store(options.frontEndCacheKey, result);
     return result;
 }
 
@@ -110,6 +110,7 @@ namespace P4 {
 
 class ParseAnnotations : public Modifier {
  public:
+    using Modifier::preorder;
     using Modifier::postorder;
 
     /// A handler returns true when the body of the given annotation is parsed
@@ -142,6 +143,8 @@ class ParseAnnotations : public Modifier {
         }
     }
 
+    /// Expressions carry no annotations: skipping them saves most of the walk.
+    bool preorder(IR::Expression*) final { return false; }
     void postorder(IR::Annotation* annotation) final;
 
     static HandlerMap standardHandlers();
@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include <sstream>
+#include <unordered_map>
 
 #include "symbol_table.h"
 #include "lib/exceptions.h"
@@ -23,6 +24,8 @@ limitations under the License.
 
 namespace Util {
 
+typedef std::unordered_map<const NamedSymbol*, NamedSymbol*> SymbolCopies;
+
 class NamedSymbol {
  protected:
     Util::SourceInfo sourceInfo;
@@ -54,6 +57,19 @@ class NamedSymbol {
     }
     virtual const Namespace *symNamespace() const;
 
+    virtual NamedSymbol* clone() const { return new NamedSymbol(*this); }
+    /// Deep copy with parent @parent; @copies maps each symbol copied so
+    /// far to its copy.
+    virtual NamedSymbol* copy(Namespace* parent, SymbolCopies& copies) const {
+        auto result = clone();
+        if (result->parent != nullptr)
+            result->parent = parent;
+        copies.emplace(this, result);
+        return result;
+    }
+    /// Replaces references to symbols that were copied by their copies.
+    virtual void relink(const SymbolCopies&) {}
+
     bool template_args = false;  // does the symbol expect template args
 };
 
@@ -108,6 +124,13 @@ class Namespace : public NamedSymbol {
     void clear() {
         contents.clear();
     }
+    NamedSymbol* clone() const override { return new Namespace(*this); }
+    NamedSymbol* copy(Namespace* parent, SymbolCopies& copies) const override {
+        auto result = static_cast<Namespace*>(NamedSymbol::copy(parent, copies));
+        for (auto& it : result->contents)
+            it.second = it.second->copy(result, copies);
+        return result;
+    }
     static const Namespace empty;
 };
 
@@ -121,12 +144,19 @@ class Object : public NamedSymbol {
     cstring toString() const override { return cstring("Object ") + getName(); }
     const Namespace *symNamespace() const override { return typeNamespace; }
     void setNamespace(const Namespace *ns) { typeNamespace = ns; }
+    NamedSymbol* clone() const override { return new Object(*this); }
+    void relink(const SymbolCopies& copies) override {
+        auto it = copies.find(typeNamespace);
+        if (it != copies.end())
+            typeNamespace = static_cast<const Namespace*>(it->second);
+    }
 };
 
 class SimpleType : public NamedSymbol {
  public:
     SimpleType(cstring name, Util::SourceInfo si) : NamedSymbol(name, si) {}
     cstring toString() const { return cstring("SimpleType ") + getName(); }
+    NamedSymbol* clone() const override { return new SimpleType(*this); }
 };
 
 // A Type that is also a namespace (e.g., a parser)
@@ -135,6 +165,7 @@ class ContainerType : public Namespace {
     ContainerType(cstring name, Util::SourceInfo si, bool allowDuplicates) :
             Namespace(name, si, allowDuplicates) {}
     cstring toString() const { return cstring("ContainerType ") + getName(); }
+    NamedSymbol* clone() const override { return new ContainerType(*this); }
 };
 
 /////////////////////////////////////////////////
@@ -151,6 +182,18 @@ ProgramStructure::ProgramStructure()
     debugStream = stderr;
 }
 
+ProgramStructure* ProgramStructure::copy() const {
+    BUG_CHECK(currentNamespace == rootNamespace, "Copying a structure while parsing");
+    SymbolCopies copies;
+    auto result = new ProgramStructure(*this);
+    result->rootNamespace = static_cast<Namespace*>(rootNamespace->copy(nullptr, copies));
+    result->currentNamespace = result->rootNamespace;
+    result->identifierContext = PathContext();
+    for (auto& it : copies)
+        it.second->relink(copies);
+    return result;
+}
+
 void ProgramStructure::push(Namespace* ns) {
     CHECK_NULL(ns);
     if (debug)
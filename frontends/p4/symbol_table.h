@@ -62,6 +62,9 @@ class ProgramStructure final {
     };
 
     ProgramStructure();
+    /// A deep copy of this structure, which must not be in the middle of
+    /// parsing a declaration; the copy shares no symbols with the original.
+    ProgramStructure* copy() const;
 
     void setDebug(bool debug) { this->debug = debug; }
     void pushNamespace(SourceInfo info, bool allowDuplicates);
@@ -37,6 +37,7 @@ TypeVariableSubstitution* TypeConstraints::solve() {
         if (!success)
             return nullptr;
     }
+    currentSubstitution->resolveAll();
     LOG3("Constraint solution:\n" << currentSubstitution);
     return currentSubstitution;
 }
@@ -60,7 +61,7 @@ bool TypeConstraints::solve(const EqualityConstraint *constraint) {
             return true;
 
         // check to see whether we already have a substitution for leftTv
-        const IR::Type* leftSubst = currentSubstitution->lookup(leftTv);
+        const IR::Type* leftSubst = currentSubstitution->resolve(leftTv);
         if (leftSubst == nullptr) {
             auto right = constraint->right->apply(replaceVariables)->to<IR::Type>();
             if (leftTv == right->to<IR::ITypeVar>())
@@ -78,7 +79,7 @@ bool TypeConstraints::solve(const EqualityConstraint *constraint) {
 
     if (isUnifiableTypeVariable(constraint->right)) {
         auto rightTv = constraint->right->to<IR::ITypeVar>();
-        const IR::Type* rightSubst = currentSubstitution->lookup(rightTv);
+        const IR::Type* rightSubst = currentSubstitution->resolve(rightTv);
         if (rightSubst == nullptr) {
             auto left = constraint->left->apply(replaceVariables)->to<IR::Type>();
             if (left->to<IR::ITypeVar>() == rightTv)
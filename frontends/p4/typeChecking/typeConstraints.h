@@ -254,7 +254,10 @@ class TypeConstraints final {
     bool solve(const EqualityConstraint *constraint);
     TypeVariableSubstitution* solve();
     void dbprint(std::ostream& out) const;
-    const TypeVariableSubstitution* getCurrentSubstitution() const { return currentSubstitution; }
+    const TypeVariableSubstitution* getCurrentSubstitution() const {
+        currentSubstitution->resolveAll();
+        return currentSubstitution;
+    }
 };
 }  // namespace P4
 
@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <functional>
+
 #include "typeSubstitution.h"
 #include "typeSubstitutionVisitor.h"
 #include "frontends/p4/typeMap.h"
@@ -54,31 +56,84 @@ cstring TypeVariableSubstitution::compose(const IR::ITypeVar* var, const IR::Typ
             var->toString(), substitution->toString(), bound->toString());
     }
 
-    // Replace var with substitution everywhere
-    TypeVariableSubstitution *tvs = new TypeVariableSubstitution();
-    bool success = tvs->setBinding(var, substitution);
-    if (!success)
-        BUG("Cannot set binding");
-
-    TypeVariableSubstitutionVisitor visitor(tvs);
-    for (auto &bound : binding) {
-        const IR::Type* type = bound.second;
-        const IR::Node* newType = type->apply(visitor);
-        if (newType == nullptr)
-            return "Could not replace '%1%' with '%2%'";
-        if (newType == type)
-            continue;
-
-        LOG3("Refining subsitution for " << bound.first->getNode() << " to " << newType);
-        bound.second = newType->to<IR::Type>();
-    }
-
-    success = setBinding(var, substitution);
+    // Replacing var with substitution in the existing bindings is left to
+    // resolve, which only does it for the bindings that are looked up.
+    bool success = setBinding(var, substitution);
     if (!success)
         BUG("Failed to insert binding");
+    position.emplace(var, composed.size());
+    composed.push_back(var);
+    upToDate.push_back(composed.size());
     return "";
 }
 
+namespace {
+/// Replaces the variables for which 'replacement' returns a type; the
+/// replacements are not visited.
+class ReplaceComposedVariables : public Transform {
+    std::function<const IR::Type*(const IR::ITypeVar*)> replacement;
+
+    const IR::Node* replace(const IR::ITypeVar* original, const IR::Node* node) {
+        auto type = replacement(original);
+        if (type == nullptr)
+            return node;
+        prune();
+        return type;
+    }
+
+ public:
+    explicit ReplaceComposedVariables(
+        std::function<const IR::Type*(const IR::ITypeVar*)> replacement)
+            : replacement(replacement) { setName("ReplaceComposedVariables"); }
+    const IR::Node* preorder(IR::TypeParameters* tps) override {
+        // remove variables that are substituted
+        for (auto it = tps->parameters.begin(); it != tps->parameters.end();) {
+            if (replacement(*it) != nullptr)
+                it = tps->parameters.erase(it);
+            else
+                ++it;
+        }
+        return tps;
+    }
+    const IR::Node* preorder(IR::Type_Var* tv) override
+    { return replace(getOriginal<IR::Type_Var>(), tv); }
+    const IR::Node* preorder(IR::Type_InfInt* ti) override
+    { return replace(getOriginal<IR::Type_InfInt>(), ti); }
+};
+}  // namespace
+
+const IR::Type* TypeVariableSubstitution::resolve(const IR::ITypeVar* var) {
+    auto pos = position.find(var);
+    if (pos == position.end())
+        return lookup(var);
+    size_t index = pos->second;
+    size_t from = upToDate.at(index);
+    if (from == composed.size())
+        return lookup(var);
+    upToDate[index] = composed.size();
+
+    // Only variables composed after var are replaced; the others were
+    // already bound when var was, and compose would not have replaced them.
+    ReplaceComposedVariables replace([this, from](const IR::ITypeVar* v) -> const IR::Type* {
+        auto p = position.find(v);
+        if (p == position.end() || p->second < from)
+            return nullptr;
+        return resolve(v);
+    });
+    auto it = binding.find(var);
+    auto result = it->second->apply(replace);
+    BUG_CHECK(result != nullptr, "Could not replace variables in %1%", it->second);
+    if (result != it->second)
+        LOG3("Refining subsitution for " << var->getNode() << " to " << result);
+    it->second = result->to<IR::Type>();
+    return it->second;
+}
+
+void TypeVariableSubstitution::resolveAll() {
+    for (auto var : composed)
+        resolve(var);
+}
+
 void TypeVariableSubstitution::simpleCompose(const TypeVariableSubstitution* other) {
     CHECK_NULL(other);
     for (auto v : other->binding) {
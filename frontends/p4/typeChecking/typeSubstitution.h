@@ -19,6 +19,8 @@ limitations under the License.
 
 #include <map>
 #include <sstream>
+#include <unordered_map>
+#include <vector>
 
 #include "ir/ir.h"
 #include "lib/exceptions.h"
@@ -74,6 +76,15 @@ class TypeSubstitution : public IHasDbPrint {
 };
 
 class TypeVariableSubstitution final : public TypeSubstitution<const IR::ITypeVar*> {
+    /// Variables bound by compose, in order.  A binding made by compose is
+    /// not rewritten when later variables are composed; instead, the value
+    /// of composed[i] is brought up to date by resolve, which replaces the
+    /// variables composed[upToDate[i]], composed[upToDate[i] + 1], ...
+    /// in it with their own up-to-date values.
+    std::vector<const IR::ITypeVar*> composed;
+    std::unordered_map<const IR::ITypeVar*, size_t> position;
+    std::vector<size_t> upToDate;
+
  public:
     TypeVariableSubstitution() = default;
     TypeVariableSubstitution(const TypeVariableSubstitution& other) = default;
@@ -83,7 +94,15 @@ class TypeVariableSubstitution final : public TypeSubstitution<const IR::ITypeVa
     /// Returns an empyty string on error, or an error message format otherwise.
     /// The error message should be used with 'var' and 'substitution' as arguments when
     /// reporting an error (i.e., it may contain %1% and %2% inside).
+    /// The result is the same as if 'var' was replaced with 'substitution' in
+    /// all the existing bindings, but that is done lazily, by resolve.
     cstring compose(const IR::ITypeVar* var, const IR::Type* substitution);
+    /// Brings the binding of 'var' up to date with the variables composed
+    /// since it was bound; @return the binding, or nullptr.
+    const IR::Type* resolve(const IR::ITypeVar* var);
+    /// Brings all bindings up to date; lookup then returns the same
+    /// types as if every compose had rewritten the existing bindings.
+    void resolveAll();
     // In this variant of compose all variables in 'other' that are
     // assigned to are disjoint from all variables already in 'this'.
     void simpleCompose(const TypeVariableSubstitution* other);
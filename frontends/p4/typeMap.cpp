@@ -143,12 +143,46 @@ void TypeMap::addSubstitutions(const TypeVariableSubstitution* tvs) {
     allTypeVariables.simpleCompose(tvs);
 }
 
-// Deep structural equivalence between canonical types.
-// Does not do unification of type variables - a type variable is only
-// equivalent to itself.  nullptr is only equivalent to nullptr.
+namespace {
+// Types whose equivalence is worth caching: comparing them recurses.
+bool isComposite(const IR::Type* type) {
+    return type->is<IR::Type_StructLike>() || type->is<IR::Type_BaseList>() ||
+            type->is<IR::Type_Stack>() || type->is<IR::Type_Set>() ||
+            type->is<IR::Type_Type>() || type->is<IR::Type_MethodBase>() ||
+            type->is<IR::Type_Package>() || type->is<IR::IApply>() ||
+            type->is<IR::Type_SpecializedCanonical>();
+}
+}  // namespace
+
+template <typename Compute>
+bool TypeMap::cached(const IR::Type* left, const IR::Type* right, unsigned flags,
+                     Compute compute) const {
+    TypePair key = { left, right, flags };
+    auto it = relationCache.find(key);
+    if (it != relationCache.end())
+        return it->second;
+    // A comparison which reports an error is not cached, so that the
+    // error is reported again next time.
+    auto errors = ::errorCount();
+    bool result = compute();
+    if (::errorCount() == errors)
+        relationCache.emplace(key, result);
+    return result;
+}
+
 bool TypeMap::equivalent(const IR::Type* left, const IR::Type* right, bool strict) const {
     if (!strict)
         strict = strictStruct;
+    if (left == nullptr || right == nullptr || !isComposite(left))
+        return checkEquivalence(left, right, strict);
+    return cached(left, right, strict ? 1 : 0,
+                  [&]() { return checkEquivalence(left, right, strict); });
+}
+
+// Deep structural equivalence between canonical types.
+// Does not do unification of type variables - a type variable is only
+// equivalent to itself.  nullptr is only equivalent to nullptr.
+bool TypeMap::checkEquivalence(const IR::Type* left, const IR::Type* right, bool strict) const {
     LOG3("Checking equivalence of " << left << " and " << right);
     if (left == nullptr)
         return right == nullptr;
@@ -326,6 +360,13 @@ bool TypeMap::equivalent(const IR::Type* left, const IR::Type* right, bool stric
 }
 
 bool TypeMap::implicitlyConvertibleTo(const IR::Type* from, const IR::Type* to) const {
+    if (!to->is<IR::Type_BaseList>() || !isComposite(from))
+        return checkImplicitConversion(from, to);
+    return cached(from, to, (strictStruct ? 1 : 0) | 2,
+                  [&]() { return checkImplicitConversion(from, to); });
+}
+
+bool TypeMap::checkImplicitConversion(const IR::Type* from, const IR::Type* to) const {
     if (equivalent(from, to))
         return true;
     if (from->is<IR::Type_InfInt>() && to->is<IR::Type_InfInt>())
@@ -359,24 +400,70 @@ bool TypeMap::implicitlyConvertibleTo(const IR::Type* from, const IR::Type* to)
     return false;
 }
 
+namespace {
+size_t combine(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+}  // namespace
+
+// Only looks at what TypeMap::equivalent compares; types which it compares
+// in a more complicated way only contribute their node type.
+size_t TypeMap::structuralHash(const IR::Type* type) const {
+    if (type == nullptr)
+        return 0;
+    std::hash<cstring> hashString;
+    size_t result = hashString(type->node_type_name());
+    if (auto tb = type->to<IR::Type_Bits>())
+        return combine(combine(result, tb->size), tb->isSigned);
+    if (auto tv = type->to<IR::Type_Varbits>())
+        return combine(result, tv->size);
+    if (auto tn = type->to<IR::Type_Newtype>())
+        return combine(result, hashString(tn->name.name));
+    if (auto tt = type->to<IR::Type_Type>())
+        return combine(result, structuralHash(tt->type));
+    if (auto tv = type->to<IR::ITypeVar>())
+        return combine(combine(result, hashString(tv->getVarName())), tv->getDeclId());
+    if (auto ts = type->to<IR::Type_Stack>()) {
+        result = combine(result, structuralHash(ts->elementType));
+        return ts->sizeKnown() ? combine(result, ts->getSize()) : result;
+    }
+    if (auto te = type->to<IR::Type_Enum>())
+        return combine(result, hashString(te->name.name));
+    if (auto te = type->to<IR::Type_SerEnum>())
+        return combine(result, hashString(te->name.name));
+    if (auto ts = type->to<IR::Type_StructLike>()) {
+        if (!ts->is<IR::Type_UnknownStruct>())
+            result = combine(result, hashString(ts->name.name));
+        for (auto f : ts->fields) {
+            result = combine(result, hashString(f->name.name));
+            result = combine(result, structuralHash(f->type));
+        }
+        return result;
+    }
+    if (auto tl = type->to<IR::Type_BaseList>()) {
+        for (auto c : tl->components)
+            result = combine(result, structuralHash(c));
+        return result;
+    }
+    if (auto ts = type->to<IR::Type_Set>())
+        return combine(result, structuralHash(ts->elementType));
+    if (auto te = type->to<IR::Type_Extern>())
+        return combine(result, hashString(te->name.name));
+    return result;
+}
+
 // Used for tuples, stacks and lists only
 const IR::Type* TypeMap::getCanonical(const IR::Type* type) {
-    // Currently a linear search; hopefully this won't be too expensive in practice
-    std::vector<const IR::Type*>* searchIn;
-    if (type->is<IR::Type_Stack>())
-        searchIn = &canonicalStacks;
-    else if (type->is<IR::Type_Tuple>())
-        searchIn = &canonicalTuples;
-    else if (type->is<IR::Type_List>())
-        searchIn = &canonicalLists;
-    else
+    if (!type->is<IR::Type_Stack>() && !type->is<IR::Type_Tuple>() && !type->is<IR::Type_List>())
         BUG("%1%: unexpected type", type);
 
-    for (auto t : *searchIn) {
-        if (equivalent(type, t, true))
-            return t;
+    auto hash = structuralHash(type);
+    auto range = canonicalTypes.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (equivalent(type, it->second, true))
+            return it->second;
     }
-    searchIn->push_back(type);
+    canonicalTypes.emplace(hash, type);
     return type;
 }
 
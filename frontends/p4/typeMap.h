@@ -17,6 +17,8 @@ limitations under the License.
 #ifndef _FRONTENDS_P4_TYPEMAP_H_
 #define _FRONTENDS_P4_TYPEMAP_H_
 
+#include <unordered_map>
+
 #include "ir/ir.h"
 #include "frontends/common/programMap.h"
 #include "frontends/p4/typeChecking/typeSubstitution.h"
@@ -41,9 +43,9 @@ class TypeMap final : public ProgramMap {
  protected:
     // We want to have the same canonical type for two
     // different tuples, lists, or stacks with the same signature.
-    std::vector<const IR::Type*> canonicalTuples;
-    std::vector<const IR::Type*> canonicalStacks;
-    std::vector<const IR::Type*> canonicalLists;
+    // Indexed by structuralHash, so that a lookup only compares
+    // types which are likely equivalent.
+    std::unordered_multimap<size_t, const IR::Type*> canonicalTypes;
 
     // Map each node to its canonical type
     ordered_map<const IR::Node*, const IR::Type*> typeMap;
@@ -57,8 +59,34 @@ class TypeMap final : public ProgramMap {
     // type that is substituted for it.
     TypeVariableSubstitution allTypeVariables;
 
+    // Results of equivalent and implicitlyConvertibleTo on composite
+    // types.  Types are immutable, so the results stay valid as long as
+    // the types exist; the entries keep them alive.
+    struct TypePair {
+        const IR::Type* left;
+        const IR::Type* right;
+        // strict equivalence, implicit conversion
+        unsigned flags;
+        bool operator==(const TypePair& other) const {
+            return left == other.left && right == other.right && flags == other.flags;
+        }
+    };
+    struct TypePairHash {
+        size_t operator()(const TypePair& p) const {
+            return std::hash<const void*>()(p.left) * 31 +
+                    std::hash<const void*>()(p.right) * 2 + p.flags;
+        }
+    };
+    mutable std::unordered_map<TypePair, bool, TypePairHash> relationCache;
+
     // checks some preconditions before setting the type
     void checkPrecondition(const IR::Node* element, const IR::Type* type) const;
+    bool checkEquivalence(const IR::Type* left, const IR::Type* right, bool strict) const;
+    bool checkImplicitConversion(const IR::Type* from, const IR::Type* to) const;
+    /// Looks up or computes @compute for @left and @right.
+    template <typename Compute>
+    bool cached(const IR::Type* left, const IR::Type* right, unsigned flags,
+                Compute compute) const;
 
  public:
     TypeMap() : ProgramMap("TypeMap"), strictStruct(false) {}
@@ -100,6 +128,9 @@ class TypeMap final : public ProgramMap {
 
     // Used for tuples and stacks only
     const IR::Type* getCanonical(const IR::Type* type);
+    /// A hash of @type which is the same for all types which are
+    /// strictly equivalent.
+    size_t structuralHash(const IR::Type* type) const;
     /// The width in bits of this type.  If the width is not
     /// well-defined this will report an error and return -1.
     /// max indicates whether we want the max width or min width.
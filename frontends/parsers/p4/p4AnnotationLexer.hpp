@@ -6,6 +6,9 @@
 
 namespace P4 {
 
+/// @return the constant held by @token, an INTEGER token.
+UnparsedConstant unparsedConstant(const IR::AnnotationToken* token);
+
 class P4AnnotationLexer : public AbstractP4Lexer {
  public:
     enum Type {
@@ -1,9 +1,13 @@
 #include "parserDriver.h"
 
+#include <cctype>
 #include <cerrno>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <iterator>
 #include <sstream>
+#include <unordered_map>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/format.hpp>
@@ -11,6 +15,7 @@
 
 #include "frontends/common/options.h"
 #include "frontends/common/constantFolding.h"
+#include "frontends/common/constantParsing.h"
 #include "frontends/parsers/p4/p4lexer.hpp"
 #include "frontends/parsers/p4/p4AnnotationLexer.hpp"
 #include "frontends/parsers/p4/p4parser.hpp"
@@ -121,6 +126,128 @@ void AbstractParserDriver::onParseError(const Util::SourceInfo& location,
     }
 }
 
+namespace {
+
+/// If @line is a line directive which the lexer maps (# 12 "file" or
+/// #line 12 "file"), sets @file and @number and @return true.
+bool readLineDirective(const std::string& line, cstring& file, unsigned& number) {
+    size_t pos;
+    if (line.compare(0, 5, "#line") == 0)
+        pos = 5;
+    else if (line.compare(0, 2, "# ") == 0)
+        pos = 2;
+    else
+        return false;
+    pos = line.find_first_not_of(" \t", pos);
+    if (pos == std::string::npos || !isdigit(line[pos]))
+        return false;
+    number = strtoul(line.c_str() + pos, nullptr, 10);
+    pos = line.find_first_not_of(" \t", line.find_first_not_of("0123456789", pos));
+    if (pos == std::string::npos || line[pos] != '"')
+        return false;
+    auto end = line.find('"', pos + 1);
+    file = line.substr(pos + 1, end == std::string::npos ? end : end - pos - 1);
+    return true;
+}
+
+bool isArchInclude(cstring file) {
+    for (const char* folder : { p4includePath,
+                                static_cast<const char*>(getenv("P4C_16_INCLUDE_PATH")) }) {
+        if (folder != nullptr && *folder != 0 && file.startsWith(cstring(folder) + "/"))
+            return true;
+    }
+    return false;
+}
+
+/// Calls @fn for each line of @text, without its newline, and whether
+/// the line ends with a newline.
+template<typename F>
+void forEachLine(const std::string& text, F fn) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        auto end = text.find('\n', pos);
+        bool newline = end != std::string::npos;
+        if (!newline)
+            end = text.size();
+        fn(text.substr(pos, end - pos), newline);
+        pos = end + 1;
+    }
+}
+
+/// Appends the lines of @text to @sources as the lexer would, including the
+/// mappings set by the line directives.
+void appendLines(Util::InputSources* sources, const std::string& text) {
+    forEachLine(text, [sources](const std::string& line, bool newline) {
+        sources->appendText(line.c_str());
+        cstring file;
+        unsigned number;
+        if (readLineDirective(line, file, number))
+            sources->mapLine(file, number);
+        if (newline)
+            sources->appendText("\n");
+    });
+}
+
+/// @return true if @line only has blanks and comments; @inComment tells
+/// whether a block comment is open, before and after the line.
+bool isBlankLine(const std::string& line, bool& inComment) {
+    for (size_t pos = 0; pos < line.size(); pos++) {
+        if (inComment) {
+            if (line.compare(pos, 2, "*/") == 0) {
+                inComment = false;
+                pos++;
+            }
+        } else if (line.compare(pos, 2, "/*") == 0) {
+            inComment = true;
+            pos++;
+        } else if (line.compare(pos, 2, "//") == 0) {
+            return true;
+        } else if (!isspace(line[pos])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Splits the preprocessed program @text into the lines of the architecture
+/// includes at its start and the other lines; the includes end at the
+/// first line of the program itself with something else than blanks and
+/// comments.
+/// @return false if the program does not start with architecture includes.
+bool splitIncludes(const std::string& text, std::string& includes, std::string& rest) {
+    // The leading newline puts the first line directive on line 2: the
+    // mapping of line 1 is set by the parser.
+    includes = "\n";
+    rest.clear();
+    bool inInclude = false, found = false, done = false, inComment = false;
+    forEachLine(text, [&](const std::string& line, bool newline) {
+        cstring file;
+        unsigned number;
+        if (!done && !inComment && readLineDirective(line, file, number)) {
+            inInclude = isArchInclude(file);
+            found |= inInclude;
+        } else if (!inInclude && !isBlankLine(line, inComment)) {
+            done = true;
+        }
+        auto& into = inInclude && !done ? includes : rest;
+        into += line;
+        if (newline)
+            into += '\n';
+    });
+    return found;
+}
+
+}  // namespace
+
+struct P4ParserDriver::IncludeSnapshot {
+    IR::Vector<IR::Node> nodes;
+    const Util::ProgramStructure* structure;
+    /// The error declaration in @nodes, if any.
+    const IR::Type_Error* errors;
+    /// The sources the snapshot was parsed from, with their comments.
+    const Util::InputSources* sources;
+};
+
 P4ParserDriver::P4ParserDriver()
   : structure(new Util::ProgramStructure)
   , nodes(new IR::Vector<IR::Node>())
@@ -153,11 +280,72 @@ P4ParserDriver::parse(std::istream& in, const char* sourceFile,
     LOG1("Parsing P4-16 program " << sourceFile);
 
     P4ParserDriver driver;
-    P4Lexer lexer(in);
+    std::string text{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    std::string includes, rest;
+    if (splitIncludes(text, includes, rest)) {
+        auto snapshot = getSnapshot(includes);
+        if (snapshot == nullptr) return nullptr;
+        driver.restore(snapshot, includes);
+        text = std::move(rest);
+    }
+
+    std::istringstream stream(text);
+    P4Lexer lexer(stream);
     if (!driver.parse(lexer, sourceFile, sourceLine)) return nullptr;
     return new IR::P4Program(driver.nodes->srcInfo, *driver.nodes);
 }
 
+/* static */ const P4ParserDriver::IncludeSnapshot*
+P4ParserDriver::getSnapshot(const std::string& includes) {
+    static std::unordered_map<std::string, const IncludeSnapshot*> snapshots;
+    auto it = snapshots.find(includes);
+    if (it != snapshots.end()) {
+        LOG2("Reusing the parsed architecture includes");
+        return it->second;
+    }
+
+    auto diagnostics = ::diagnosticCount();
+    P4ParserDriver driver;
+    std::istringstream stream(includes);
+    P4Lexer lexer(stream);
+    if (!driver.parse(lexer, "")) return nullptr;
+    auto snapshot = new IncludeSnapshot{ *driver.nodes, driver.structure, driver.allErrors,
+                                         driver.sources };
+    // Warnings would not be reported again for the next programs.
+    if (::diagnosticCount() == diagnostics)
+        snapshots.emplace(includes, snapshot);
+    return snapshot;
+}
+
+void P4ParserDriver::restore(const IncludeSnapshot* snapshot, const std::string& includes) {
+    structure = snapshot->structure->copy();
+    for (auto node : snapshot->nodes) {
+        // Later error declarations are merged into this one.
+        if (node == snapshot->errors)
+            node = allErrors = snapshot->errors->clone();
+        nodes->push_back(node);
+    }
+
+    // Give the sources of the program the same first lines as the sources
+    // of the snapshot, which the source positions of its nodes refer to.
+    appendLines(sources, includes);
+    sources->addComments(*snapshot->sources);
+}
+
+/* static */ const Util::InputSources*
+P4ParserDriver::readSources(const std::string& text, const char* sourceFile,
+                            unsigned sourceLine /* = 1 */) {
+    // The same lines and mappings, in the same order, as parse().
+    auto sources = new Util::InputSources;
+    std::string includes, rest;
+    bool split = splitIncludes(text, includes, rest);
+    if (split)
+        appendLines(sources, includes);
+    sources->mapLine(sourceFile, sourceLine);
+    appendLines(sources, split ? rest : text);
+    return sources;
+}
+
 /* static */ const IR::P4Program*
 P4ParserDriver::parse(FILE* in, const char* sourceFile,
                       unsigned sourceLine /* = 1 */) {
@@ -165,18 +353,82 @@ P4ParserDriver::parse(FILE* in, const char* sourceFile,
     return parse(inputStream.get(), sourceFile, sourceLine);
 }
 
+/* static */ const IR::Node*
+P4ParserDriver::parseSingleToken(P4AnnotationLexer::Type type,
+                                 const IR::Vector<IR::AnnotationToken>& body) {
+    if (body.size() != 1)
+        return nullptr;
+    auto token = body.at(0);
+    bool integer = token->token_type == P4Parser::token_type::TOK_INTEGER;
+    bool string = token->token_type == P4Parser::token_type::TOK_STRING_LITERAL;
+    bool list;
+    switch (type) {
+    case P4AnnotationLexer::EXPRESSION:
+    case P4AnnotationLexer::INTEGER_OR_STRING_LITERAL:
+        list = false;
+        break;
+    case P4AnnotationLexer::INTEGER:
+        list = false;
+        string = false;
+        break;
+    case P4AnnotationLexer::STRING_LITERAL:
+        list = false;
+        integer = false;
+        break;
+    case P4AnnotationLexer::EXPRESSION_LIST:
+    case P4AnnotationLexer::INTEGER_OR_STRING_LITERAL_LIST:
+        list = true;
+        break;
+    case P4AnnotationLexer::INTEGER_LIST:
+        list = true;
+        string = false;
+        break;
+    case P4AnnotationLexer::STRING_LITERAL_LIST:
+        list = true;
+        integer = false;
+        break;
+    default:
+        return nullptr;
+    }
+
+    const IR::Expression* result;
+    if (integer)
+        result = parseConstant(token->srcInfo, unparsedConstant(token), 0);
+    else if (string)
+        result = new IR::StringLiteral(token->srcInfo, token->text);
+    else
+        return nullptr;
+    if (!list)
+        return result;
+    auto vector = new IR::Vector<IR::Expression>();
+    vector->push_back(result);
+    return vector;
+}
+
+const IR::Node*
+P4ParserDriver::parseTokens(P4AnnotationLexer::Type type,
+                            const Util::SourceInfo& srcInfo,
+                            const IR::Vector<IR::AnnotationToken>& body) {
+    P4AnnotationLexer lexer(type, srcInfo, body);
+    if (!parse(lexer, srcInfo.getSourceFile())) {
+        return nullptr;
+    }
+
+    return nodes->front();
+}
+
 template<typename T> const T*
 P4ParserDriver::parse(P4AnnotationLexer::Type type,
                       const Util::SourceInfo& srcInfo,
                       const IR::Vector<IR::AnnotationToken>& body) {
     LOG3("Parsing P4-16 annotation " << srcInfo);
 
-    P4AnnotationLexer lexer(type, srcInfo, body);
-    if (!parse(lexer, srcInfo.getSourceFile())) {
+    auto node = parseSingleToken(type, body);
+    if (node == nullptr)
+        node = parseTokens(type, srcInfo, body);
+    if (node == nullptr)
         return nullptr;
-    }
-
-    return nodes->front()->to<T>();
+    return node->to<T>();
 }
 
 /* static */ const IR::Vector<IR::Expression>*
@@ -21,6 +21,7 @@ limitations under the License.
 #include <iostream>
 #include <string>
 
+#include "gtest/gtest_prod.h"
 #include "frontends/p4/symbol_table.h"
 #include "frontends/parsers/p4/abstractP4Lexer.hpp"
 #include "frontends/parsers/p4/p4AnnotationLexer.hpp"
@@ -97,10 +98,18 @@ class AbstractParserDriver {
 
 /// A ParserDriver that can parse P4-16 programs.
 class P4ParserDriver final : public AbstractParserDriver {
+    FRIEND_TEST(P4ParserDriver, SingleTokenAnnotations);
+
  public:
     /**
      * Parse a P4-16 program.
      *
+     * The architecture include files at the start of a preprocessed program
+     * (core.p4, v1model.p4, psa.p4...) are parsed once per process: the
+     * declarations and symbols they produce are kept in a snapshot keyed by
+     * their preprocessed text, and later programs which include the same
+     * text start from a copy of the snapshot instead of parsing it again.
+     *
      * @param in    The input source to read the program from.
      * @param sourceFile  The logical source filename. This doesn't have to be a
      *                    real filename, though it normally will be. This is
@@ -116,6 +125,16 @@ class P4ParserDriver final : public AbstractParserDriver {
     static const IR::P4Program* parse(FILE* in, const char* sourceFile,
                                       unsigned sourceLine = 1);
 
+    /**
+     * @return the sources which parse() records for the program @text, read
+     * from @sourceFile and @sourceLine, without parsing it. The source
+     * positions of the nodes parse() returns can be interpreted in them;
+     * only the comments are missing.
+     */
+    static const Util::InputSources* readSources(const std::string& text,
+                                                 const char* sourceFile,
+                                                 unsigned sourceLine = 1);
+
     /**
      * Parses a P4-16 annotation body.
      *
@@ -224,6 +243,31 @@ class P4ParserDriver final : public AbstractParserDriver {
     bool parse(AbstractP4Lexer& lexer, const char* sourceFile,
                unsigned sourceLine = 1);
 
+    /// The state of the driver after parsing some architecture includes.
+    struct IncludeSnapshot;
+
+    /// Parses the architecture includes @includes, or finds the snapshot
+    /// made when they were last parsed. @return nullptr, after reporting an
+    /// error, if they could not be parsed.
+    static const IncludeSnapshot* getSnapshot(const std::string& includes);
+
+    /// Sets the state of this driver to the state after parsing @includes,
+    /// whose snapshot is @snapshot.
+    void restore(const IncludeSnapshot* snapshot, const std::string& includes);
+
+    /// Most annotation bodies are a single integer or string literal, as in
+    /// @name("...") or @id(3). @return what the parser would produce for such
+    /// a @body with the given @type, built without a lexer and a parser, or
+    /// nullptr if @body has another form.
+    static const IR::Node* parseSingleToken(P4AnnotationLexer::Type type,
+                                            const IR::Vector<IR::AnnotationToken>& body);
+
+    /// Parses the annotation @body with the annotation lexer and the parser.
+    /// @return nullptr if it could not be parsed.
+    const IR::Node* parseTokens(P4AnnotationLexer::Type type,
+                                const Util::SourceInfo& srcInfo,
+                                const IR::Vector<IR::AnnotationToken>& body);
+
     /// Common functionality for parsing annotation bodies.
     template<typename T> const T* parse(P4AnnotationLexer::Type type,
                                         const Util::SourceInfo& srcInfo,
@@ -60,6 +60,53 @@ int IR::Member::msb() const {
   return lsb() + type->width_bits() - 1;
 }
 
+/// Same as handleOverflow for widths of 64 bits or less, with machine
+/// integers instead of big_int temporaries.  @return false if the value
+/// does not fit in 64 bits, and was not checked.
+bool
+IR::Constant::handleSmallOverflow(int width, bool isSigned, bool noWarning) {
+    uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+    if (isSigned) {
+        if (!fitsInt64())
+            return false;
+        int64_t v = static_cast<int64_t>(value);
+        int64_t max = static_cast<int64_t>(mask >> 1);
+        int64_t min = -max - 1;
+        if (v < min || v > max) {
+            if (!noWarning)
+                ::warning(ErrorType::WARN_OVERFLOW,
+                          "%1%: signed value does not fit in %2% bits", this, width);
+            uint64_t masked = static_cast<uint64_t>(v) & mask;
+            LOG2("value=" << v << ", min=" << min << ", max=" << max << ", masked=" << masked);
+            // Sign-extend the low width bits.
+            if (masked > static_cast<uint64_t>(max))
+                masked |= ~mask;
+            value = static_cast<int64_t>(masked);
+        }
+        return true;
+    }
+
+    if (value < 0) {
+        if (!fitsInt64())
+            return false;
+        if (!noWarning)
+            ::warning(ErrorType::WARN_MISMATCH,
+                      "%1%: negative value with unsigned type", this);
+        value = static_cast<uint64_t>(static_cast<int64_t>(value)) & mask;
+        return true;
+    }
+    if (!fitsUint64())
+        return false;
+    uint64_t v = static_cast<uint64_t>(value);
+    if ((v & mask) != v) {
+        if (!noWarning)
+            ::warning(ErrorType::WARN_MISMATCH,
+                      "%1%: value does not fit in %2% bits", this, width);
+        value = v & mask;
+    }
+    return true;
+}
+
 void
 IR::Constant::handleOverflow(bool noWarning) {
     if (type == nullptr)
@@ -73,6 +120,9 @@ IR::Constant::handleOverflow(bool noWarning) {
     }
 
     int width = tb->size;
+    if (width > 0 && width <= 64 && handleSmallOverflow(width, tb->isSigned, noWarning))
+        return;
+
     big_int one = 1;
     big_int mask = Util::mask(width);
 
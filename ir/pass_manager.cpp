@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include "ir.h"
+#include "lib/compile_stats.h"
 #include "lib/gc.h"
 #include "lib/n4.h"
 
@@ -47,11 +48,13 @@ void PassManager::listPasses(std::ostream &out, cstring sep) const {
 const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *) {
     safe_vector<std::pair<safe_vector<Visitor *>::iterator, const IR::Node *>> backup;
     static indent_t log_indent(-1);
+    static int depth = -1;  // the same nesting, reported by CompileStats
     struct indent_nesting {
         indent_t &indent;
-        explicit indent_nesting(indent_t &i) : indent(i) { ++indent; }
-        ~indent_nesting() { --indent; }
-    } nest_log_indent(log_indent);
+        int &depth;
+        indent_nesting(indent_t &i, int &d) : indent(i), depth(d) { ++indent; ++depth; }
+        ~indent_nesting() { --indent; --depth; }
+    } nest_log_indent(log_indent, depth);
 
     early_exit_flag = false;
     unsigned initial_error_count = ::errorCount();
@@ -64,7 +67,11 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
         try {
             try {
                 LOG1(log_indent << name() << " invoking " << v->name());
-                auto after = program->apply(**it);
+                const IR::Node* after;
+                {
+                    Util::CompileStats::PassTimer timer(v->name(), name(), depth);
+                    after = program->apply(**it);
+                }
                 if (LOGGING(3)) {
                     size_t maxmem, mem = gc_mem_inuse(&maxmem);  // triggers gc
                     LOG3(log_indent << "heap after " << v->name() << ": in use " <<
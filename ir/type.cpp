@@ -14,7 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include "ir.h"
 #include "frontends/common/options.h"
 
@@ -53,6 +55,7 @@ const cstring IR::Annotation::noSideEffectsAnnotation = "noSideEffects";
 const cstring IR::Annotation::noWarnAnnotation = "noWarn";
 const cstring IR::Annotation::matchAnnotation = "match";
 const cstring IR::Annotation::fieldListAnnotation = "field_list";
+const cstring IR::Annotation::entriesFileAnnotation = "entries_file";
 
 int Type_Declaration::nextId = 0;
 int Type_InfInt::nextId = 0;
@@ -62,12 +65,26 @@ Annotations* Annotations::empty = new Annotations(Vector<Annotation>());
 const Type* Type_Stack::at(size_t) const { return elementType; }
 
 const Type_Bits* Type_Bits::get(int width, bool isSigned) {
-    // map (width, signed) to type
-    using bit_type_key = std::pair<int, bool>;
-    static std::map<bit_type_key, const IR::Type_Bits*> *type_map = nullptr;
-    if (type_map == nullptr)
-        type_map = new std::map<bit_type_key, const IR::Type_Bits*>();
-    auto &result = (*type_map)[std::make_pair(width, isSigned)];
+    // Types are immutable, so all the uses of a bit type share one node.
+    // The pool is indexed directly by width for the usual widths.
+    static const int directWidths = 4096;
+    static std::vector<const IR::Type_Bits*> *direct[2] = { nullptr, nullptr };
+    static std::unordered_map<int, const IR::Type_Bits*> *other[2] = { nullptr, nullptr };
+    const IR::Type_Bits** slot;
+    if (width >= 0 && width < directWidths) {
+        auto &pool = direct[isSigned];
+        if (pool == nullptr)
+            pool = new std::vector<const IR::Type_Bits*>();
+        if (pool->size() <= size_t(width))
+            pool->resize(width + 1);
+        slot = &(*pool)[width];
+    } else {
+        auto &pool = other[isSigned];
+        if (pool == nullptr)
+            pool = new std::unordered_map<int, const IR::Type_Bits*>();
+        slot = &(*pool)[width];
+    }
+    auto &result = *slot;
     if (!result)
         result = new Type_Bits(width, isSigned);
     if (width > P4CContext::getConfig().maximumWidthSupported())
@@ -112,7 +129,10 @@ const Type::Varbits *Type::Varbits::get(Util::SourceInfo si, int sz) {
 }
 
 const Type::Varbits *Type::Varbits::get() {
-    return new Type::Varbits(0);
+    static const Type::Varbits *singleton = nullptr;
+    if (!singleton)
+        singleton = (new Type::Varbits(0));
+    return singleton;
 }
 
 const Type_Dontcare *Type_Dontcare::get() {
@@ -0,0 +1,301 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "compile_server.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "compile_stats.h"
+#include "log.h"
+
+namespace Util {
+
+namespace {
+
+const char* baseName(const char* path) {
+    auto slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        auto size = write(fd, data.data() + done, data.size() - done);
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size <= 0)
+            return false;
+        done += size;
+    }
+    return true;
+}
+
+/// Receives a message on @socket into @data, appending the descriptors it
+/// carries to @fds. @return the size of the message, 0 at the end of the
+/// stream and -1 on errors.
+ssize_t receive(int socket, std::string& data, std::vector<int>& fds) {
+    char buffer[4096];
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(3 * sizeof(int))];
+    } control;
+    struct iovec iov = { buffer, sizeof(buffer) };
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    ssize_t size;
+    do {
+        size = recvmsg(socket, &msg, 0);
+    } while (size < 0 && errno == EINTR);
+    if (size < 0)
+        return size;
+    for (auto c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+            continue;
+        auto received = reinterpret_cast<const int*>(CMSG_DATA(c));
+        fds.insert(fds.end(), received, received + (c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+    }
+    data.append(buffer, size);
+    return size;
+}
+
+/// Sends @fd on @socket with a one byte message.
+bool sendDescriptor(int socket, int fd) {
+    char byte = 0;
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct iovec iov = { &byte, 1 };
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    auto c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(c), &fd, sizeof(int));
+    return sendmsg(socket, &msg, 0) == 1;
+}
+
+/// Reads a request from @connection: the working folder and the command line
+/// go to @strings, the standard input, output and error to @fds.
+bool readRequest(int connection, std::vector<std::string>& strings, std::vector<int>& fds) {
+    std::string data;
+    size_t count = 0;
+    while (true) {
+        auto size = receive(connection, data, fds);
+        if (size <= 0)
+            return false;
+        auto terminators = std::count(data.begin(), data.end(), '\0');
+        if (terminators == 0)
+            continue;
+        char* end;
+        count = strtoul(data.c_str(), &end, 10);
+        if (*end != 0 || count < 2)
+            return false;
+        if (size_t(terminators) == count + 1)
+            break;
+        if (size_t(terminators) > count + 1)
+            return false;
+    }
+    auto pos = data.find('\0') + 1;
+    while (pos < data.size()) {
+        auto end = data.find('\0', pos);
+        strings.push_back(data.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return fds.size() == 3;
+}
+
+/// Runs the request on @connection in this process; @program is the name of
+/// the compiler.
+void handle(int connection, const char* program, const CompileServer::Compile& compile) {
+    std::vector<std::string> strings;
+    std::vector<int> fds;
+    bool valid = readRequest(connection, strings, fds);
+    if (!valid || strcmp(baseName(strings[1].c_str()), program) != 0) {
+        for (auto fd : fds)
+            close(fd);
+        if (valid)
+            writeAll(connection, "unsupported\n");
+        return;
+    }
+
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(stdout);
+    fflush(stderr);
+    int saved[3];
+    for (int i = 0; i < 3; i++) {
+        saved[i] = dup(i);
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+    std::cin.clear();
+    clearerr(stdin);
+    int folder = open(".", O_RDONLY);
+
+    int code = 1;
+    if (chdir(strings[0].c_str()) != 0) {
+        std::cerr << strings[0] << ": " << strerror(errno) << std::endl;
+    } else {
+        std::vector<char*> argv;
+        for (size_t i = 1; i < strings.size(); i++)
+            argv.push_back(&strings[i][0]);
+        argv.push_back(nullptr);
+        try {
+            code = compile(argv.size() - 1, argv.data());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    // Undo what the options of the request changed.
+    Log::reset();
+    CompileStats::close();
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = 0; i < 3; i++) {
+        dup2(saved[i], i);
+        close(saved[i]);
+    }
+    if (fchdir(folder) != 0)
+        perror("fchdir");
+    close(folder);
+    writeAll(connection, std::to_string(code) + "\n");
+}
+
+/// Starts a worker process which runs the connections it receives on
+/// @control; it reports the end of each request with a byte on @control.
+pid_t startWorker(int& control, const char* program, const CompileServer::Compile& compile) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+        return -1;
+    auto pid = fork();
+    if (pid != 0) {
+        close(sockets[1]);
+        control = sockets[0];
+        return pid;
+    }
+
+    close(sockets[0]);
+    while (true) {
+        std::string data;
+        std::vector<int> fds;
+        if (receive(sockets[1], data, fds) <= 0)
+            _exit(0);
+        for (auto fd : fds) {
+            handle(fd, program, compile);
+            close(fd);
+        }
+        if (!writeAll(sockets[1], std::string(1, '\0')))
+            _exit(0);
+    }
+}
+
+}  // namespace
+
+bool CompileServer::requested(int argc, char* const argv[]) {
+    return argc > 1 && strcmp(argv[1], "--server") == 0;
+}
+
+int CompileServer::serve(int argc, char* const argv[], Compile compile) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " --server <socket>" << std::endl;
+        return 1;
+    }
+    const char* path = argv[2];
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        std::cerr << path << ": socket path too long" << std::endl;
+        return 1;
+    }
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (listener < 0 ||
+        bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, 16) != 0) {
+        perror(path);
+        return 1;
+    }
+    LOG1("Serving compilations on " << path);
+
+    const char* program = baseName(argv[0]);
+    int control = -1;
+    pid_t worker = -1;
+    while (true) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("accept");
+            return 1;
+        }
+
+        // A worker which died between requests is replaced first.
+        if (worker < 0 || !sendDescriptor(control, connection)) {
+            if (worker >= 0) {
+                close(control);
+                waitpid(worker, nullptr, 0);
+            }
+            worker = startWorker(control, program, compile);
+            if (worker < 0 || !sendDescriptor(control, connection)) {
+                perror("fork");
+                return 1;
+            }
+        }
+
+        char done;
+        ssize_t size;
+        do {
+            size = read(control, &done, 1);
+        } while (size < 0 && errno == EINTR);
+        if (size != 1) {
+            // The request ended the worker: reply with its exit status.
+            int status = 0;
+            waitpid(worker, &status, 0);
+            int code = WIFEXITED(status) ? WEXITSTATUS(status)
+                     : WIFSIGNALED(status) ? 128 + WTERMSIG(status) : 1;
+            writeAll(connection, std::to_string(code) + "\n");
+            close(control);
+            worker = -1;
+        }
+        close(connection);
+    }
+}
+
+}  // namespace Util
@@ -0,0 +1,54 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_COMPILE_SERVER_H_
+#define LIB_COMPILE_SERVER_H_
+
+#include <functional>
+
+namespace Util {
+
+/**
+ * Runs a compiler as a long-lived server on a Unix socket, started with
+ * "--server <socket>" as its only arguments. Compilations then share the
+ * process start-up and the state which outlives a compilation, such as
+ * interned strings and parsed architecture includes.
+ *
+ * A request is sent on a new connection: the number of strings that
+ * follow, then the working folder and the command line, each terminated
+ * by a NUL character. The first message also carries the client's standard
+ * input, output and error (SCM_RIGHTS), which the compilation uses. The
+ * reply is the exit code followed by a newline, or "unsupported\n" if the
+ * command is for another compiler.
+ *
+ * Requests are run one at a time, each with its own compile context, by
+ * a worker process. When a request ends the worker (exit() in an option
+ * handler, a crash), the server replies with its exit status and starts a
+ * new worker.
+ */
+class CompileServer {
+ public:
+    /// Compiles like main() and @return the exit code.
+    typedef std::function<int(int argc, char* const argv[])> Compile;
+
+    /// @return true if the command line asks for server mode.
+    static bool requested(int argc, char* const argv[]);
+    /// Serves requests with @compile until the process is killed.
+    /// @return an exit code if the server cannot start.
+    static int serve(int argc, char* const argv[], Compile compile);
+};
+
+}  // namespace Util
+
+#endif /* LIB_COMPILE_SERVER_H_ */
@@ -0,0 +1,75 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "compile_stats.h"
+
+#include <string>
+
+#include "gc.h"
+
+namespace Util {
+
+namespace {
+
+std::string quote(const char* text) {
+    std::string result = "\"";
+    for (auto c = text ? text : ""; *c != 0; c++) {
+        if (*c == '"' || *c == '\\')
+            result += '\\';
+        result += *c;
+    }
+    return result + "\"";
+}
+
+}  // namespace
+
+FILE* CompileStats::output = nullptr;
+
+bool CompileStats::open(cstring file) {
+    close();
+    output = fopen(file, "a");
+    return output != nullptr;
+}
+
+void CompileStats::close() {
+    if (output != nullptr)
+        fclose(output);
+    output = nullptr;
+}
+
+CompileStats::PassTimer::PassTimer(const char* pass, const char* manager, int depth)
+        : pass(pass), manager(manager), depth(depth), allocations(0) {
+    if (!enabled())
+        return;
+    allocations = gc_alloc_count();
+    start = std::chrono::steady_clock::now();
+}
+
+CompileStats::PassTimer::~PassTimer() {
+    if (!enabled())
+        return;
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    auto count = gc_alloc_count() - allocations;
+    // Write each line at once, so that passes running in several processes
+    // with the same file do not mix their lines.
+    auto line = "{\"pass\": " + quote(pass) +
+                ", \"in\": " + quote(manager) +
+                ", \"depth\": " + std::to_string(depth) +
+                ", \"seconds\": " + std::to_string(seconds.count()) +
+                ", \"allocations\": " + std::to_string(count) + "}\n";
+    fwrite(line.data(), 1, line.size(), output);
+    fflush(output);
+}
+
+}  // namespace Util
@@ -0,0 +1,65 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef LIB_COMPILE_STATS_H_
+#define LIB_COMPILE_STATS_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+#include "lib/cstring.h"
+
+namespace Util {
+
+/**
+ * Records the time and the allocations of each pass run by a PassManager,
+ * when enabled with --pass-stats <file>. Each pass appends one line to the
+ * file, holding a JSON object:
+ *
+ *   {"pass": "TypeChecking", "in": "FrontEnd", "depth": 0,
+ *    "seconds": 0.0123, "allocations": 4567}
+ *
+ * "in" is the PassManager running the pass and "depth" its nesting level;
+ * the passes at depth 0 are the phases of the compiler. Allocations are only
+ * counted when the compiler uses libgc. tools/p4c-bench.py reads these files.
+ */
+class CompileStats {
+ public:
+    /// Starts appending the statistics to @file.
+    static bool open(cstring file);
+    /// Stops recording.
+    static void close();
+    static bool enabled() { return output != nullptr; }
+
+    /// Measures a pass, from its construction to its destruction.
+    class PassTimer {
+        const char* pass;
+        const char* manager;
+        int depth;
+        std::chrono::steady_clock::time_point start;
+        size_t allocations;
+
+     public:
+        PassTimer(const char* pass, const char* manager, int depth);
+        ~PassTimer();
+    };
+
+ private:
+    static FILE* output;
+};
+
+}  // namespace Util
+
+#endif /* LIB_COMPILE_STATS_H_ */
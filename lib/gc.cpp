@@ -36,6 +36,7 @@ limitations under the License.
 #endif
 
 static bool done_init, started_init;
+static size_t alloc_count;
 // emergency pool to allow a few extra allocations after a bad_alloc is thrown so we
 // can generate reasonable errors, a stack trace, etc
 static char emergency_pool[16*1024];
@@ -52,6 +53,7 @@ void *operator new(std::size_t size) {
         started_init = true;
         GC_INIT();
         done_init = true; }
+    alloc_count++;
     auto *rv = ::operator new(size, UseGC, 0, 0);
     if (!rv && emergency_ptr && emergency_ptr + size < emergency_pool + sizeof(emergency_pool)) {
         rv = emergency_ptr;
@@ -199,3 +201,7 @@ size_t gc_mem_inuse(size_t *max) {
     return 0;
 #endif
 }
+
+size_t gc_alloc_count() {
+    return alloc_count;
+}
@@ -21,5 +21,6 @@ limitations under the License.
 
 void setup_gc_logging();
 size_t gc_mem_inuse(size_t *max = 0);  // trigger GC, return inuse after
+size_t gc_alloc_count();  // number of calls to operator new; 0 without libgc
 
 #endif /* LIB_GC_H_ */
@@ -330,4 +330,17 @@ void increaseVerbosity() {
     Detail::invalidateCaches(Detail::verbosity - 1);
 }
 
+void reset() {
+#ifdef MULTITHREAD
+    static std::mutex lock;
+    std::lock_guard<std::mutex> acquire(lock);
+#endif  // MULTITHREAD
+
+    Detail::debugSpecs.clear();
+    Detail::logfiles.clear();
+    Detail::verbosity = 0;
+    Detail::maximumLogLevel = 0;
+    Detail::invalidateCaches(0);
+}
+
 }  // namespace Log
@@ -84,6 +84,9 @@ inline bool verbose() { return Detail::verbosity > 0; }
 inline int verbosity() { return Detail::verbosity; }
 void increaseVerbosity();
 
+// Forget all debug specs and the verbosity level, and close the log files.
+void reset();
+
 }  // namespace Log
 
 #ifndef MAX_LOGGING_LEVEL
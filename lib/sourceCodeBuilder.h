@@ -18,38 +18,100 @@ limitations under the License.
 #define _LIB_SOURCECODEBUILDER_H_
 
 #include <ctype.h>
-#include <sstream>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
 
 #include "lib/stringify.h"
 #include "lib/cstring.h"
 #include "lib/exceptions.h"
+#include "lib/null.h"
 
 namespace Util {
 class SourceCodeBuilder {
     int indentLevel;  // current indent level
     unsigned indentAmount;
 
-    std::stringstream buffer;
-    const std::string nl = "\n";
+    // The text is kept in chunks of at least chunkSize characters,
+    // so appending never copies the text before it.  Once an output
+    // stream is set, full chunks are written to it and reused.
+    static const size_t chunkSize = 64 * 1024;
+    std::vector<std::string> chunks;
+    std::ostream* output;
     bool endsInSpace;
 
+    /// @return the chunk to append @size characters to.
+    std::string& room(size_t size) {
+        if (!chunks.empty() && chunks.back().capacity() - chunks.back().size() < size &&
+            output != nullptr)
+            write();
+        if (chunks.empty() || chunks.back().capacity() - chunks.back().size() < size) {
+            chunks.emplace_back();
+            chunks.back().reserve(size > chunkSize ? size : chunkSize);
+        }
+        return chunks.back();
+    }
+    void write(const char* str, size_t size) { room(size).append(str, size); }
+    /// Writes the text held to the output stream.
+    void write() {
+        for (auto& chunk : chunks)
+            output->write(chunk.data(), chunk.size());
+        if (chunks.size() > 1)
+            chunks.erase(chunks.begin(), chunks.end() - 1);
+        if (!chunks.empty())
+            chunks.back().clear();
+    }
+    void appendNumber(unsigned long long value, bool negative) {
+        char digits[24];
+        char* end = digits + sizeof(digits);
+        char* start = end;
+        do {
+            *--start = '0' + value % 10;
+            value /= 10;
+        } while (value != 0);
+        if (negative)
+            *--start = '-';
+        write(start, end - start);
+        endsInSpace = false;
+    }
+
  public:
     SourceCodeBuilder() :
             indentLevel(0),
             indentAmount(4),
+            output(nullptr),
             endsInSpace(false)
     {}
 
+    /// Writes the text built so far to @out, and then writes the text to it
+    /// as the chunks fill up, instead of keeping the whole text in memory.
+    /// toString() cannot be used afterwards; call flush() when done.
+    void setOutput(std::ostream* out) {
+        CHECK_NULL(out);
+        output = out;
+        write();
+    }
+    /// Writes the remaining text to the output stream and flushes it.
+    void flush() {
+        BUG_CHECK(output != nullptr, "No output stream");
+        write();
+        output->flush();
+    }
+
     void increaseIndent() { indentLevel += indentAmount; }
     void decreaseIndent() {
         indentLevel -= indentAmount;
         if (indentLevel < 0)
             BUG("Negative indent");
     }
-    void newline() { buffer << nl; endsInSpace = true; }
+    void newline() { write("\n", 1); endsInSpace = true; }
     void spc() {
         if (!endsInSpace)
-            buffer << " ";
+            write(" ", 1);
         endsInSpace = true;
     }
 
@@ -59,29 +121,46 @@ class SourceCodeBuilder {
         if (str.size() == 0)
             return;
         endsInSpace = ::isspace(str.at(str.size() - 1));
-        buffer << str;
+        write(str.data(), str.size());
     }
     void append(char c) {
         endsInSpace = ::isspace(c);
-        buffer << c;
+        write(&c, 1);
     }
     void append(const char* str) {
         if (str == nullptr)
             BUG("Null argument to append");
-        if (strlen(str) == 0)
+        size_t size = strlen(str);
+        if (size == 0)
             return;
-        endsInSpace = ::isspace(str[strlen(str) - 1]);
-        buffer << str;
+        endsInSpace = ::isspace(str[size - 1]);
+        write(str, size);
     }
+    // Formats straight into the buffer, without making a cstring.
     void appendFormat(const char* format, ...) {
-        va_list ap;
+        char buf[128];
+        va_list ap, ap_copy;
         va_start(ap, format);
-        cstring str = Util::vprintf_format(format, ap);
+        va_copy(ap_copy, ap);
+        int size = vsnprintf(buf, sizeof(buf), format, ap);
         va_end(ap);
-        append(str);
+        if (size < 0)
+            BUG("Error in vsnprintf");
+        if (static_cast<size_t>(size) < sizeof(buf)) {
+            write(buf, size);
+        } else {
+            auto& chunk = room(size + 1);
+            auto start = chunk.size();
+            chunk.resize(start + size + 1);
+            vsnprintf(&chunk[start], size + 1, format, ap_copy);
+            chunk.resize(start + size);
+        }
+        va_end(ap_copy);
+        if (size > 0)
+            endsInSpace = ::isspace(chunks.back().back());
     }
-    void append(unsigned u) { appendFormat("%d", u); }
-    void append(int u) { appendFormat("%d", u); }
+    void append(unsigned u) { appendNumber(u, false); }
+    void append(int u) { appendNumber(u < 0 ? 0ULL - u : u, u < 0); }
 
     void endOfStatement(bool addNl = false) {
         append(";");
@@ -94,7 +173,7 @@ class SourceCodeBuilder {
     }
 
     void emitIndent() {
-        buffer << std::string(indentLevel, ' ');
+        room(indentLevel).append(indentLevel, ' ');
         if (indentLevel > 0)
             endsInSpace = true;
     }
@@ -107,7 +186,17 @@ class SourceCodeBuilder {
             newline();
     }
 
-    std::string toString() const { return buffer.str(); }
+    std::string toString() const {
+        BUG_CHECK(output == nullptr, "Text was written to the output stream");
+        size_t size = 0;
+        for (auto& chunk : chunks)
+            size += chunk.size();
+        std::string result;
+        result.reserve(size);
+        for (auto& chunk : chunks)
+            result += chunk;
+        return result;
+    }
     void commentStart() { append("/* "); }
     void commentEnd() { append(" */"); }
     bool lastIsSpace() const { return endsInSpace; }
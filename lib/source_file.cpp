@@ -69,6 +69,10 @@ void InputSources::addComment(SourceInfo srcInfo, bool singleLine, cstring body)
     comments.push_back(comment);
 }
 
+void InputSources::addComments(const InputSources& other) {
+    comments.insert(comments.end(), other.comments.begin(), other.comments.end());
+}
+
 /// prevent further changes
 void InputSources::seal() {
     LOG4(toDebugString());
@@ -327,6 +327,8 @@ class InputSources final {
 
     cstring toDebugString() const;
     void addComment(SourceInfo srcInfo, bool singleLine, cstring body);
+    /// Appends the comments of @other.
+    void addComments(const InputSources& other);
 
  private:
     /// Append this text to the last line; must not contain newlines
@@ -26,6 +26,8 @@ DoSingleArgumentSelect::Pair::Pair(const IR::Expression* e, const IR::Type* type
 static const IR::Expression* convertList(
     const IR::Expression* expression, const IR::Type* selectListType) {
     if (expression->is<IR::DefaultExpression>()) {
+        // The list may be wider than the widest type a program can declare,
+        // so this type is not created with Type_Bits::get, which reports it.
         int width = selectListType->width_bits();
         auto type = new IR::Type_Bits(width, false);
         return new IR::Mask(expression->srcInfo,
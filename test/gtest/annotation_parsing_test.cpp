@@ -0,0 +1,188 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/common/parseInput.h"
+#include "frontends/p4/parseAnnotations.h"
+#include "frontends/parsers/parserDriver.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace P4 {
+
+namespace {
+
+/// The annotations in @source, with their bodies unparsed.
+std::vector<const IR::Annotation*> annotations(const std::string& source) {
+    std::vector<const IR::Annotation*> result;
+    std::istringstream in(source);
+    auto program = P4ParserDriver::parse(in, "annotations.p4");
+    EXPECT_TRUE(program != nullptr);
+    if (program != nullptr)
+        forAllMatching<IR::Annotation>(program, [&](const IR::Annotation* annotation) {
+            EXPECT_TRUE(annotation->needsParsing);
+            result.push_back(annotation);
+        });
+    return result;
+}
+
+/// Runs @parse in a compile context of its own, and @return its nodes,
+/// with their source positions, and its diagnostics. @node is set to the
+/// node returned by @parse.
+std::string parseWith(std::function<const IR::Node*()> parse, const IR::Node*& node) {
+    AutoCompileContext autoContext(new GTestContext(GTestContext::get()));
+    std::stringstream out;
+    BaseCompileContext::get().errorReporter().setOutputStream(&out);
+    node = parse();
+    out << ::errorCount() << " errors" << std::endl;
+    if (node == nullptr)
+        return out.str();
+    forAllMatching<IR::Node>(node, [&](const IR::Node* n) {
+        out << n->node_type_name() << " " << n->toString() << " "
+            << n->srcInfo.getStart().toString() << "-"
+            << n->srcInfo.getEnd().toString() << std::endl;
+    });
+    return out.str();
+}
+
+}  // namespace
+
+TEST(P4ParserDriver, SingleTokenAnnotations) {
+    // Integers with and without a width or a base, one whose width is too
+    // large, and string literals.
+    auto bodies = annotations(R"(
+@name("x") @id(3) @a(8w3) @b(0x1F) @c(16w0xbeef) @d(4096w1)
+@e("") @f(0)
+const bit<8> c = 1;
+)");
+    EXPECT_EQ(8u, bodies.size());
+    const P4AnnotationLexer::Type types[] = {
+        P4AnnotationLexer::EXPRESSION,
+        P4AnnotationLexer::INTEGER,
+        P4AnnotationLexer::INTEGER_OR_STRING_LITERAL,
+        P4AnnotationLexer::STRING_LITERAL,
+        P4AnnotationLexer::EXPRESSION_LIST,
+        P4AnnotationLexer::INTEGER_LIST,
+        P4AnnotationLexer::INTEGER_OR_STRING_LITERAL_LIST,
+        P4AnnotationLexer::STRING_LITERAL_LIST,
+    };
+    for (auto annotation : bodies) {
+        for (auto type : types) {
+            SCOPED_TRACE(std::string(annotation->name.name.c_str()) + " parsed as " +
+                         std::to_string(type));
+            const IR::Node* fast;
+            const IR::Node* parsed;
+            auto fastResult = parseWith([&]() {
+                return P4ParserDriver::parseSingleToken(type, annotation->body);
+            }, fast);
+            auto parsedResult = parseWith([&]() {
+                P4ParserDriver driver;
+                return driver.parseTokens(type, annotation->srcInfo, annotation->body);
+            }, parsed);
+            // Of these bodies, those which the grammar accepts are exactly
+            // those built without it; the others are left to the parser.
+            EXPECT_EQ(parsed != nullptr, fast != nullptr) << parsedResult;
+            if (fast == nullptr || parsed == nullptr)
+                continue;
+            EXPECT_TRUE(fast->equiv(*parsed));
+            EXPECT_EQ(parsedResult, fastResult);
+        }
+    }
+}
+
+TEST(P4ParserDriver, SingleTokenAnnotationErrors) {
+    auto bodies = annotations(R"(
+@name("x") @id(3) @d(4096w1)
+const bit<8> c = 1;
+)");
+    ASSERT_EQ(3u, bodies.size());
+    auto name = bodies[0], id = bodies[1], wide = bodies[2];
+    const IR::Node* node;
+
+    // A string where an integer is expected still reaches the parser,
+    // which reports a syntax error.
+    auto result = parseWith([&]() {
+        return P4ParserDriver::parseConstant(name->srcInfo, name->body);
+    }, node);
+    EXPECT_TRUE(node == nullptr);
+    EXPECT_NE(std::string::npos, result.find("syntax error")) << result;
+    EXPECT_NE(std::string::npos, result.find("1 errors")) << result;
+    result = parseWith([&]() {
+        return P4ParserDriver::parseConstantList(name->srcInfo, name->body);
+    }, node);
+    EXPECT_TRUE(node == nullptr);
+    EXPECT_NE(std::string::npos, result.find("syntax error")) << result;
+    result = parseWith([&]() {
+        return P4ParserDriver::parseStringLiteral(id->srcInfo, id->body);
+    }, node);
+    EXPECT_TRUE(node == nullptr);
+    EXPECT_NE(std::string::npos, result.find("syntax error")) << result;
+
+    // A constant error is reported at the constant, which has the default
+    // value, as in the grammar.
+    result = parseWith([&]() {
+        return P4ParserDriver::parseConstant(wide->srcInfo, wide->body);
+    }, node);
+    ASSERT_TRUE(node != nullptr);
+    EXPECT_EQ(0, node->to<IR::Constant>()->asInt());
+    EXPECT_NE(std::string::npos, result.find("4096 size too large")) << result;
+    EXPECT_NE(std::string::npos, result.find("1 errors")) << result;
+}
+
+}  // namespace P4
+
+namespace Test {
+
+class AnnotationParsing : public P4CTest { };
+
+TEST_F(AnnotationParsing, NotInExpressions) {
+    // Annotations of parameters, key elements and struct fields, which
+    // follow or contain expressions.
+    auto source = P4CTestEnvironment::get()->v1Model() + v1modelProgram(R"(
+    @name("ingress.a") action a(@name("p") bit<8> p) { h.h.a = p; }
+    @id(3) table t {
+        key = { h.h.a : exact @name("k"); h.h.b : exact @ids(1, 2) @name("k2"); }
+        actions = { a; }
+    }
+    apply { if (h.h.a == 1) { t.apply(); } }
+)", "", R"(@name("f") @id(4) bit<8> f;)");
+    auto program = P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(program != nullptr);
+    program = program->apply(P4::ParseAnnotations("AnnotationParsing", true, {
+                PARSE("id", Constant),
+                PARSE_CONSTANT_LIST("ids")
+            }));
+    ASSERT_TRUE(program != nullptr);
+    EXPECT_EQ(0u, ::errorCount());
+
+    unsigned count = 0;
+    forAllMatching<IR::Annotation>(program, [&](const IR::Annotation* annotation) {
+        auto name = annotation->name.name;
+        if (name != "name" && name != "id" && name != "ids")
+            return;
+        count++;
+        EXPECT_FALSE(annotation->needsParsing) << annotation;
+        EXPECT_EQ(name == "ids" ? 2u : 1u, annotation->expr.size()) << annotation;
+    });
+    // Those of the program and @name("standard_metadata") in v1model.p4
+    EXPECT_EQ(9u, count);
+}
+
+}  // namespace Test
@@ -0,0 +1,178 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/json_parser.h"
+
+namespace Test {
+
+namespace {
+
+/// Action localization gives t1 and t2 their own copies of forward and
+/// NoAction; the two checksums compute the same calculation; the clone and
+/// the resubmit both preserve an empty field list.
+const char* program = R"(#include <core.p4>
+#include <v1model.p4>
+
+header Header { bit<8> a; bit<16> b; bit<8> c; }
+struct Headers { Header h; }
+struct Metadata { }
+
+parser parse(packet_in p, out Headers h, inout Metadata m, inout standard_metadata_t sm) {
+    state start { p.extract(h.h); transition accept; }
+}
+control verifyChecksum(inout Headers h, inout Metadata m) {
+    apply { verify_checksum(true, { h.h.a, h.h.c }, h.h.b, HashAlgorithm.csum16); }
+}
+control computeChecksum(inout Headers h, inout Metadata m) {
+    apply { update_checksum(true, { h.h.a, h.h.c }, h.h.b, HashAlgorithm.csum16); }
+}
+control deparse(packet_out p, in Headers h) { apply { p.emit(h.h); } }
+
+control ingress(inout Headers h, inout Metadata m, inout standard_metadata_t sm) {
+    action forward(bit<9> port) { sm.egress_spec = port; }
+    action copy() { clone(CloneType.I2E, 32w5); }
+    action again() { resubmit_preserving_field_list(1); }
+    table t1 {
+        key = { h.h.a : exact; }
+        actions = { forward; copy; NoAction; }
+        default_action = NoAction;
+    }
+    table t2 {
+        key = { h.h.c : exact; }
+        actions = { forward; again; NoAction; }
+        default_action = NoAction;
+    }
+    apply { t1.apply(); t2.apply(); }
+}
+control egress(inout Headers h, inout Metadata m, inout standard_metadata_t sm) { apply { } }
+
+V1Switch(parse(), verifyChecksum(), ingress(), egress(), computeChecksum(), deparse()) main;
+)";
+
+const JsonVector* arrayField(const JsonData* object, const char* name) {
+    auto result = object->to<JsonObject>()->at(name)->to<JsonVector>();
+    EXPECT_TRUE(result != nullptr) << name;
+    return result;
+}
+
+std::string stringField(const JsonData* object, const char* name) {
+    return *object->to<JsonObject>()->at(name)->to<JsonString>();
+}
+
+int numberField(const JsonData* object, const char* name) {
+    return *object->to<JsonObject>()->at(name)->to<JsonNumber>();
+}
+
+/// @return the elements of the array @field of @json with the given @name.
+std::vector<const JsonData*> named(const JsonData* json, const char* field, const char* name) {
+    std::vector<const JsonData*> result;
+    for (auto element : *arrayField(json, field)) {
+        if (stringField(element, "name") == name)
+            result.push_back(element);
+    }
+    return result;
+}
+
+/// @return the primitive of an action of @json with the given @op.
+const JsonData* primitive(const JsonData* json, const char* op) {
+    for (auto action : *arrayField(json, "actions")) {
+        for (auto primitive : *arrayField(action, "primitives")) {
+            if (stringField(primitive, "op") == op)
+                return primitive;
+        }
+    }
+    return nullptr;
+}
+
+/// @return the field list id passed as the parameter @index of @primitive.
+int fieldListParameter(const JsonData* primitive, size_t index) {
+    auto parameter = arrayField(primitive, "parameters")->at(index);
+    EXPECT_EQ("hexstr", stringField(parameter, "type"));
+    return std::stoi(stringField(parameter, "value"), nullptr, 16);
+}
+
+}  // namespace
+
+/// Compiles a program with identical actions, calculations and field
+/// lists with p4c-bm2-ss, and checks that each is emitted once and that
+/// all the uses reference the one emitted.
+class BMv2JsonSharing : public P4CTestWithTempDir {};
+
+TEST_F(BMv2JsonSharing, SharedObjects) {
+    writeFile(dir + "/prog.p4", program);
+    std::string command = "./p4c-bm2-ss -o " + dir + "/prog.json " + dir + "/prog.p4";
+    ASSERT_EQ(0, system(command.c_str()));
+
+    std::ifstream in(dir + "/prog.json");
+    JsonData* json = nullptr;
+    in >> json;
+    ASSERT_TRUE(json != nullptr && json->is<JsonObject>());
+
+    // One forward and one NoAction, used by both tables
+    auto forward = named(json, "actions", "ingress.forward");
+    ASSERT_EQ(1u, forward.size());
+    auto noAction = named(json, "actions", "NoAction");
+    ASSERT_EQ(1u, noAction.size());
+    std::vector<const JsonData*> tables;
+    for (auto pipeline : *arrayField(json, "pipelines")) {
+        for (auto table : *arrayField(pipeline, "tables")) {
+            auto name = stringField(table, "name");
+            if (name == "ingress.t1" || name == "ingress.t2")
+                tables.push_back(table);
+        }
+    }
+    ASSERT_EQ(2u, tables.size());
+    for (auto table : tables) {
+        std::vector<int> ids;
+        for (auto id : *arrayField(table, "action_ids"))
+            ids.push_back(*id->to<JsonNumber>());
+        EXPECT_EQ(3u, ids.size());
+        for (auto action : { forward[0], noAction[0] })
+            EXPECT_NE(ids.end(), std::find(ids.begin(), ids.end(), numberField(action, "id")));
+        auto defaultAction = table->to<JsonObject>()->at("default_entry");
+        EXPECT_EQ(numberField(noAction[0], "id"), numberField(defaultAction, "action_id"));
+    }
+
+    // One calculation, used by both checksums
+    auto calculations = arrayField(json, "calculations");
+    ASSERT_EQ(1u, calculations->size());
+    auto calculation = stringField(calculations->at(0), "name");
+    auto checksums = arrayField(json, "checksums");
+    ASSERT_EQ(2u, checksums->size());
+    for (auto checksum : *checksums)
+        EXPECT_EQ(calculation, stringField(checksum, "calculation"));
+
+    // One empty field list, preserved by the clone and the resubmit
+    auto fieldLists = arrayField(json, "field_lists");
+    ASSERT_EQ(1u, fieldLists->size());
+    EXPECT_EQ(0u, arrayField(fieldLists->at(0), "elements")->size());
+    auto id = numberField(fieldLists->at(0), "id");
+    auto clone = primitive(json, "clone_ingress_pkt_to_egress");
+    ASSERT_TRUE(clone != nullptr);
+    EXPECT_EQ(id, fieldListParameter(clone, 1));
+    auto resubmit = primitive(json, "resubmit");
+    ASSERT_TRUE(resubmit != nullptr);
+    EXPECT_EQ(id, fieldListParameter(resubmit, 0));
+}
+
+}  // namespace Test
@@ -0,0 +1,111 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <string>
+
+#include "env.h"
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/common/builtinPreprocessor.h"
+
+namespace Test {
+
+namespace {
+
+/// The include path of the compiler, relative to the build folder.
+const char* includePath = " -Ip4include -Ip4include/bmv2";
+
+/// @return the output of the preprocessor the compiler runs without
+/// --builtin-preprocessor on @file, as in ParserOptions::preprocess.
+std::string preprocess(const std::string& file, const std::string& arguments) {
+#ifdef __clang__
+    std::string command = "cc -E -x c -Wno-comment";
+#else
+    std::string command = "cpp";
+#endif
+    command += " -C -undef -nostdinc -x assembler-with-cpp " + arguments + " " + file;
+    FILE* in = popen(command.c_str(), "r");
+    EXPECT_TRUE(in != nullptr);
+    if (in == nullptr)
+        return "";
+    std::string output;
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        output.append(buffer, size);
+    EXPECT_EQ(0, pclose(in)) << command;
+    return output;
+}
+
+}  // namespace
+
+/// Compares the built-in preprocessor with cpp.
+class BuiltinPreprocessor : public P4CTestWithTempDir {
+ protected:
+    /// Checks that both preprocessors give the same output for @file.
+    void compare(const std::string& file, const std::string& arguments = includePath) {
+        std::string output;
+        EXPECT_TRUE(P4::BuiltinPreprocessor::run(file.c_str(), arguments.c_str(), output))
+            << file;
+        EXPECT_EQ(preprocess(file, arguments), output) << file;
+    }
+};
+
+TEST_F(BuiltinPreprocessor, ArchitectureIncludes) {
+    if (!P4::BuiltinPreprocessor::available())
+        return;
+    for (auto file : { "core.p4", "v1model.p4", "pna.p4", "ebpf_model.p4", "ubpf_model.p4",
+                       "xdp_model.p4", "bmv2/psa.p4" })
+        compare(std::string("p4include/") + file);
+}
+
+TEST_F(BuiltinPreprocessor, Samples) {
+    if (!P4::BuiltinPreprocessor::available())
+        return;
+    // Programs with include guards, macros, #ifdef and architecture
+    // version definitions
+    for (auto file : { "arith-skeleton.p4", "control-hs-index-test1.p4",
+                       "header-stack-ops-bmv2.p4", "action_fwd_ubpf.p4",
+                       "hash-extern-bmv2.p4" }) {
+        compare(std::string(sourcePath) + "testdata/p4_16_samples/" + file);
+        // The second run reads the includes the first run mapped
+        compare(std::string(sourcePath) + "testdata/p4_16_samples/" + file);
+    }
+}
+
+TEST_F(BuiltinPreprocessor, ChangedIncludes) {
+    if (!P4::BuiltinPreprocessor::available())
+        return;
+    std::string arguments = " -I" + dir + "/include";
+    ASSERT_EQ(0, mkdir((dir + "/include").c_str(), 0700));
+    writeFile(dir + "/prog.p4", "#include <defs.p4>\nconst bit<8> x = VALUE;\n");
+
+    // The file in the include path stays mapped; a new version of it, and
+    // a file which replaces it, are read again.
+    for (auto command : { "echo '#define VALUE 1' > ", "echo '#define VALUE 22' > ",
+                          "echo '#define VALUE 3' > tmp && mv tmp " }) {
+        ASSERT_EQ(0, system(("cd " + dir + "/include && " + command + "defs.p4").c_str()));
+        compare(dir + "/prog.p4", arguments);
+    }
+    // So is the main file, which is not in the include path
+    writeFile(dir + "/prog.p4", "#include <defs.p4>\nconst bit<16> y = VALUE;\n");
+    compare(dir + "/prog.p4", arguments);
+}
+
+}  // namespace Test
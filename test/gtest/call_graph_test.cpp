@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "gtest/gtest.h"
 #include "frontends/p4/callGraph.h"
+#include "lib/stringify.h"
 
 namespace Test {
 
@@ -52,4 +53,25 @@ TEST(CallGraph, Acyclic) {
     EXPECT_EQ('a', sorted.at(2));
 }
 
+TEST(CallGraph, LongCycle) {
+    P4::CallGraph<cstring> cycle("cycle");
+    // 0->1->...->n->0, deeper than a recursive search could go
+    const unsigned n = 200000;
+    for (unsigned i = 0; i < n; i++)
+        cycle.calls(Util::toString(i), Util::toString(i + 1));
+    cycle.calls(Util::toString(n), "0");
+
+    std::vector<cstring> sorted;
+    EXPECT_TRUE(cycle.sort(sorted));
+    EXPECT_EQ(n + 1, sorted.size());
+
+    // removing a node breaks the cycle, and all the edges to it
+    cycle.calls("1", "2");
+    cycle.remove("2");
+    EXPECT_FALSE(cycle.isCaller("1"));
+    sorted.clear();
+    EXPECT_FALSE(cycle.sort(sorted));
+    EXPECT_EQ(n, sorted.size());
+}
+
 }  // namespace Test
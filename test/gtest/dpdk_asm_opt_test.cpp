@@ -0,0 +1,411 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+#include "backends/dpdk/dpdkAsmOpt.h"
+#include "backends/dpdk/dpdkProgramStructure.h"
+
+namespace Test {
+
+namespace {
+
+const IR::Member *field(cstring name) {
+    return new IR::Member(new IR::PathExpression("m"), name);
+}
+
+const IR::Member *headerField(cstring name) {
+    return new IR::Member(new IR::PathExpression("h.ethernet"), name);
+}
+
+/// Builds a DPDK assembly program: the metadata struct, the tables, the
+/// actions and the instructions of the apply block.
+struct AsmProgram {
+    IR::IndexedVector<IR::StructField> fields;
+    IR::IndexedVector<IR::DpdkAction> actions;
+    IR::IndexedVector<IR::DpdkTable> tables;
+    IR::IndexedVector<IR::DpdkAsmStatement> apply;
+
+    AsmProgram &metadata(std::vector<cstring> names, int width = 32) {
+        for (auto name : names)
+            fields.push_back(new IR::StructField(name, IR::Type_Bits::get(width)));
+        return *this;
+    }
+
+    /// Adds a table matching the @key fields (metadata fields, or header
+    /// fields for names starting with "h.") and running @actionNames.
+    AsmProgram &table(cstring name, std::vector<cstring> key,
+                      std::vector<cstring> actionNames) {
+        auto keys = new IR::Key(IR::Vector<IR::KeyElement>());
+        for (auto k : key) {
+            auto e = k.startsWith("h.") ? headerField(k.substr(2)) : field(k);
+            keys->push_back(new IR::KeyElement(e, new IR::PathExpression("exact")));
+        }
+        auto list = new IR::ActionList(IR::IndexedVector<IR::ActionListElement>());
+        for (auto a : actionNames)
+            list->push_back(new IR::ActionListElement(
+                new IR::MethodCallExpression(new IR::PathExpression(a))));
+        tables.push_back(new IR::DpdkTable(name, keys, list,
+            new IR::MethodCallExpression(new IR::PathExpression(actionNames.back())),
+            new IR::TableProperties()));
+        return *this;
+    }
+
+    AsmProgram &action(cstring name, IR::IndexedVector<IR::DpdkAsmStatement> statements) {
+        actions.push_back(new IR::DpdkAction(statements, name, IR::ParameterList()));
+        return *this;
+    }
+
+    AsmProgram &instructions(IR::IndexedVector<IR::DpdkAsmStatement> statements) {
+        apply.append(statements);
+        return *this;
+    }
+
+    const IR::DpdkAsmProgram *build() const {
+        auto annotations = new IR::Annotations({new IR::Annotation(IR::ID("__metadata__"), {})});
+        auto metadata = new IR::DpdkStructType(IR::ID("main_metadata_t"), annotations, fields);
+        return new IR::DpdkAsmProgram({}, {metadata}, {}, actions, tables, {}, {},
+                                      {new IR::DpdkListStatement(apply)}, {});
+    }
+};
+
+const IR::DpdkStructType *metadataOf(const IR::Node *program) {
+    return program->to<IR::DpdkAsmProgram>()->structType.at(0);
+}
+
+/// @return the metadata struct of @program as written in the .spec file.
+std::string metadataSpec(const IR::Node *program) {
+    std::stringstream out;
+    metadataOf(program)->toSpec(out);
+    return out.str();
+}
+
+/// @return the metadata struct a .spec file declares with @names, in this
+/// order.
+std::string expectedSpec(std::vector<const char *> names, int width = 32) {
+    std::stringstream out;
+    out << "struct main_metadata_t {" << std::endl;
+    for (auto name : names)
+        out << "\tbit<" << width << "> " << name << std::endl;
+    out << "}" << std::endl << "metadata instanceof main_metadata_t" << std::endl;
+    return out.str();
+}
+
+/// @return the instructions of @statements as written in the .spec file.
+std::vector<std::string> spec(const IR::IndexedVector<IR::DpdkAsmStatement> &statements) {
+    std::vector<std::string> result;
+    for (auto s : statements) {
+        std::stringstream out;
+        s->toSpec(out);
+        result.push_back(out.str());
+    }
+    return result;
+}
+
+/// @return the instructions of the apply block of @program.
+std::vector<std::string> applySpec(const IR::Node *program) {
+    auto list = program->to<IR::DpdkAsmProgram>()->statements.at(0);
+    return spec(list->to<IR::DpdkListStatement>()->statements);
+}
+
+/// @return the instructions of action @name of @program.
+std::vector<std::string> actionSpec(const IR::Node *program, cstring name) {
+    for (auto a : program->to<IR::DpdkAsmProgram>()->actions) {
+        if (a->name == name)
+            return spec(a->statements);
+    }
+    return {};
+}
+
+const IR::DpdkMovStatement *mov(cstring dst, const IR::Expression *src) {
+    return new IR::DpdkMovStatement(field(dst), src);
+}
+
+const IR::DpdkMovStatement *mov(cstring dst, cstring src) {
+    return mov(dst, field(src));
+}
+
+const IR::DpdkMovStatement *mov(cstring dst, int value) {
+    return mov(dst, new IR::Constant(value));
+}
+
+const IR::DpdkAddStatement *add(cstring dst, cstring src) {
+    return new IR::DpdkAddStatement(field(dst), field(dst), field(src));
+}
+
+/// A program structure where @names hold local variables.
+const DpdkProgramStructure *locals(std::vector<cstring> names) {
+    auto structure = new DpdkProgramStructure();
+    for (auto name : names)
+        structure->local_variable_fields.insert(name);
+    return structure;
+}
+
+}  // namespace
+
+class DpdkAsmOpt : public P4CTest { };
+
+TEST_F(DpdkAsmOpt, ShareSlotsDisjoint) {
+    // t1 is dead when t2 is written, so they share t1's storage.
+    auto program = AsmProgram()
+        .metadata({"t1", "t2", "out"})
+        .instructions({mov("t1", 1), mov("out", "t1"), mov("t2", 2), add("out", "t2")})
+        .build();
+    DPDK::ShareMetadataSlots share(locals({"t1", "t2"}));
+    auto result = program->apply(share);
+    EXPECT_EQ(expectedSpec({"t1", "out"}), metadataSpec(result));
+    std::vector<std::string> expected = {
+        "mov m.t1 0x1", "mov m.out m.t1", "mov m.t1 0x2", "add m.out m.t1" };
+    EXPECT_EQ(expected, applySpec(result));
+    EXPECT_EQ(4u, share.savedBytes());
+}
+
+TEST_F(DpdkAsmOpt, ShareSlotsKeepsSeparateFields) {
+    // Overlapping live ranges, other widths, fields which are not local
+    // variables and table keys keep their own storage.
+    auto program = AsmProgram()
+        .metadata({"t1", "t2", "out", "k"})
+        .metadata({"t3"}, 16)
+        .table("t", {"k"}, {"NoAction"})
+        .instructions({mov("t1", 1), mov("t2", 2), add("t1", "t2"), mov("out", "t1"),
+                       mov("t3", 3), mov("k", 4), new IR::DpdkApplyStatement("t"),
+                       mov("t2", "t3"), mov("out", 5)})
+        .build();
+    DPDK::ShareMetadataSlots share(locals({"t1", "t2", "t3", "k"}));
+    auto result = program->apply(share);
+    EXPECT_EQ(metadataSpec(program), metadataSpec(result));
+    EXPECT_EQ(applySpec(program), applySpec(result));
+    EXPECT_EQ(0u, share.savedBytes());
+}
+
+TEST_F(DpdkAsmOpt, ShareSlotsAcrossTableApply) {
+    // t1 is live across the apply of t, whose action writes t2.
+    auto program = AsmProgram()
+        .metadata({"t1", "t2", "out"})
+        .table("t", {}, {"a", "NoAction"})
+        .action("a", {mov("t2", 2), mov("out", "t2")})
+        .instructions({mov("t1", 1), new IR::DpdkApplyStatement("t"), add("out", "t1")})
+        .build();
+    DPDK::ShareMetadataSlots share(locals({"t1", "t2"}));
+    auto result = program->apply(share);
+    EXPECT_EQ(metadataSpec(program), metadataSpec(result));
+    EXPECT_EQ(0u, share.savedBytes());
+
+    // t1 is read by the action; it is dead after the apply, when t2 is
+    // written.
+    program = AsmProgram()
+        .metadata({"t1", "t2", "out"})
+        .table("t", {}, {"a", "NoAction"})
+        .action("a", {mov("out", "t1")})
+        .instructions({mov("t1", 1), new IR::DpdkApplyStatement("t"),
+                       mov("t2", 2), add("out", "t2")})
+        .build();
+    result = program->apply(share);
+    EXPECT_EQ(expectedSpec({"t1", "out"}), metadataSpec(result));
+    std::vector<std::string> expected = {
+        "mov m.t1 0x1", "table t", "mov m.t1 0x2", "add m.out m.t1" };
+    EXPECT_EQ(expected, applySpec(result));
+    EXPECT_EQ(4u, share.savedBytes());
+}
+
+TEST_F(DpdkAsmOpt, ShareSlotsAcrossActions) {
+    // t1 and t2 are only used inside actions a and b, so they can share
+    // storage. t3 is written by a and read after the apply, so it is live
+    // when either action writes t1 or t2.
+    auto program = AsmProgram()
+        .metadata({"t1", "t2", "t3", "out"})
+        .table("t", {}, {"a", "b"})
+        .action("a", {mov("t3", 3), mov("t1", 1), mov("out", "t1")})
+        .action("b", {mov("t2", 2), mov("out", "t2")})
+        .instructions({new IR::DpdkApplyStatement("t"), add("out", "t3")})
+        .build();
+    DPDK::ShareMetadataSlots share(locals({"t1", "t2", "t3"}));
+    auto result = program->apply(share);
+    EXPECT_EQ(expectedSpec({"t1", "t3", "out"}), metadataSpec(result));
+    EXPECT_EQ(actionSpec(program, "a"), actionSpec(result, "a"));
+    std::vector<std::string> expected = { "mov m.t1 0x2", "mov m.out m.t1" };
+    EXPECT_EQ(expected, actionSpec(result, "b"));
+    EXPECT_EQ(4u, share.savedBytes());
+}
+
+TEST_F(DpdkAsmOpt, ShareSlotsRemovesMoves) {
+    // t2 is a copy of t1, which is dead afterwards: they share storage and
+    // the copy goes away.
+    auto program = AsmProgram()
+        .metadata({"t1", "t2", "out"})
+        .action("a", {mov("t1", 1), mov("t2", "t1"), add("t2", "t2"), mov("out", "t2")})
+        .build();
+    DPDK::ShareMetadataSlots share(locals({"t1", "t2"}));
+    auto result = program->apply(share);
+    EXPECT_EQ(expectedSpec({"t1", "out"}), metadataSpec(result));
+    std::vector<std::string> expected = { "mov m.t1 0x1", "add m.t1 m.t1", "mov m.out m.t1" };
+    EXPECT_EQ(expected, actionSpec(result, "a"));
+    EXPECT_EQ(4u, share.savedBytes());
+}
+
+TEST_F(DpdkAsmOpt, DataflowJoin) {
+    // x holds 1 on both paths to L2, y holds different values.
+    auto program = AsmProgram()
+        .metadata({"sel", "x", "y", "out"})
+        .instructions({new IR::DpdkJmpEqualStatement("L1", field("sel"), new IR::Constant(0)),
+                       mov("x", 1), mov("y", 2), new IR::DpdkJmpLabelStatement("L2"),
+                       new IR::DpdkLabelStatement("L1"), mov("x", 1), mov("y", 3),
+                       new IR::DpdkLabelStatement("L2"), mov("out", "x"), add("out", "y")})
+        .build();
+    auto result = program->apply(DPDK::DpdkDataflowOptimization(locals({})));
+    std::vector<std::string> expected = {
+        "jmpeq L1 m.sel 0x0", "mov m.x 0x1", "mov m.y 0x2", "jmp L2",
+        "L1 :", "mov m.x 0x1", "mov m.y 0x3",
+        "L2 :", "mov m.out 0x1", "add m.out m.y" };
+    EXPECT_EQ(expected, applySpec(result));
+}
+
+TEST_F(DpdkAsmOpt, DataflowTableApply) {
+    // The action run by t may write x.
+    auto program = AsmProgram()
+        .metadata({"x", "out"})
+        .table("t", {}, {"a", "NoAction"})
+        .action("a", {mov("x", 5)})
+        .instructions({mov("x", 1), mov("out", "x"), new IR::DpdkApplyStatement("t"),
+                       add("out", "x")})
+        .build();
+    auto result = program->apply(DPDK::DpdkDataflowOptimization(locals({})));
+    std::vector<std::string> expected = {
+        "mov m.x 0x1", "mov m.out 0x1", "table t", "add m.out m.x" };
+    EXPECT_EQ(expected, applySpec(result));
+}
+
+TEST_F(DpdkAsmOpt, DataflowJumpOperands) {
+    // The first operand of a conditional jump may become another field, but
+    // never an immediate.
+    auto program = AsmProgram()
+        .metadata({"x", "y", "z", "out"})
+        .instructions({mov("x", 1), mov("y", "z"),
+                       new IR::DpdkJmpEqualStatement("L1", field("x"), field("y")),
+                       new IR::DpdkJmpLessStatement("L1", field("y"), field("x")),
+                       mov("out", 2), new IR::DpdkLabelStatement("L1"), mov("out", "x")})
+        .build();
+    auto result = program->apply(DPDK::DpdkDataflowOptimization(locals({})));
+    std::vector<std::string> expected = {
+        "mov m.x 0x1", "mov m.y m.z", "jmpeq L1 m.x m.z", "jmplt L1 m.z 0x1",
+        "mov m.out 0x2", "L1 :", "mov m.out 0x1" };
+    EXPECT_EQ(expected, applySpec(result));
+}
+
+TEST_F(DpdkAsmOpt, DataflowDeadStores) {
+    // Once its value is propagated t1 is never read, so its stores go away.
+    // t2 is read by the action of t. out is not a local variable and may be
+    // read after the pipeline, so its first store stays although it is
+    // overwritten.
+    auto program = AsmProgram()
+        .metadata({"t1", "t2", "out"})
+        .table("t", {}, {"a", "NoAction"})
+        .action("a", {add("out", "t2")})
+        .instructions({mov("t1", 1), mov("out", 2), mov("t1", 3), mov("out", "t1"),
+                       mov("t2", 7), new IR::DpdkApplyStatement("t")})
+        .build();
+    auto result = program->apply(DPDK::DpdkDataflowOptimization(locals({"t1", "t2"})));
+    std::vector<std::string> expected = {
+        "mov m.out 0x2", "mov m.out 0x3", "mov m.t2 0x7", "table t" };
+    EXPECT_EQ(expected, applySpec(result));
+    EXPECT_EQ(actionSpec(program, "a"), actionSpec(result, "a"));
+}
+
+TEST_F(DpdkAsmOpt, KeyAwareLayout) {
+    auto program = AsmProgram()
+        .metadata({"a", "x", "b", "y", "c"})
+        .table("t", {"a", "b", "c"}, {"NoAction"})
+        .build();
+    auto result = program->apply(DPDK::LayoutMetadataForKeys());
+    EXPECT_EQ(expectedSpec({"a", "b", "c", "x", "y"}), metadataSpec(result));
+
+    // The key shrinks from the 20 bytes between a and c to its 12 bytes
+    std::vector<cstring> key = {"a", "b", "c"};
+    EXPECT_EQ(20u, DPDK::LayoutMetadataForKeys::keySize(metadataOf(program)->fields, key));
+    EXPECT_EQ(12u, DPDK::LayoutMetadataForKeys::keySize(metadataOf(result)->fields, key));
+}
+
+TEST_F(DpdkAsmOpt, KeyAwareLayoutKeyOrder) {
+    // Key fields are stored in key order, where the first of them was.
+    auto program = AsmProgram()
+        .metadata({"x", "a", "y", "c", "b"})
+        .table("t", {"c", "a"}, {"NoAction"})
+        .table("u", {"b", "y"}, {"NoAction"})
+        .build();
+    auto result = program->apply(DPDK::LayoutMetadataForKeys());
+    EXPECT_EQ(expectedSpec({"x", "c", "a", "b", "y"}), metadataSpec(result));
+}
+
+TEST_F(DpdkAsmOpt, KeyAwareLayoutUnchanged) {
+    // Keys which are already contiguous, and keys with header fields, do not
+    // change the layout.
+    auto program = AsmProgram()
+        .metadata({"a", "b", "x", "y"})
+        .table("t", {"a", "b"}, {"NoAction"})
+        .table("u", {"h.dst", "y"}, {"NoAction"})
+        .build();
+    auto result = program->apply(DPDK::LayoutMetadataForKeys());
+    EXPECT_EQ(expectedSpec({"a", "b", "x", "y"}), metadataSpec(result));
+}
+
+/// The fields of table t's key are accessed 1 and 2 times, "other" 1.5
+/// times, "hot" once and "cold" never.
+AsmProgram accessedFields() {
+    AsmProgram program;
+    program.metadata({"cold", "k1", "hot", "other", "k2"})
+        .table("t", {"k1", "k2"}, {"a", "NoAction"})
+        .action("a", {new IR::DpdkMovStatement(field("other"), new IR::Constant(5))})
+        .instructions({new IR::DpdkMovStatement(field("hot"), new IR::Constant(1)),
+                       new IR::DpdkMovStatement(field("other"), field("k2")),
+                       new IR::DpdkApplyStatement("t")});
+    return program;
+}
+
+TEST_F(DpdkAsmOpt, HotFirstLayout) {
+    // The key fields stay together, with the weight of k2. "other" is read
+    // once in the apply block and once in one of the two actions of t.
+    auto result = accessedFields().build()->apply(DPDK::LayoutMetadataByAccess(nullptr));
+    EXPECT_EQ(expectedSpec({"k1", "k2", "other", "hot", "cold"}), metadataSpec(result));
+}
+
+TEST_F(DpdkAsmOpt, HotFirstLayoutProfile) {
+    char name[] = "/tmp/p4c-profile-XXXXXX";
+    int fd = mkstemp(name);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    {
+        std::ofstream out(name);
+        out << "# field count\nhot 100\ncold 50\n";
+    }
+
+    // Only the profile counts: the fields it does not list are ordered by
+    // first access.
+    auto result = accessedFields().build()->apply(DPDK::LayoutMetadataByAccess(name));
+    unlink(name);
+    EXPECT_EQ(0u, ::errorCount());
+    EXPECT_EQ(expectedSpec({"hot", "cold", "k1", "k2", "other"}), metadataSpec(result));
+}
+
+}  // namespace Test
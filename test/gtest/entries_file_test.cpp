@@ -0,0 +1,236 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include "control-plane/p4/v1/p4runtime.pb.h"
+#include "gtest/gtest.h"
+#pragma GCC diagnostic pop
+
+#include "control-plane/p4RuntimeSerializer.h"
+#include "helpers.h"
+#include "ir/ir.h"
+#include "ir/json_parser.h"
+#include "lib/error.h"
+
+namespace p4v1 = ::p4::v1;
+
+namespace Test {
+
+namespace {
+
+/// The program used by the tests: table ingress.t takes its entries from
+/// @entriesFile.
+std::string programBody(const std::string& entriesFile) {
+    return v1modelProgram(R"(
+    action drop() { mark_to_drop(sm); }
+    action forward(bit<9> port) { sm.egress_spec = port; }
+
+    @entries_file(")" + entriesFile + R"(")
+    table t {
+        key = { h.h.a : exact; h.h.b : ternary; }
+        actions = { drop; forward; }
+        default_action = drop;
+    }
+    apply { t.apply(); })");
+}
+
+const char* threeEntries =
+    "# a  b                => action\n"
+    "1    0x1100 &&& 0xff00 => forward(1)\n"
+    "2    _                 => forward(2)\n"
+    "3    0x0042            => drop\n";
+
+}  // namespace
+
+class EntriesFile : public P4CTestWithTempDir {
+ protected:
+    /// Runs the frontend and the P4Runtime serializer on the program, as if
+    /// it was read from @sourceFile, in a compile context of its own like a
+    /// compile server request. @return the entries, or nullptr on errors.
+    const p4v1::WriteRequest* compile(const std::string& entriesFile,
+                                      const std::string& sourceFile = "entries.p4") {
+        AutoCompileContext autoContext(new GTestContext(GTestContext::get()));
+        auto source = P4CTestEnvironment::get()->v1Model() +
+            "#line 1 \"" + sourceFile + "\"\n" + programBody(entriesFile);
+        auto test = FrontendTestCase::create(source);
+        if (!test)
+            return nullptr;
+        auto p4runtime = P4::generateP4Runtime(test->program, "v1model");
+        if (::errorCount() > 0)
+            return nullptr;
+        return p4runtime.entries;
+    }
+};
+
+TEST_F(EntriesFile, P4Runtime) {
+    auto file = dir + "/t.entries";
+    writeFile(file, threeEntries);
+    auto entries = compile(file);
+    ASSERT_TRUE(entries != nullptr);
+    ASSERT_EQ(3, entries->updates_size());
+
+    int priority = 4;
+    for (auto& update : entries->updates()) {
+        EXPECT_EQ(p4v1::Update::INSERT, update.type());
+        // Earlier entries win
+        EXPECT_LT(update.entity().table_entry().priority(), priority);
+        priority = update.entity().table_entry().priority();
+    }
+
+    auto& first = entries->updates(0).entity().table_entry();
+    ASSERT_EQ(2, first.match_size());
+    EXPECT_EQ("\x01", first.match(0).exact().value());
+    EXPECT_EQ(std::string("\x11\x00", 2), first.match(1).ternary().value());
+    EXPECT_EQ(std::string("\xff\x00", 2), first.match(1).ternary().mask());
+    ASSERT_EQ(1, first.action().action().params_size());
+    EXPECT_EQ(std::string("\x00\x01", 2), first.action().action().params(0).value());
+
+    // The don't care key is omitted
+    auto& second = entries->updates(1).entity().table_entry();
+    ASSERT_EQ(1, second.match_size());
+    EXPECT_EQ("\x02", second.match(0).exact().value());
+
+    // An exact value for a ternary key matches all the bits
+    auto& third = entries->updates(2).entity().table_entry();
+    ASSERT_EQ(2, third.match_size());
+    EXPECT_EQ(std::string("\xff\xff"), third.match(1).ternary().mask());
+    EXPECT_EQ(0, third.action().action().params_size());
+    EXPECT_NE(first.action().action().action_id(), third.action().action().action_id());
+}
+
+TEST_F(EntriesFile, ChangedFile) {
+    // Compilations in one process, as in a compile server, see the current
+    // contents of the file.
+    auto file = dir + "/t.entries";
+    writeFile(file, threeEntries);
+    auto entries = compile(file);
+    ASSERT_TRUE(entries != nullptr);
+    EXPECT_EQ(3, entries->updates_size());
+
+    writeFile(file, "4 0x0001 => forward(4)\n");
+    entries = compile(file);
+    ASSERT_TRUE(entries != nullptr);
+    ASSERT_EQ(1, entries->updates_size());
+    EXPECT_EQ("\x04", entries->updates(0).entity().table_entry().match(0).exact().value());
+}
+
+TEST_F(EntriesFile, InvalidFileReportedEachTime) {
+    auto file = dir + "/t.entries";
+    // 0x100 does not fit in the 8 bits of the first key
+    writeFile(file, "0x100 0x0001 => forward(4)\n");
+    EXPECT_TRUE(compile(file) == nullptr);
+    EXPECT_TRUE(compile(file) == nullptr);
+
+    writeFile(file, threeEntries);
+    auto entries = compile(file);
+    ASSERT_TRUE(entries != nullptr);
+    EXPECT_EQ(3, entries->updates_size());
+}
+
+TEST_F(EntriesFile, RelativeToSource) {
+    // The same relative name in two folders are two different files
+    for (auto folder : { "one", "two" }) {
+        auto sub = dir + "/" + folder;
+        ASSERT_EQ(0, mkdir(sub.c_str(), 0700));
+    }
+    writeFile(dir + "/one/t.entries", threeEntries);
+    writeFile(dir + "/two/t.entries", "4 0x0001 => forward(4)\n");
+    // A file with the same name in the working folder, as a compile server
+    // sees it after changing to the folder of a client, does not win.
+    writeFile(dir + "/t.entries", "5 0x0002 => drop\n6 0x0003 => drop\n");
+    char* cwd = getcwd(nullptr, 0);
+    ASSERT_TRUE(cwd != nullptr);
+    ASSERT_EQ(0, chdir(dir.c_str()));
+
+    auto one = compile("t.entries", dir + "/one/entries.p4");
+    auto two = compile("t.entries", dir + "/two/entries.p4");
+    // Without a folder, the name is relative to the working folder
+    auto here = compile("t.entries", "entries.p4");
+    EXPECT_EQ(0, chdir(cwd));
+    free(cwd);
+
+    ASSERT_TRUE(one != nullptr);
+    EXPECT_EQ(3, one->updates_size());
+    ASSERT_TRUE(two != nullptr);
+    EXPECT_EQ(1, two->updates_size());
+    ASSERT_TRUE(here != nullptr);
+    EXPECT_EQ(2, here->updates_size());
+}
+
+TEST_F(EntriesFile, BMv2Json) {
+    writeFile(dir + "/t.entries", threeEntries);
+    writeFile(dir + "/entries.p4",
+              "#include <core.p4>\n#include <v1model.p4>\n" + programBody("t.entries"));
+    std::string command = "./p4c-bm2-ss -o " + dir + "/entries.json " + dir + "/entries.p4";
+    ASSERT_EQ(0, system(command.c_str()));
+
+    std::ifstream in(dir + "/entries.json");
+    JsonData* json = nullptr;
+    in >> json;
+    ASSERT_TRUE(json != nullptr && json->is<JsonObject>());
+    auto pipelines = json->to<JsonObject>()->at("pipelines")->to<JsonVector>();
+    ASSERT_TRUE(pipelines != nullptr);
+    const JsonObject* table = nullptr;
+    for (auto pipeline : *pipelines) {
+        for (auto t : *pipeline->to<JsonObject>()->at("tables")->to<JsonVector>()) {
+            auto name = t->to<JsonObject>()->at("name")->to<JsonString>();
+            if (*name == "ingress.t")
+                table = t->to<JsonObject>();
+        }
+    }
+    ASSERT_TRUE(table != nullptr);
+    EXPECT_EQ(3, int(*table->at("max_size")->to<JsonNumber>()));
+
+    auto entries = table->at("entries")->to<JsonVector>();
+    ASSERT_TRUE(entries != nullptr);
+    ASSERT_EQ(3u, entries->size());
+    int priority = 0;
+    for (auto entry : *entries) {
+        // Earlier entries win
+        auto next = int(*entry->to<JsonObject>()->at("priority")->to<JsonNumber>());
+        EXPECT_GT(next, priority);
+        priority = next;
+    }
+
+    auto keys = entries->at(0)->to<JsonObject>()->at("match_key")->to<JsonVector>();
+    ASSERT_EQ(2u, keys->size());
+    auto exact = keys->at(0)->to<JsonObject>();
+    EXPECT_EQ("exact", *exact->at("match_type")->to<JsonString>());
+    EXPECT_EQ("0x01", *exact->at("key")->to<JsonString>());
+    auto ternary = keys->at(1)->to<JsonObject>();
+    EXPECT_EQ("ternary", *ternary->at("match_type")->to<JsonString>());
+    EXPECT_EQ("0x1100", *ternary->at("key")->to<JsonString>());
+    EXPECT_EQ("0xff00", *ternary->at("mask")->to<JsonString>());
+
+    // The don't care key matches anything
+    keys = entries->at(1)->to<JsonObject>()->at("match_key")->to<JsonVector>();
+    EXPECT_EQ("0x0000", *keys->at(1)->to<JsonObject>()->at("mask")->to<JsonString>());
+
+    auto forward = entries->at(0)->to<JsonObject>()->at("action_entry")->to<JsonObject>();
+    auto drop = entries->at(2)->to<JsonObject>()->at("action_entry")->to<JsonObject>();
+    EXPECT_EQ(1u, forward->at("action_data")->to<JsonVector>()->size());
+    EXPECT_EQ(0u, drop->at("action_data")->to<JsonVector>()->size());
+    EXPECT_NE(int(*forward->at("action_id")->to<JsonNumber>()),
+              int(*drop->at("action_id")->to<JsonNumber>()));
+}
+
+}  // namespace Test
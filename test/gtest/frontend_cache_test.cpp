@@ -0,0 +1,105 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdlib.h>
+#include <sys/wait.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+
+namespace Test {
+
+namespace {
+
+/// The body of the ingress control of the test programs.
+const char* ingress = R"(
+    action forward(bit<9> port) { sm.egress_spec = port; m.kept = h.h.a; }
+    table t {
+        key = { h.h.a : exact; }
+        actions = { forward; NoAction; }
+        default_action = NoAction;
+    }
+    apply {
+        t.apply();
+        if (h.h.b == 0)
+            h.h.b = h.h.b + (bit<16>)h.h.a;
+    })";
+
+}  // namespace
+
+/// Compiles programs with p4c-bm2-ss and a front end cache, once without
+/// and once with a cache entry, and checks that both compilations produce
+/// the same outputs and diagnostics.
+class FrontEndCacheTest : public P4CTestWithTempDir {
+ protected:
+    /// Writes the test program, with @egress as the body of egress.
+    void writeProgram(const std::string& egress) {
+        writeFile(dir + "/prog.p4", "#include <core.p4>\n#include <v1model.p4>\n\n" +
+                  v1modelProgram(ingress, egress, "@field_list(0) bit<8> kept;"));
+    }
+
+    /// Compiles the program, with the JSON output in @stem.json, the
+    /// standard error in @stem.err and the passes run in @stem.stats.
+    /// @return the exit code.
+    int compile(const std::string& stem) {
+        auto out = dir + "/" + stem;
+        std::string command = "./p4c-bm2-ss --cache-dir " + dir + "/cache --pass-stats " +
+            out + ".stats -o " + out + ".json " + dir + "/prog.p4 2> " + out + ".err";
+        int status = system(command.c_str());
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    /// @return true if the compilation which wrote @stem.stats ran the front
+    /// end passes.
+    bool ranFrontEnd(const std::string& stem) {
+        return readFile(dir + "/" + stem + ".stats").find("\"in\": \"FrontEnd\"") !=
+            std::string::npos;
+    }
+};
+
+TEST_F(FrontEndCacheTest, SameOutput) {
+    writeProgram("sm.egress_spec = 3;");
+    auto cold = compile("cold");
+    ASSERT_EQ(0, cold);
+    ASSERT_TRUE(ranFrontEnd("cold"));
+    EXPECT_EQ(cold, compile("warm"));
+    EXPECT_FALSE(ranFrontEnd("warm"));
+
+    EXPECT_EQ(readFile(dir + "/cold.err"), readFile(dir + "/warm.err"));
+    // The JSON has the source information of the tables, actions and
+    // primitives.
+    auto json = readFile(dir + "/cold.json");
+    EXPECT_NE(std::string::npos, json.find("\"source_fragment\""));
+    EXPECT_EQ(json, readFile(dir + "/warm.json"));
+}
+
+TEST_F(FrontEndCacheTest, SameDiagnostics) {
+    // The front end accepts this program; the back end reports an error at
+    // the call, with its position and source fragment.
+    writeProgram("resubmit_preserving_field_list(0);");
+    auto cold = compile("cold");
+    EXPECT_NE(0, cold);
+    ASSERT_TRUE(ranFrontEnd("cold"));
+    auto errors = readFile(dir + "/cold.err");
+    EXPECT_NE(std::string::npos, errors.find("prog.p4("));
+    EXPECT_NE(std::string::npos, errors.find("resubmit_preserving_field_list(0)"));
+
+    EXPECT_EQ(cold, compile("warm"));
+    EXPECT_FALSE(ranFrontEnd("warm"));
+    EXPECT_EQ(errors, readFile(dir + "/warm.err"));
+}
+
+}  // namespace Test
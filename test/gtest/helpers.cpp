@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <stdlib.h>
+
 #include <cstdio>
 #include <fstream>
 #include <sstream>
@@ -193,4 +195,53 @@ FrontendTestCase::create(const std::string& source,
     return FrontendTestCase{program};
 }
 
+void P4CTestWithTempDir::SetUp() {
+    char name[] = "/tmp/p4c-test-XXXXXX";
+    ASSERT_TRUE(mkdtemp(name) != nullptr);
+    dir = name;
+}
+
+void P4CTestWithTempDir::TearDown() {
+    if (dir.empty())
+        return;
+    std::string command = "rm -rf " + dir;
+    EXPECT_EQ(0, system(command.c_str()));
+}
+
+std::string readFile(const std::string& name) {
+    std::ifstream in(name);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+void writeFile(const std::string& name, const std::string& contents) {
+    std::ofstream out(name);
+    out << contents;
+}
+
+std::string v1modelProgram(const std::string& ingress, const std::string& egress,
+                           const std::string& metadata) {
+    return R"(header Header { bit<8> a; bit<16> b; }
+struct Headers { Header h; }
+struct Metadata { )" + metadata + R"( }
+
+parser parse(packet_in p, out Headers h, inout Metadata m, inout standard_metadata_t sm) {
+    state start { p.extract(h.h); transition accept; }
+}
+control verifyChecksum(inout Headers h, inout Metadata m) { apply { } }
+control computeChecksum(inout Headers h, inout Metadata m) { apply { } }
+control deparse(packet_out p, in Headers h) { apply { p.emit(h.h); } }
+
+control ingress(inout Headers h, inout Metadata m, inout standard_metadata_t sm) {
+)" + ingress + R"(
+}
+control egress(inout Headers h, inout Metadata m, inout standard_metadata_t sm) {
+    apply { )" + egress + R"( }
+}
+
+V1Switch(parse(), verifyChecksum(), ingress(), egress(), computeChecksum(), deparse()) main;
+)";
+}
+
 }  // namespace Test
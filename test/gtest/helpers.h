@@ -130,6 +130,30 @@ struct FrontendTestCase {
     const IR::P4Program* program;
 };
 
+/// A test fixture with a temporary folder, @dir, which is removed with
+/// its contents after the test.
+class P4CTestWithTempDir : public P4CTest {
+ protected:
+    void SetUp() override;
+    void TearDown() override;
+
+    std::string dir;
+};
+
+/// @return the contents of the file @name.
+std::string readFile(const std::string& name);
+
+/// Replaces the contents of the file @name with @contents.
+void writeFile(const std::string& name, const std::string& contents);
+
+/// @return a v1model program, without the includes, whose parser extracts
+/// a header h with fields bit<8> a and bit<16> b and whose deparser emits
+/// it. @ingress is the body of the ingress control, @egress the body of the
+/// apply block of egress and @metadata the fields of the metadata struct.
+/// The body of ingress starts on line 13.
+std::string v1modelProgram(const std::string& ingress, const std::string& egress = "",
+                           const std::string& metadata = "");
+
 }  // namespace Test
 
 #endif /* TEST_GTEST_HELPERS_H_ */
@@ -26,6 +26,7 @@ limitations under the License.
 #include "frontends/p4/typeMap.h"
 #include "midend/convertEnums.h"
 #include "midend/replaceSelectRange.h"
+#include "midend/singleArgumentSelect.h"
 
 using namespace P4;
 
@@ -278,4 +279,40 @@ TEST_F(P4CMidend, replaceSelectRange2) {
     });
 }
 
+// The default case of a select on a list wider than any bit<> type a program
+// may declare becomes a mask of the width of the whole list.
+TEST_F(P4CMidend, singleArgumentSelectWideDefault) {
+    std::string program = P4_SOURCE(R"(
+        header H { bit<1024> a; bit<1024> b; bit<1024> c; }
+        parser p(in H h) {
+            state start {
+                transition select(h.a, h.b, h.c) {
+                    (1, 2, 3): accept;
+                    default: reject;
+                }
+            }
+        }
+    )");
+    auto pgm = P4::parseP4String(program, CompilerOptions::FrontendVersion::P4_16);
+    ASSERT_TRUE(pgm != nullptr && ::errorCount() == 0);
+
+    ReferenceMap  refMap;
+    TypeMap       typeMap;
+    PassManager passes_ = {
+        new P4::ResolveReferences(&refMap),
+        new P4::TypeInference(&refMap, &typeMap, false),
+        new P4::SingleArgumentSelect(&refMap, &typeMap)
+    };
+    auto result = pgm->apply(passes_);
+    ASSERT_TRUE(result != nullptr);
+    ASSERT_EQ(::errorCount(), 0u);
+
+    CollectRangesAndMasks collect;
+    result->apply(collect);
+    ASSERT_EQ(collect.masks.size(), 1u);
+    auto type = collect.masks.at(0)->right->type->to<IR::Type_Bits>();
+    ASSERT_TRUE(type != nullptr);
+    EXPECT_EQ(type->width_bits(), 3072);
+}
+
 }  // namespace Test
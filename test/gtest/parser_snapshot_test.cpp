@@ -0,0 +1,130 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <stdlib.h>
+
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "helpers.h"
+#include "frontends/common/parseInput.h"
+#include "ir/ir.h"
+#include "lib/error.h"
+
+namespace Test {
+
+namespace {
+
+/// The program used by the tests, with @ingress as the body of the apply
+/// block of ingress, on line 14 of prog.p4.
+std::string program(const std::string& ingress) {
+    return P4CTestEnvironment::get()->v1Model() + "#line 1 \"prog.p4\"\n" +
+        v1modelProgram("    apply {\n" + ingress + "\n    }");
+}
+
+/// Writes the position and source fragment of every node with a position.
+class Positions : public Inspector {
+    std::ostream& out;
+
+ public:
+    explicit Positions(std::ostream& out) : out(out) {}
+    bool preorder(const IR::Node* node) override {
+        if (node->srcInfo.isValid())
+            out << node->node_type_name() << " " << node->srcInfo.toPositionString()
+                << " " << node->srcInfo.toBriefSourceFragment() << std::endl;
+        return true;
+    }
+};
+
+}  // namespace
+
+/// Parses programs which start with the same architecture includes, with
+/// and without the parsed includes of the earlier programs, and checks that
+/// the nodes have the same positions and the diagnostics are the same.
+class ParserSnapshot : public P4CTest {
+ protected:
+    void TearDown() override {
+        unsetenv("P4C_16_INCLUDE_PATH");
+    }
+
+    /// Makes the includes of the test programs, which the preprocessor
+    /// reads from p4include, architecture includes or not.
+    void useSnapshots(bool use) {
+        if (use)
+            setenv("P4C_16_INCLUDE_PATH", "p4include", 1);
+        else
+            unsetenv("P4C_16_INCLUDE_PATH");
+    }
+
+    /// Parses @source in a compile context of its own, like a compile
+    /// server request. @return the positions of its nodes.
+    std::string positions(const std::string& source) {
+        AutoCompileContext autoContext(new GTestContext(GTestContext::get()));
+        auto parsed = P4::parseP4String(source, CompilerOptions::FrontendVersion::P4_16);
+        EXPECT_TRUE(parsed != nullptr);
+        EXPECT_EQ(0u, ::diagnosticCount());
+        std::stringstream out;
+        if (parsed != nullptr)
+            parsed->apply(Positions(out));
+        return out.str();
+    }
+
+    /// Runs the front end on @source in a compile context of its own.
+    /// @return the diagnostics.
+    std::string diagnostics(const std::string& source) {
+        AutoCompileContext autoContext(new GTestContext(GTestContext::get()));
+        std::stringstream out;
+        BaseCompileContext::get().errorReporter().setOutputStream(&out);
+        EXPECT_FALSE(FrontendTestCase::create(source));
+        EXPECT_NE(0u, ::errorCount());
+        return out.str();
+    }
+};
+
+TEST_F(ParserSnapshot, SamePositions) {
+    auto source = program("mark_to_drop(sm);");
+    useSnapshots(false);
+    auto expected = positions(source);
+    // The declarations of the includes have their own positions
+    EXPECT_NE(std::string::npos, expected.find("v1model.p4("));
+    EXPECT_NE(std::string::npos, expected.find("core.p4("));
+    EXPECT_NE(std::string::npos, expected.find("prog.p4(14)"));
+
+    useSnapshots(true);
+    // Once to parse the includes, once to reuse them
+    EXPECT_EQ(expected, positions(source));
+    EXPECT_EQ(expected, positions(source));
+}
+
+TEST_F(ParserSnapshot, SameDiagnostics) {
+    // A syntax error, and a type error in a call of an extern function
+    // declared in v1model.p4
+    auto syntaxError = program("mark_to_drop(sm)");
+    auto typeError = program("mark_to_drop(h);");
+    useSnapshots(false);
+    auto expectedSyntax = diagnostics(syntaxError);
+    auto expectedType = diagnostics(typeError);
+    EXPECT_NE(std::string::npos, expectedSyntax.find("prog.p4(15)"));
+    EXPECT_NE(std::string::npos, expectedType.find("prog.p4(14)"));
+
+    useSnapshots(true);
+    // A program without errors stores the parsed includes
+    EXPECT_FALSE(positions(program("mark_to_drop(sm);")).empty());
+    EXPECT_EQ(expectedSyntax, diagnostics(syntaxError));
+    EXPECT_EQ(expectedType, diagnostics(typeError));
+    EXPECT_EQ(expectedSyntax, diagnostics(syntaxError));
+}
+
+}  // namespace Test
@@ -0,0 +1,183 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "frontends/p4/typeChecking/typeSubstitution.h"
+#include "frontends/p4/typeChecking/typeSubstitutionVisitor.h"
+#include "ir/ir.h"
+#include "lib/ordered_map.h"
+
+namespace Test {
+
+namespace {
+
+/// Composition as it was done before TypeVariableSubstitution::resolve:
+/// each compose replaces the variable in all the existing bindings.
+class EagerSubstitution {
+ public:
+    ordered_map<const IR::ITypeVar*, const IR::Type*> binding;
+
+    cstring compose(const IR::ITypeVar* var, const IR::Type* substitution) {
+        P4::TypeOccursVisitor occurs(var);
+        substitution->apply(occurs);
+        if (occurs.occurs)
+            return "'%1%' cannot be replaced with '%2%' which already contains it";
+
+        auto tvs = new P4::TypeVariableSubstitution();
+        tvs->setBinding(var, substitution);
+        P4::TypeVariableSubstitutionVisitor visitor(tvs);
+        for (auto &bound : binding) {
+            auto type = bound.second->apply(visitor);
+            if (type == nullptr)
+                return "Could not replace '%1%' with '%2%'";
+            bound.second = type->to<IR::Type>();
+        }
+        binding.emplace(var, substitution);
+        return "";
+    }
+};
+
+using Binding = std::pair<const IR::ITypeVar*, const IR::Type*>;
+
+/// Composes @p bindings in order into a lazy and an eager substitution,
+/// and checks that resolveAll leaves the same types as the eager one.
+void checkSameAsEager(const std::vector<Binding>& bindings) {
+    P4::TypeVariableSubstitution lazy;
+    EagerSubstitution eager;
+    for (auto &b : bindings) {
+        EXPECT_EQ("", lazy.compose(b.first, b.second));
+        EXPECT_EQ("", eager.compose(b.first, b.second));
+    }
+    lazy.resolveAll();
+    for (auto &b : eager.binding) {
+        auto type = lazy.lookup(b.first);
+        ASSERT_TRUE(type != nullptr) << b.first->getVarName();
+        EXPECT_TRUE(type->equiv(*b.second))
+            << b.first->getVarName() << ": " << dbp(type) << " instead of " << dbp(b.second);
+    }
+}
+
+const IR::Type* tuple(std::initializer_list<const IR::Type*> types) {
+    return new IR::Type_Tuple(IR::Vector<IR::Type>(types));
+}
+
+/// <typeParameter>(in argument a) -> result
+const IR::Type_Method* method(const IR::Type_Var* typeParameter,
+                              const IR::Type* argument, const IR::Type* result) {
+    auto typeParameters = new IR::TypeParameters();
+    typeParameters->push_back(typeParameter);
+    auto parameters = new IR::ParameterList();
+    parameters->push_back(new IR::Parameter(IR::ID("a"), IR::Direction::In, argument));
+    return new IR::Type_Method(typeParameters, result, parameters, "m");
+}
+
+}  // namespace
+
+TEST(TypeVariableSubstitution, LaterVariablesInEarlierBindings) {
+    auto t = new IR::Type_Var(IR::ID("T"));
+    auto u = new IR::Type_Var(IR::ID("U"));
+    auto v = new IR::Type_Var(IR::ID("V"));
+    auto w = new IR::Type_Var(IR::ID("W"));
+    auto bit8 = IR::Type_Bits::get(8);
+    auto bool_ = IR::Type_Boolean::get();
+
+    // Each variable is bound to a type which uses the next one.
+    checkSameAsEager({ { t, tuple({ u, v }) },
+                       { u, tuple({ v, w }) },
+                       { v, tuple({ w, bit8 }) },
+                       { w, bool_ } });
+    // The same bindings in the opposite order need no rewriting.
+    t = new IR::Type_Var(IR::ID("T"));
+    u = new IR::Type_Var(IR::ID("U"));
+    v = new IR::Type_Var(IR::ID("V"));
+    w = new IR::Type_Var(IR::ID("W"));
+    checkSameAsEager({ { w, bool_ },
+                       { v, tuple({ bool_, bit8 }) },
+                       { u, tuple({ tuple({ bool_, bit8 }), bool_ }) },
+                       { t, tuple({ tuple({ tuple({ bool_, bit8 }), bool_ }),
+                                    tuple({ bool_, bit8 }) }) } });
+    // Chains of variables bound to variables, in mixed order.
+    t = new IR::Type_Var(IR::ID("T"));
+    u = new IR::Type_Var(IR::ID("U"));
+    v = new IR::Type_Var(IR::ID("V"));
+    w = new IR::Type_Var(IR::ID("W"));
+    checkSameAsEager({ { u, v },
+                       { t, tuple({ u, w }) },
+                       { v, tuple({ w, w }) },
+                       { w, bit8 } });
+}
+
+TEST(TypeVariableSubstitution, SubstitutedTypeParameters) {
+    auto t = new IR::Type_Var(IR::ID("T"));
+    auto u = new IR::Type_Var(IR::ID("U"));
+    auto v = new IR::Type_Var(IR::ID("V"));
+    auto bit8 = IR::Type_Bits::get(8);
+
+    // The type parameter U is removed from T's binding once U is bound,
+    // while V stays a type parameter of W's binding.
+    auto w = new IR::Type_Var(IR::ID("W"));
+    checkSameAsEager({ { t, method(u, u, v) },
+                       { w, method(v, tuple({ v, u }), u) },
+                       { u, bit8 } });
+    checkSameAsEager({ { new IR::Type_Var(IR::ID("X")), method(u, u, v) },
+                       { new IR::Type_Var(IR::ID("Y")), method(v, v, u) },
+                       { new IR::Type_Var(IR::ID("Z")), tuple({ u, v }) },
+                       { u, bit8 },
+                       { v, tuple({ bit8, bit8 }) } });
+}
+
+TEST(TypeVariableSubstitution, ResolveBetweenComposes) {
+    auto t = new IR::Type_Var(IR::ID("T"));
+    auto u = new IR::Type_Var(IR::ID("U"));
+    auto v = new IR::Type_Var(IR::ID("V"));
+    auto bit8 = IR::Type_Bits::get(8);
+
+    P4::TypeVariableSubstitution lazy;
+    EagerSubstitution eager;
+    for (auto b : std::vector<Binding>{ { t, tuple({ u, v }) }, { u, tuple({ v, v }) } }) {
+        EXPECT_EQ("", lazy.compose(b.first, b.second));
+        EXPECT_EQ("", eager.compose(b.first, b.second));
+    }
+    // T is brought up to date with U only; V is replaced by a later resolve.
+    EXPECT_TRUE(lazy.resolve(t)->equiv(*eager.binding.at(t)));
+    EXPECT_EQ("", lazy.compose(v, bit8));
+    EXPECT_EQ("", eager.compose(v, bit8));
+    EXPECT_TRUE(lazy.resolve(t)->equiv(*eager.binding.at(t)));
+    EXPECT_TRUE(lazy.resolve(u)->equiv(*eager.binding.at(u)));
+    EXPECT_TRUE(lazy.resolve(v)->equiv(*eager.binding.at(v)));
+    EXPECT_TRUE(lazy.lookup(t)->equiv(*tuple({ tuple({ bit8, bit8 }), bit8 })));
+}
+
+TEST(TypeVariableSubstitution, OccursCheck) {
+    auto t = new IR::Type_Var(IR::ID("T"));
+    auto u = new IR::Type_Var(IR::ID("U"));
+
+    P4::TypeVariableSubstitution tvs;
+    EXPECT_EQ("'%1%' cannot be replaced with '%2%' which already contains it",
+              tvs.compose(t, tuple({ u, t })));
+    EXPECT_FALSE(tvs.containsKey(t));
+    // The check only looks at the substitution itself, not at its bindings.
+    EXPECT_EQ("", tvs.compose(u, tuple({ t })));
+    EXPECT_EQ("'%1%' cannot be replaced with '%2%' which already contains it",
+              tvs.compose(t, method(u, t, u)));
+
+    auto infint = new IR::Type_InfInt();
+    EXPECT_EQ("'%1%' type can only be unified with 'int', 'bit<>', or 'signed<>' types, "
+              "not with '%2%'", tvs.compose(infint, IR::Type_Boolean::get()));
+}
+
+}  // namespace Test
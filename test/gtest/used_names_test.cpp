@@ -0,0 +1,94 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <random>
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "lib/cstring.h"
+
+namespace Test {
+
+namespace {
+
+/// The base UsedNames::newName starts from: @p name without a trailing "_"
+/// followed by any number of digits.
+cstring withoutSuffix(cstring name) {
+    std::string s(name.c_str());
+    // npos + 1 is 0 when all the characters are digits
+    auto len = s.find_last_not_of("0123456789") + 1;
+    if (len > 0 && s[len - 1] == '_')
+        return s.substr(0, len - 1);
+    return name;
+}
+
+}  // namespace
+
+TEST(UsedNames, ExplicitSuffixes) {
+    P4::UsedNames names;
+    names.insert("base_0");
+    names.insert("base_1");
+    names.insert("base_3");
+    EXPECT_EQ("base", names.newName("base"));
+    EXPECT_EQ("base_2", names.newName("base"));
+    EXPECT_EQ("base_4", names.newName("base_7"));
+
+    // Names inserted after the generated ones are skipped as well
+    names.insert("base_5");
+    EXPECT_EQ("base_6", names.newName("base"));
+    EXPECT_EQ(1u, names.count("base_5"));
+    EXPECT_EQ(1u, names.count("base_6"));
+
+    names.clear();
+    EXPECT_EQ(0u, names.count("base_5"));
+    EXPECT_EQ("base", names.newName("base"));
+    EXPECT_EQ("base_0", names.newName("base"));
+}
+
+TEST(UsedNames, SameAsMakeUnique) {
+    // Random inserts, new names and clears, checked against
+    // cstring::make_unique on a plain set.
+    const char *bases[] = { "tmp", "tmp_1", "key", "key_0", "x2", "x_", "hdr_7" };
+    std::mt19937 random(1);
+    P4::UsedNames names;
+    std::set<cstring> reference;
+    for (int i = 0; i < 20000; i++) {
+        cstring base = bases[random() % (sizeof(bases) / sizeof(bases[0]))];
+        switch (random() % 10) {
+        case 0: {
+            cstring name = base + ("_" + std::to_string(random() % 20));
+            names.insert(name);
+            reference.insert(name);
+            break;
+        }
+        case 1:
+            if (random() % 50 == 0) {
+                names.clear();
+                reference.clear();
+            }
+            break;
+        default: {
+            auto expected = cstring::make_unique(reference, withoutSuffix(base), '_');
+            reference.insert(expected);
+            ASSERT_EQ(expected, names.newName(base)) << "iteration " << i;
+        }
+        }
+    }
+    for (auto name : reference)
+        EXPECT_EQ(1u, names.count(name));
+}
+
+}  // namespace Test
@@ -11,8 +11,10 @@
 # WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 # See the License for the specific language governing permissions and
 # limitations under the License.
+import array
 import os
 import shlex, subprocess
+import socket
 import sys
 
 import p4c_src.util as util
@@ -47,6 +49,7 @@ class BackendDriver:
         self._source_basename = None
         self._verbose = False
         self._run_preprocessor_only = False
+        self._server_socket = None
 
     def __str__(self):
         return self._backend
@@ -86,6 +89,7 @@ class BackendDriver:
         self._source_filename = opts.source_file
         self._source_basename = os.path.splitext(os.path.basename(opts.source_file))[0]
         self._run_preprocessor_only = opts.run_preprocessor_only
+        self._server_socket = opts.server_socket
 
         # set preprocessor options
         if 'preprocessor' in self._commands:
@@ -242,6 +246,11 @@ class BackendDriver:
             return 0
 
         args = shlex.split(" ".join(cmd))
+        if step == 'compiler' and self._server_socket:
+            rc = self.runOnServer(args)
+            if rc is not None:
+                return rc
+
         try:
             p = subprocess.Popen(args)
         except:
@@ -255,6 +264,44 @@ class BackendDriver:
         return p.returncode
 
 
+    def runOnServer(self, args):
+        """
+        Run the compiler command args on the compile server listening on
+        self._server_socket (a compiler started with '--server <socket>').
+        Returns the exit code, or None if the server is not running or
+        runs another compiler.
+        """
+        strings = [os.getcwd()] + args
+        data = "{}\0".format(len(strings)) + "".join(s + "\0" for s in strings)
+        data = data.encode()
+        try:
+            conn = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            conn.connect(self._server_socket)
+        except OSError:
+            return None
+
+        with conn:
+            if self._verbose: print('running {} on {}'.format(' '.join(args),
+                                                             self._server_socket))
+            sys.stdout.flush()
+            sys.stderr.flush()
+            # The compiler writes directly to our standard output and error
+            fds = array.array("i", [sys.stdin.fileno(), sys.stdout.fileno(),
+                                    sys.stderr.fileno()])
+            sent = conn.sendmsg([data], [(socket.SOL_SOCKET, socket.SCM_RIGHTS, fds)])
+            if sent < len(data):
+                conn.sendall(data[sent:])
+            reply = b""
+            while not reply.endswith(b"\n"):
+                chunk = conn.recv(64)
+                if not chunk:
+                    break
+                reply += chunk
+
+        if reply == b"unsupported\n":
+            return None
+        return int(reply) if reply.endswith(b"\n") else 1
+
     def preRun(self, cmd_name):
         """
         Preamble to a command to setup anything needed
@@ -169,6 +169,12 @@ def main():
                             "invocations of the same subparser instance.",
                         action="store_true", default=False)
 
+    parser.add_argument("--compile-server", dest="server_socket", metavar="SOCKET",
+                        help="Run the compiler on the compile server listening on SOCKET "
+                            "(a compiler started with '--server SOCKET'), if it is running. "
+                            "Defaults to $P4C_SERVER_SOCKET.",
+                        action="store", default=os.environ.get('P4C_SERVER_SOCKET'))
+
     if (os.environ['P4C_BUILD_TYPE'] == "DEVELOPER"):
         add_developer_options(parser)
 
@@ -0,0 +1,359 @@
+#!/usr/bin/env python3
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+""" Measures how long the compilers take, and how much memory they use, on a
+    corpus of programs: the test samples and generated programs that stress
+    large tables, deep parsers, many actions and wide headers.
+
+    Each program is compiled by each compiler in a separate process. The
+    results are written as JSON: for each compilation, the exit code, the
+    wall-clock, user and system time, the peak resident set size, the number
+    of allocations and the time of each phase and pass (which the compilers
+    report with --pass-stats).
+
+    Example: compare the front and mid ends before and after a change
+        p4c-bench.py -b build -c p4test -o before.json
+        p4c-bench.py -b build -c p4test -o after.json --baseline before.json
+"""
+
+import argparse
+import glob
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+from collections import OrderedDict
+
+SOURCE_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SAMPLES_DIR = os.path.join(SOURCE_DIR, "testdata", "p4_16_samples")
+
+
+def dpdk_arch(program):
+    """ The architecture of a dpdk sample, from its name. """
+    return ["--arch", "pna"] if os.path.basename(program).startswith("pna-") else \
+        ["--arch", "psa"]
+
+
+# For each compiler: the executable, the samples it compiles, and the options
+# for a program, given the file for its output.
+COMPILERS = OrderedDict([
+    ("p4test", ("p4test", ["*.p4"],
+                lambda program, out: [])),
+    ("bmv2", ("p4c-bm2-ss", ["*-bmv2.p4"],
+              lambda program, out: ["-o", out + ".json"])),
+    ("ebpf", ("p4c-ebpf", ["*_ebpf.p4"],
+              lambda program, out: ["-o", out + ".c"])),
+    ("dpdk", ("p4c-dpdk", ["psa-*.p4", "pna-*.p4"],
+              lambda program, out: dpdk_arch(program) + ["-o", out + ".spec"])),
+])
+
+# The generated programs use v1model, which only these compilers accept.
+GENERATED_COMPILERS = ["p4test", "bmv2"]
+
+V1MODEL_MAIN = """
+control VerifyChecksumI(inout headers_t hdr, inout meta_t meta) { apply { } }
+control ComputeChecksumI(inout headers_t hdr, inout meta_t meta) { apply { } }
+control EgressI(inout headers_t hdr, inout meta_t meta,
+                inout standard_metadata_t sm) { apply { } }
+control DeparserI(packet_out pkt, in headers_t hdr) { apply { pkt.emit(hdr); } }
+V1Switch(ParserI(), VerifyChecksumI(), IngressI(), EgressI(), ComputeChecksumI(),
+         DeparserI()) main;
+"""
+
+
+def v1model_program(headers, parser, ingress):
+    """ A v1model program with the given declarations, parser states and
+        ingress control body. The struct headers_t, the parser ParserI and
+        the control IngressI are made by the callers. """
+    return ("#include <core.p4>\n#include <v1model.p4>\n\n" + headers +
+            "struct meta_t { bit<32> value; }\n\n" +
+            "parser ParserI(packet_in pkt, out headers_t hdr, inout meta_t meta,\n" +
+            "               inout standard_metadata_t sm) {\n" + parser + "}\n\n" +
+            "control IngressI(inout headers_t hdr, inout meta_t meta,\n" +
+            "                 inout standard_metadata_t sm) {\n" + ingress + "}\n" +
+            V1MODEL_MAIN)
+
+
+ONE_HEADER = """header h_t { bit<32> key; bit<32> value; bit<8> next; }
+struct headers_t { h_t h; }
+"""
+ONE_HEADER_PARSER = "    state start { pkt.extract(hdr.h); transition accept; }\n"
+
+
+def generate_tables(size):
+    """ A control applying @size tables, each with its own key and actions. """
+    ingress = ""
+    for i in range(size):
+        ingress += ("    action set%d(bit<32> v) { hdr.h.value = v + %d; }\n" % (i, i) +
+                    "    table t%d {\n" % i +
+                    "        key = { hdr.h.key : exact; meta.value : ternary; }\n" +
+                    "        actions = { set%d; NoAction; }\n" % i +
+                    "        size = 1024;\n" +
+                    "        default_action = NoAction();\n" +
+                    "    }\n")
+    ingress += "    apply {\n"
+    for i in range(size):
+        ingress += "        if (hdr.h.next == %d) { t%d.apply(); }\n" % (i % 256, i)
+    ingress += "    }\n"
+    return v1model_program(ONE_HEADER, ONE_HEADER_PARSER, ingress)
+
+
+def generate_parser(size):
+    """ A parser with a chain of @size states, each extracting a header. """
+    headers = "header h_t { bit<32> key; bit<32> value; bit<8> next; }\nstruct headers_t {\n"
+    for i in range(size):
+        headers += "    h_t h%d;\n" % i
+    headers += "    h_t h;\n}\n"
+    parser = "    state start { transition s0; }\n"
+    for i in range(size):
+        following = "s%d" % (i + 1) if i + 1 < size else "accept"
+        parser += ("    state s%d {\n" % i +
+                   "        pkt.extract(hdr.h%d);\n" % i +
+                   "        transition select(hdr.h%d.next) {\n" % i +
+                   "            0: accept;\n" +
+                   "            default: %s;\n" % following +
+                   "        }\n" +
+                   "    }\n")
+    ingress = "    apply {\n"
+    for i in range(size):
+        ingress += ("        if (hdr.h%d.isValid()) {\n" % i +
+                    "            meta.value = meta.value + hdr.h%d.value;\n" % i +
+                    "        }\n")
+    ingress += "    }\n"
+    return v1model_program(headers, parser, ingress)
+
+
+def generate_actions(size):
+    """ One table with @size actions. """
+    ingress = ""
+    for i in range(size):
+        ingress += ("    action a%d(bit<32> v) {\n" % i +
+                    "        hdr.h.value = hdr.h.value + v;\n" +
+                    "        meta.value = hdr.h.key ^ %d;\n" % i +
+                    "    }\n")
+    ingress += ("    table t {\n" +
+                "        key = { hdr.h.key : exact; }\n" +
+                "        actions = {\n")
+    for i in range(size):
+        ingress += "            a%d;\n" % i
+    ingress += ("        }\n" +
+                "    }\n" +
+                "    apply { t.apply(); }\n")
+    return v1model_program(ONE_HEADER, ONE_HEADER_PARSER, ingress)
+
+
+def generate_headers(size):
+    """ A header with @size fields, all of them read and written. """
+    headers = "header h_t {\n    bit<32> key;\n    bit<32> value;\n    bit<8> next;\n"
+    def width(i):
+        return 8 * (i % 4 + 1)
+    for i in range(size):
+        headers += "    bit<%d> f%d;\n" % (width(i), i)
+    headers += "}\nstruct headers_t { h_t h; }\n"
+    ingress = "    apply {\n"
+    for i in range(size):
+        ingress += "        hdr.h.f%d = (bit<%d>)hdr.h.f%d + %d;\n" % (
+            i, width(i), (i + 1) % size, i % 7)
+    ingress += "        meta.value = hdr.h.key;\n    }\n"
+    return v1model_program(headers, ONE_HEADER_PARSER, ingress)
+
+
+GENERATORS = OrderedDict([
+    ("tables", generate_tables),
+    ("parser", generate_parser),
+    ("actions", generate_actions),
+    ("headers", generate_headers),
+])
+
+
+def corpus(args, compiler, workdir):
+    """ @return the list of programs for @compiler. """
+    programs = []
+    for item in args.corpus:
+        if item == "samples":
+            for pattern in COMPILERS[compiler][1]:
+                programs += sorted(glob.glob(os.path.join(SAMPLES_DIR, pattern)))
+        elif item in GENERATORS:
+            if compiler not in GENERATED_COMPILERS:
+                continue
+            path = os.path.join(workdir, "%s-%d.p4" % (item, args.size))
+            if not os.path.exists(path):
+                with open(path, "w") as f:
+                    f.write(GENERATORS[item](args.size))
+            programs.append(path)
+        else:
+            programs += sorted(glob.glob(item))
+    if args.filter:
+        programs = [p for p in programs if re.search(args.filter, p)]
+    return programs
+
+
+def read_pass_stats(path):
+    """ @return the time of each phase and the time and allocations of each
+        pass, from a file written with --pass-stats. """
+    phases = OrderedDict()
+    passes = OrderedDict()
+    allocations = 0
+    if not os.path.exists(path):
+        return phases, passes, allocations
+    with open(path) as f:
+        for line in f:
+            record = json.loads(line)
+            if record["depth"] == 0:
+                phases[record["in"]] = phases.get(record["in"], 0) + record["seconds"]
+                allocations += record["allocations"]
+            entry = passes.setdefault(record["pass"], {"seconds": 0, "allocations": 0})
+            entry["seconds"] += record["seconds"]
+            entry["allocations"] += record["allocations"]
+    return phases, passes, allocations
+
+
+def compile_program(args, compiler, program, workdir):
+    """ Compiles @program with @compiler and @return its measurements. """
+    executable = os.path.join(args.build_dir, COMPILERS[compiler][0])
+    out = os.path.join(workdir, "out")
+    stats = os.path.join(workdir, "stats.jsonl")
+    if os.path.exists(stats):
+        os.remove(stats)
+    command = [executable, "--pass-stats", stats] + \
+        COMPILERS[compiler][2](program, out) + args.compiler_options + [program]
+    start = time.monotonic()
+    with open(os.devnull, "w") as devnull:
+        process = subprocess.Popen(command, stdout=devnull, stderr=devnull)
+        _, status, usage = os.wait4(process.pid, 0)
+    wall = time.monotonic() - start
+    # Recorded, so that the Popen object does not wait for the process again.
+    process.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) \
+        else -os.WTERMSIG(status)
+    phases, passes, allocations = read_pass_stats(stats)
+    result = OrderedDict([
+        ("compiler", compiler),
+        ("program", os.path.relpath(program, SOURCE_DIR)
+         if program.startswith(SOURCE_DIR) else os.path.basename(program)),
+        ("exit", process.returncode),
+        ("wall_seconds", round(wall, 4)),
+        ("user_seconds", round(usage.ru_utime, 4)),
+        ("system_seconds", round(usage.ru_stime, 4)),
+        # ru_maxrss is in kilobytes on Linux and in bytes on macOS.
+        ("peak_rss_kb", usage.ru_maxrss // 1024 if sys.platform == "darwin"
+         else usage.ru_maxrss),
+        ("allocations", allocations),
+        ("phases", OrderedDict((k, round(v, 4)) for k, v in phases.items())),
+    ])
+    if args.passes:
+        result["passes"] = passes
+    return result
+
+
+def summarize(results):
+    """ Totals for each compiler. """
+    summary = OrderedDict()
+    for r in results:
+        s = summary.setdefault(r["compiler"], OrderedDict([
+            ("programs", 0), ("failures", 0), ("wall_seconds", 0),
+            ("max_peak_rss_kb", 0), ("allocations", 0), ("phases", OrderedDict())]))
+        s["programs"] += 1
+        s["failures"] += r["exit"] != 0
+        s["wall_seconds"] = round(s["wall_seconds"] + r["wall_seconds"], 4)
+        s["max_peak_rss_kb"] = max(s["max_peak_rss_kb"], r["peak_rss_kb"])
+        s["allocations"] += r["allocations"]
+        for phase, seconds in r["phases"].items():
+            s["phases"][phase] = round(s["phases"].get(phase, 0) + seconds, 4)
+    return summary
+
+
+def compare(summary, baseline_file):
+    """ Prints the change of each total against a previous run. """
+    with open(baseline_file) as f:
+        baseline = json.load(f)["summary"]
+    for compiler, s in summary.items():
+        if compiler not in baseline:
+            continue
+        b = baseline[compiler]
+        for key in ["wall_seconds", "max_peak_rss_kb", "allocations"]:
+            if b[key]:
+                print("%-8s %-16s %12s -> %12s (%+.1f%%)" % (
+                    compiler, key, b[key], s[key], 100.0 * (s[key] - b[key]) / b[key]),
+                    file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-b", "--build-dir", default=".",
+                        help="Folder holding the compilers (default: current folder)")
+    parser.add_argument("-c", "--compilers", default=",".join(COMPILERS),
+                        help="Comma-separated compilers to run, among " +
+                        ", ".join(COMPILERS) + " (default: all those built)")
+    parser.add_argument("--corpus", action="append",
+                        help="samples, a generator (" + ", ".join(GENERATORS) +
+                        ") or a glob of programs; repeat for several (default: all)")
+    parser.add_argument("--size", type=int, default=1000,
+                        help="Size of the generated programs (default: 1000)")
+    parser.add_argument("--filter", help="Only compile programs matching this regex")
+    parser.add_argument("--repeat", type=int, default=1,
+                        help="Compile each program this many times")
+    parser.add_argument("--passes", action="store_true",
+                        help="Also report the time and allocations of each pass")
+    parser.add_argument("--compiler-options", default="",
+                        help="Extra options for the compilers")
+    parser.add_argument("-o", "--output", help="Write the results here (default: stdout)")
+    parser.add_argument("--baseline",
+                        help="Results of an earlier run, to print the changes against")
+    args = parser.parse_args()
+    args.corpus = args.corpus or ["samples"] + list(GENERATORS)
+    args.compiler_options = args.compiler_options.split()
+    args.build_dir = os.path.abspath(args.build_dir)
+
+    results = []
+    with tempfile.TemporaryDirectory(prefix="p4c-bench-") as workdir:
+        for compiler in args.compilers.split(","):
+            if compiler not in COMPILERS:
+                parser.error("unknown compiler " + compiler)
+            if not os.path.exists(os.path.join(args.build_dir, COMPILERS[compiler][0])):
+                print("Skipping %s: %s was not built" % (compiler, COMPILERS[compiler][0]),
+                      file=sys.stderr)
+                continue
+            programs = corpus(args, compiler, workdir)
+            print("Compiling %d programs with %s" % (len(programs), compiler), file=sys.stderr)
+            for program in programs:
+                for run in range(args.repeat):
+                    result = compile_program(args, compiler, program, workdir)
+                    result["run"] = run
+                    results.append(result)
+
+    summary = summarize(results)
+    report = OrderedDict([
+        ("size", args.size),
+        ("corpus", args.corpus),
+        ("summary", summary),
+        ("results", results),
+    ])
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(report, f, indent=1)
+            f.write("\n")
+    else:
+        json.dump(report, sys.stdout, indent=1)
+        print()
+    if args.baseline:
+        compare(summary, args.baseline)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())